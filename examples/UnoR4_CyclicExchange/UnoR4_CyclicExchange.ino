@@ -0,0 +1,96 @@
+#include <MKSServoE.h>
+#include <MKSServoGroup.h>
+#include <MKSCyclicExchange.h>
+#include <transport/adapters/AdapterSelector.h>
+
+const uint32_t kBitrate = 500000;
+
+CanBusAdapter bus;
+MKSServoGroup group(bus);
+MKSCyclicExchange cycle(group, kBitrate);
+
+const uint8_t kAxisCount = 4;
+MKSServoE axes[kAxisCount] = { MKSServoE(bus), MKSServoE(bus), MKSServoE(bus), MKSServoE(bus) };
+
+unsigned long lastPrintMs = 0;
+uint32_t lastOverruns = 0;
+
+static void onCycle(void *, const MKSCyclicExchange::CycleReport &report) {
+  if (report.overrun) {
+    Serial.print("Cycle ");
+    Serial.print(report.cycle);
+    Serial.print(" overrun: missing=");
+    Serial.print(report.missing);
+    Serial.print(" unsent=");
+    Serial.println(report.unsent);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 2000) {}
+
+  if (!bus.begin(kBitrate)) {
+    Serial.println("CAN init failed");
+    return;
+  }
+
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    axes[i].setTargetId(0x01 + i);
+    axes[i].setTxId(0x01 + i);
+    group.addAxis(axes[i]);
+    uint8_t status = 0;
+    axes[i].setMode(0x05, status);
+    axes[i].enable();
+  }
+
+  cycle.setCycleUs(10000);
+  cycle.setTelemetry(MKSCyclicExchange::FIELD_ENCODER | MKSCyclicExchange::FIELD_SPEED | MKSCyclicExchange::FIELD_POS_ERROR);
+  cycle.setCycleHandler(onCycle);
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    cycle.setSpeedSetpoint(i, MKSUnits::Rpm(100), 10);
+  }
+  Serial.print("Required load budget: ");
+  Serial.print(cycle.requiredBudgetPermille());
+  Serial.println(" permille");
+  cycle.start();
+}
+
+void loop() {
+  if (!cycle.update()) {
+    return;
+  }
+
+  // New setpoints for the next cycle: reverse every 4 s.
+  const bool reverse = (millis() / 4000) & 1;
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    cycle.setSpeedSetpoint(i, MKSUnits::Rpm(reverse ? -100 : 100), 10);
+  }
+
+  const unsigned long now = millis();
+  if (now - lastPrintMs < 1000) {
+    return;
+  }
+  lastPrintMs = now;
+  Serial.print("cycle=");
+  Serial.print(cycle.snapshotCycle());
+  Serial.print(" jitter_mean_us=");
+  Serial.print(cycle.meanJitterUs());
+  Serial.print(" jitter_max_us=");
+  Serial.print(cycle.maxJitterUs());
+  Serial.print(" overruns=+");
+  Serial.println(cycle.overruns() - lastOverruns);
+  lastOverruns = cycle.overruns();
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    const MKSCyclicExchange::AxisSnapshot *s = cycle.snapshot(i);
+    Serial.print("  axis ");
+    Serial.print(i);
+    Serial.print(s->valid == s->requested ? " " : " (stale) ");
+    Serial.print("pos=");
+    Serial.print((long)s->encoderAddition);
+    Serial.print(" rpm=");
+    Serial.print(s->speedRpm);
+    Serial.print(" err=");
+    Serial.println((long)s->positionError);
+  }
+}
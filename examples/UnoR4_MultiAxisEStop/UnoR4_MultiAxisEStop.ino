@@ -0,0 +1,86 @@
+#include <MKSServoE.h>
+#include <MKSServoGroup.h>
+#include <MKSStartupSequencer.h>
+#include <MKSEmergencyStop.h>
+#include <transport/adapters/AdapterSelector.h>
+
+CanBusAdapter bus;
+MKSServoGroup group(bus);
+MKSStartupSequencer sequencer(group);
+MKSEmergencyStop estop(group, 500000);
+
+const uint8_t kAxisCount = 4;
+const uint8_t kEStopPin = 2;  // active low, e.g. a stop button to GND
+MKSServoE axes[kAxisCount] = { MKSServoE(bus), MKSServoE(bus), MKSServoE(bus), MKSServoE(bus) };
+
+bool running = false;
+bool stopping = false;
+
+static void printReport() {
+  const MKSEmergencyStop::Report &r = estop.report();
+  Serial.print("E-stop rc=");
+  Serial.print(r.rc);
+  Serial.print(" broadcast=");
+  Serial.print(r.broadcastSent ? "yes" : "no");
+  Serial.print(" aborted=");
+  Serial.print(r.abortedFrames);
+  Serial.print(" acked=");
+  Serial.print(r.ackedCount);
+  Serial.print("/");
+  Serial.println(r.axisCount);
+  Serial.print("Issued after ");
+  Serial.print(r.issueUs);
+  Serial.print(" us, off the wire within ");
+  Serial.print(r.boundUs);
+  Serial.print(" us, last ack after ");
+  Serial.print(r.lastAckUs);
+  Serial.println(" us");
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 2000) {}
+  pinMode(kEStopPin, INPUT_PULLUP);
+
+  if (!bus.begin(500000)) {
+    Serial.println("CAN init failed");
+    return;
+  }
+
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    axes[i].setTargetId(0x01 + i);
+    axes[i].setTxId(0x01 + i);
+    group.addAxis(axes[i]);
+  }
+
+  sequencer.addStepAll(MKSStartupSequencer::enableStep());
+  sequencer.addStepAll(MKSStartupSequencer::modeStep(0x05));      // Bus closed-loop FOC
+  MKSServoE::ERROR rc = sequencer.run(2000);
+  if (rc != MKSServoE::ERROR_OK) {
+    Serial.print("Startup failed, rc=");
+    Serial.println(rc);
+    return;
+  }
+
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    uint8_t status = 0;
+    axes[i].runSpeed(0, 300, 4, status);
+  }
+  running = true;
+}
+
+void loop() {
+  if (running && digitalRead(kEStopPin) == LOW) {
+    // Drops queued TX frames, then stops every drive with one broadcast frame.
+    estop.trigger();
+    running = false;
+    stopping = true;
+  }
+  if (stopping && estop.update()) {
+    stopping = false;
+    printReport();
+  }
+  if (!stopping) {
+    group.poll();
+  }
+}
@@ -0,0 +1,94 @@
+#include <MKSServoE.h>
+#include <MKSServoGroup.h>
+#include <MKSStartupSequencer.h>
+#include <MKSHomingEngine.h>
+#include <transport/adapters/AdapterSelector.h>
+
+CanBusAdapter bus;
+MKSServoGroup group(bus);
+MKSStartupSequencer sequencer(group);
+MKSHomingEngine homing(group);
+
+const uint8_t kAxisCount = 4;
+MKSServoE axes[kAxisCount] = { MKSServoE(bus), MKSServoE(bus), MKSServoE(bus), MKSServoE(bus) };
+
+bool homingActive = false;
+unsigned long homingStartMs = 0;
+
+static void printResults() {
+  Serial.print("Homing finished in ");
+  Serial.print(millis() - homingStartMs);
+  Serial.println(" ms");
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    Serial.print("Axis ");
+    Serial.print(i);
+    Serial.print(": rc=");
+    Serial.print(homing.axisResult(i));
+    Serial.print(" phase=");
+    Serial.print(homing.phase(i));
+    if (homing.phase(i) == MKSHomingEngine::PHASE_FAILED) {
+      Serial.print(" (failed in phase ");
+      Serial.print(homing.failedPhase(i));
+      Serial.print(")");
+    }
+    Serial.print(" homing ");
+    Serial.print(homing.axisHomingMs(i));
+    Serial.print(" ms, total ");
+    Serial.print(homing.axisElapsedMs(i));
+    Serial.println(" ms");
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 2000) {}
+
+  if (!bus.begin(500000)) {
+    Serial.println("CAN init failed");
+    return;
+  }
+
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    axes[i].setTargetId(0x01 + i);
+    axes[i].setTxId(0x01 + i);
+    group.addAxis(axes[i]);
+  }
+
+  sequencer.addStepAll(MKSStartupSequencer::enableStep());
+  sequencer.addStepAll(MKSStartupSequencer::modeStep(0x05));      // Bus closed-loop FOC
+  sequencer.addStepAll(MKSStartupSequencer::currentStep(1200));
+  MKSServoE::ERROR rc = sequencer.run(2000);
+  if (rc != MKSServoE::ERROR_OK) {
+    Serial.print("Startup failed, rc=");
+    Serial.println(rc);
+    return;
+  }
+
+  // trigLevel=0 (low), homeDir=0 (CW), homeSpeed=120rpm, endLimitEnable=1, mode=0
+  MKSHomingEngine::AxisConfig config = MKSHomingEngine::defaultConfig();
+  config.writeConfig = true;
+  config.homeSpeedRpm = 120;
+  homing.configureAll(config);
+  // Axis 3 (e.g. Z) homes first; X/Y/A start once it is clear.
+  config.stage = 0;
+  homing.configure(3, config);
+  config.stage = 1;
+  for (uint8_t i = 0; i < 3; i++) {
+    homing.configure(i, config);
+  }
+
+  homingStartMs = millis();
+  homing.start();
+  homingActive = true;
+}
+
+void loop() {
+  // Non-blocking: the sketch stays responsive while every axis homes.
+  if (homingActive && homing.update()) {
+    homingActive = false;
+    printResults();
+  }
+  if (!homingActive) {
+    group.poll();
+  }
+}
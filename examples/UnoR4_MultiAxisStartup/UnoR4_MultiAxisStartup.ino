@@ -0,0 +1,59 @@
+#include <MKSServoE.h>
+#include <MKSServoGroup.h>
+#include <MKSStartupSequencer.h>
+#include <transport/adapters/AdapterSelector.h>
+
+CanBusAdapter bus;
+MKSServoGroup group(bus);
+MKSStartupSequencer sequencer(group);
+
+const uint8_t kAxisCount = 4;
+MKSServoE axes[kAxisCount] = { MKSServoE(bus), MKSServoE(bus), MKSServoE(bus), MKSServoE(bus) };
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 2000) {}
+
+  if (!bus.begin(500000)) {
+    Serial.println("CAN init failed");
+    return;
+  }
+
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    axes[i].setTargetId(0x01 + i);
+    axes[i].setTxId(0x01 + i);
+    group.addAxis(axes[i]);
+  }
+
+  sequencer.addStepAll(MKSStartupSequencer::enableStep());
+  sequencer.addStepAll(MKSStartupSequencer::modeStep(0x05));      // Bus closed-loop FOC
+  sequencer.addStepAll(MKSStartupSequencer::currentStep(1200));
+  sequencer.addStepAll(MKSStartupSequencer::microstepStep(16));
+  // trigLevel=0 (low), homeDir=0 (CW), homeSpeed=120rpm, endLimitEnable=1, mode=0
+  sequencer.addStepAll(MKSStartupSequencer::homeConfigStep(0, 0, 120, 1, 0));
+
+  const unsigned long startMs = millis();
+  MKSServoE::ERROR rc = sequencer.run(2000);
+  Serial.print("Startup finished in ");
+  Serial.print(millis() - startMs);
+  Serial.print(" ms, rc=");
+  Serial.println(rc);
+
+  for (uint8_t i = 0; i < kAxisCount; i++) {
+    Serial.print("Axis ");
+    Serial.print(i);
+    Serial.print(": steps ");
+    Serial.print(sequencer.completedSteps(i));
+    Serial.print("/");
+    Serial.print(sequencer.stepCount(i));
+    Serial.print(" rc=");
+    Serial.print(sequencer.axisResult(i));
+    Serial.print(" took ");
+    Serial.print(sequencer.axisElapsedMs(i));
+    Serial.println(" ms");
+  }
+}
+
+void loop() {
+  group.poll();
+}
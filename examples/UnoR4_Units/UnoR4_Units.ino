@@ -0,0 +1,102 @@
+#include <MKSServoE.h>
+#include <MKSUnits.h>
+#include <transport/adapters/AdapterSelector.h>
+
+// Linear axis: 16 microsteps, 5:1 gearbox, 5 mm lead screw. All conversions below are
+// resolved at compile time.
+typedef MKSUnits::Axis<16, 5, 1, 5000> LinearAxis;
+
+CanBusAdapter bus;
+MKSServoE servo(bus);
+
+const uint16_t kServoId = 0x01;
+const uint8_t kAcc = 20;
+const MKSUnits::Rpm kSpeed = LinearAxis::rpm(MKSUnits::MicrometresPerSecond(10000));
+const MKSUnits::Counts kTargets[] = {
+  LinearAxis::counts(MKSUnits::Micrometres(25000)),
+  LinearAxis::counts(MKSUnits::Micrometres(0)),
+};
+const uint32_t kMoveWindowMs = 6000;
+
+unsigned long lastTelemetryMs = 0;
+unsigned long moveStartMs = 0;
+uint8_t moveIndex = 0;
+bool errorLatched = false;
+
+static void sendMove(uint8_t index) {
+  uint8_t status = 0;
+  MKSServoE::ERROR rc = servo.runPositionMode4AbsoluteAxis(kSpeed, kAcc, kTargets[index], status);
+  Serial.print("Move to ");
+  Serial.print((long)LinearAxis::micrometres(kTargets[index]).value);
+  Serial.print(" um at ");
+  Serial.print(kSpeed.value);
+  Serial.println(rc == MKSServoE::ERROR_OK ? " rpm: ok" : " rpm: err");
+  if (rc != MKSServoE::ERROR_OK) {
+    servo.disable();
+    errorLatched = true;
+  }
+  moveStartMs = millis();
+}
+
+static void printTelemetry() {
+  MKSUnits::Counts position;
+  MKSUnits::Rpm speed;
+  MKSUnits::ErrorUnits error;
+  if (servo.readEncoderAddition(position) != MKSServoE::ERROR_OK ||
+      servo.readSpeedRpm(speed) != MKSServoE::ERROR_OK ||
+      servo.readPositionError(error) != MKSServoE::ERROR_OK) {
+    Serial.println("Telemetry read failed");
+    return;
+  }
+  Serial.print("pos_um=");
+  Serial.print((long)LinearAxis::micrometres(position).value);
+  Serial.print(" speed_um_s=");
+  Serial.print((long)LinearAxis::micrometresPerSecond(speed).value);
+  Serial.print(" err_um=");
+  Serial.println((long)LinearAxis::micrometres(LinearAxis::counts(error)).value);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 2000) {}
+
+  if (!bus.begin(500000)) {
+    Serial.println("CAN init failed");
+    return;
+  }
+
+  servo.setTargetId(kServoId);
+  servo.setTxId(kServoId);
+
+  if (servo.enable() != MKSServoE::ERROR_OK) {
+    Serial.println("Enable failed");
+    errorLatched = true;
+    return;
+  }
+
+  uint8_t status = 0;
+  servo.setMode(0x05, status);
+  if (servo.setMicrostep(16, status) != MKSServoE::ERROR_OK) {
+    Serial.println("Microstep init failed");
+  }
+  servo.setAxisZero(status);
+
+  sendMove(moveIndex);
+}
+
+void loop() {
+  if (errorLatched) {
+    return;
+  }
+
+  const unsigned long now = millis();
+  if (now - lastTelemetryMs >= 500) {
+    lastTelemetryMs = now;
+    printTelemetry();
+  }
+
+  if (now - moveStartMs >= kMoveWindowMs) {
+    moveIndex = (uint8_t)((moveIndex + 1) % 2);
+    sendMove(moveIndex);
+  }
+}
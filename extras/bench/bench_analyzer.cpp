@@ -0,0 +1,134 @@
+// Throughput of MKSLogAnalyzer on a synthetic capture: 16 axes on a saturated 1 Mbit/s bus
+// exchanging speed setpoints, encoder/speed/position-error reads and EN-status heartbeats, with
+// 0.1 % CRC-corrupted replies. The capture is written to a temporary file, mapped and analyzed
+// with 1, 2, 4, ... threads up to the hardware thread count, with and without time series.
+// One JSON object per line on stdout.
+//
+//   bench_analyzer [FRAMES]      default 8M frames (192 MB)
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -Isrc/host -Isrc extras/bench/bench_analyzer.cpp src/*.cpp src/host/*.cpp -o bench_analyzer
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "host/MKSCapture.h"
+#include "host/MKSLogAnalyzer.h"
+#include "protocol/MksCommands.h"
+#include "protocol/MksCrc.h"
+#include "protocol/MksPacking.h"
+#include "transport/CanTiming.h"
+
+namespace {
+const uint32_t BITRATE = 1000000;
+const uint8_t AXES = 16;
+const char *PATH = "/tmp/bench_analyzer.mkscap";
+
+struct Generator {
+  MKSCaptureWriter &out;
+  uint64_t nowUs;
+  uint32_t seed;
+
+  void emit(uint16_t id, uint8_t cmd, const uint8_t *payload, uint8_t len, bool toDrive) {
+    CanFrame f{};
+    f.id = id;
+    f.dlc = (uint8_t)(len + 2);
+    f.data[0] = cmd;
+    for (uint8_t i = 0; i < len; i++) {
+      f.data[1 + i] = payload[i];
+    }
+    f.data[len + 1] = MKS::crc8_sum_plus1(f.data, len + 1);
+    seed = seed * 1664525u + 1013904223u;
+    if (!toDrive && (seed >> 22) == 0) {
+      f.data[len + 1] ^= 0x01;
+    }
+    out.write(f, nowUs, toDrive ? (MKSCapture::FLAG_DIR_KNOWN | MKSCapture::FLAG_TO_DRIVE) : MKSCapture::FLAG_DIR_KNOWN);
+    nowUs += CanTiming::frameTimeUs(f, BITRATE);
+  }
+
+  void exchange(uint16_t id, uint32_t n) {
+    uint8_t p[6] = { 0 };
+    const uint8_t ok[1] = { 1 };
+    switch ((n / AXES) % 5) {
+      case 0: {
+        p[0] = (uint8_t)(n & 0x80);
+        p[1] = (uint8_t)n;
+        p[2] = 10;
+        emit(id, MKS::CMD_SPEED_MODE, p, 3, true);
+        emit(id, MKS::CMD_SPEED_MODE, ok, 1, false);
+        break;
+      }
+      case 1: {
+        emit(id, MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, true);
+        MKS::put_i48_be(p, (int64_t)n * 16);
+        emit(id, MKS::CMD_READ_ENCODER_ADDITION, p, 6, false);
+        break;
+      }
+      case 2: {
+        emit(id, MKS::CMD_READ_SPEED_RPM, nullptr, 0, true);
+        MKS::put_u16_be(p, (uint16_t)(n & 0x3FF));
+        emit(id, MKS::CMD_READ_SPEED_RPM, p, 2, false);
+        break;
+      }
+      case 3: {
+        emit(id, MKS::CMD_READ_POS_ERROR, nullptr, 0, true);
+        MKS::put_u32_be(p, n & 0xFF);
+        emit(id, MKS::CMD_READ_POS_ERROR, p, 4, false);
+        break;
+      }
+      default: {
+        emit(id, MKS::CMD_READ_EN_STATUS, nullptr, 0, true);
+        emit(id, MKS::CMD_READ_EN_STATUS, ok, 1, false);
+        break;
+      }
+    }
+  }
+};
+
+void run(const MKSCaptureMap &capture, uint8_t threads, bool series) {
+  MKSLogAnalyzer::Options options = MKSLogAnalyzer::defaultOptions();
+  options.threads = threads;
+  options.series = series;
+  MKSLogAnalyzer::Result result;
+  const auto start = std::chrono::steady_clock::now();
+  MKSLogAnalyzer::analyze(capture, options, result);
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  uint64_t matched = 0;
+  for (const MKSLogAnalyzer::Axis &axis : result.axes) {
+    matched += axis.stats.latencyCount;
+  }
+  printf("{\"bench\":\"analyzer\",\"threads\":%u,\"series\":%s,\"frames\":%llu,\"matched\":%llu,\"crc_errors\":%llu,"
+         "\"seconds\":%.3f,\"mframes_per_s\":%.1f,\"load_avg\":%.3f}\n",
+         result.threads, series ? "true" : "false", (unsigned long long)result.frames, (unsigned long long)matched,
+         (unsigned long long)result.crcErrors, seconds, result.frames / seconds / 1e6, result.averageLoad);
+}
+}
+
+int main(int argc, char **argv) {
+  const uint32_t frames = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 0) : (8u << 20);
+  {
+    MKSCaptureWriter writer;
+    if (!writer.open(PATH, BITRATE)) {
+      printf("cannot write %s\n", PATH);
+      return 1;
+    }
+    Generator gen = { writer, 0, 1 };
+    for (uint32_t n = 0; writer.records() < frames; n++) {
+      gen.exchange((uint16_t)(1 + n % AXES), n);
+    }
+  }
+  MKSCaptureMap capture;
+  if (!capture.open(PATH)) {
+    printf("cannot map %s\n", PATH);
+    return 1;
+  }
+  const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= hardware && threads <= 255; threads *= 2) {
+    run(capture, (uint8_t)threads, false);
+    run(capture, (uint8_t)threads, true);
+  }
+  capture.close();
+  remove(PATH);
+  return 0;
+}
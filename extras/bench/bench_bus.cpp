@@ -0,0 +1,174 @@
+// Bus throughput benchmark against the simulated bus.
+// For each bitrate and axis count it measures, in simulated time:
+//   - blocking setpoint commands (runSpeed + ack) per second and their round-trip latency,
+//   - pipelined telemetry samples (readEncoderAddition, one outstanding per axis) per axis,
+// next to the theoretical limit from CanTiming for the exact frames sendCommand produces,
+// plus the real host CPU time spent per command (driver + simulator).
+// One JSON object per line on stdout.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -Isrc/host -Isrc extras/bench/bench_bus.cpp src/*.cpp src/host/*.cpp -o bench_bus
+#include <Arduino.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "MKSServoE.h"
+#include "MKSServoGroup.h"
+#include "host/SimCanBus.h"
+#include "protocol/MksCrc.h"
+#include "transport/CanTiming.h"
+
+namespace {
+const uint32_t WINDOW_US = 500000;
+const uint32_t BITRATES[] = { 125000, 250000, 500000, 1000000 };
+const uint8_t AXIS_COUNTS[] = { 1, 2, 4, 8, 16 };
+
+uint8_t bitrateCode(uint32_t bps) {
+  for (uint8_t code = 0; code < 4; code++) {
+    if (MKSServoE::bitrateBps(code) == bps) {
+      return code;
+    }
+  }
+  return 0;
+}
+
+CanFrame makeFrame(uint16_t id, const uint8_t *bytes, uint8_t len) {
+  CanFrame f{};
+  f.id = id;
+  for (uint8_t i = 0; i < len; i++) {
+    f.data[i] = bytes[i];
+  }
+  f.data[len] = MKS::crc8_sum_plus1(f.data, len);
+  f.dlc = (uint8_t)(len + 1);
+  return f;
+}
+
+double nowRealNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Rig {
+  SimCanBus bus;
+  std::vector<SimServoNode> nodes;
+  std::vector<MKSServoE> axes;
+  MKSServoGroup group;
+
+  Rig(uint32_t bitrate, uint8_t axisCount) : bus(), group(bus) {
+    nodes.reserve(axisCount);
+    axes.reserve(axisCount);
+    for (uint8_t i = 0; i < axisCount; i++) {
+      nodes.emplace_back((uint16_t)(i + 1));
+      nodes.back().setBitrateCode(bitrateCode(bitrate));
+    }
+    for (SimServoNode &node : nodes) {
+      bus.attach(node);
+    }
+    bus.begin(bitrate);
+    for (uint8_t i = 0; i < axisCount; i++) {
+      axes.emplace_back(bus);
+      axes.back().setTargetId((uint16_t)(i + 1));
+      axes.back().setTxId((uint16_t)(i + 1));
+    }
+    for (MKSServoE &axis : axes) {
+      group.addAxis(axis);
+      axis.enable();
+    }
+    bus.resetStats();
+  }
+};
+
+void runCase(uint32_t bitrate, uint8_t axisCount) {
+  // Theoretical limits for the frames the driver actually puts on the wire.
+  const uint8_t speedCmd[4] = { MKS::CMD_SPEED_MODE, 0x01, 0x2C, 0x00 };
+  const uint8_t speedAck[2] = { MKS::CMD_SPEED_MODE, 0x01 };
+  const uint8_t readCmd[1] = { MKS::CMD_READ_ENCODER_ADDITION };
+  const uint8_t readResp[7] = { MKS::CMD_READ_ENCODER_ADDITION, 0x00, 0x00, 0x00, 0x01, 0x23, 0x45 };
+  const uint32_t cmdBits = CanTiming::frameBits(makeFrame(1, speedCmd, 4)) + CanTiming::frameBits(makeFrame(1, speedAck, 2));
+  const uint32_t readBits = CanTiming::frameBits(makeFrame(1, readCmd, 1)) + CanTiming::frameBits(makeFrame(1, readResp, 7));
+  const double cmdLimit = (double)bitrate / cmdBits;
+  const double telemetryLimitPerAxis = (double)bitrate / readBits / axisCount;
+
+  // Blocking setpoints, round-robin over the axes.
+  Rig rig(bitrate, axisCount);
+  std::vector<uint32_t> latencies;
+  uint32_t commands = 0;
+  uint32_t failures = 0;
+  const double realStart = nowRealNs();
+  uint32_t start = micros();
+  while ((uint32_t)(micros() - start) < WINDOW_US) {
+    MKSServoE &axis = rig.axes[commands % axisCount];
+    uint8_t status = 0;
+    const uint32_t t0 = micros();
+    MKSServoE::ERROR rc = axis.runSpeed(0, 300, 0, status);
+    if (rc == MKSServoE::ERROR_OK) {
+      latencies.push_back(micros() - t0);
+    } else {
+      failures++;
+    }
+    commands++;
+  }
+  const double realNs = nowRealNs() - realStart;
+  const double cmdElapsedUs = (double)(uint32_t)(micros() - start);
+  const double cmdUtilization = (double)rig.bus.stats().busyUs / cmdElapsedUs;
+  std::sort(latencies.begin(), latencies.end());
+  double latencyAvg = 0.0;
+  for (uint32_t value : latencies) {
+    latencyAvg += value;
+  }
+  latencyAvg = latencies.empty() ? 0.0 : latencyAvg / latencies.size();
+  const uint32_t latencyP99 = latencies.empty() ? 0 : latencies[(latencies.size() * 99) / 100];
+
+  // Pipelined telemetry: each axis keeps one read outstanding.
+  rig.bus.resetStats();
+  std::vector<bool> outstanding(axisCount, false);
+  uint32_t samples = 0;
+  start = micros();
+  while ((uint32_t)(micros() - start) < WINDOW_US) {
+    // Bus reads (which move virtual time when nothing is ready) only happen once no axis can
+    // make progress, so a pass that sends or collects costs no simulated time.
+    bool progress = false;
+    for (uint8_t i = 0; i < axisCount; i++) {
+      MKSServoE &axis = rig.axes[i];
+      if (!outstanding[i]) {
+        outstanding[i] = axis.sendRequest(MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, 50) == MKSServoE::ERROR_OK;
+        progress = progress || outstanding[i];
+        continue;
+      }
+      CanFrame rx{};
+      if (axis.takeResponse(MKS::CMD_READ_ENCODER_ADDITION, rx) == MKSServoE::ERROR_OK) {
+        samples++;
+        outstanding[i] = false;
+        progress = true;
+      }
+    }
+    if (!progress) {
+      rig.group.poll();
+    }
+  }
+  const double telemetryElapsedUs = (double)(uint32_t)(micros() - start);
+  const double telemetryPerAxis = samples / (telemetryElapsedUs / 1e6) / axisCount;
+  const double telemetryUtilization = (double)rig.bus.stats().busyUs / telemetryElapsedUs;
+
+  printf("{\"bench\":\"bus\",\"bitrate\":%u,\"axes\":%u,"
+         "\"cmd_per_s\":%.1f,\"cmd_limit_per_s\":%.1f,\"cmd_failures\":%u,"
+         "\"cmd_latency_us_avg\":%.1f,\"cmd_latency_us_p99\":%u,\"cmd_bus_utilization\":%.3f,"
+         "\"telemetry_per_s_per_axis\":%.1f,\"telemetry_limit_per_s_per_axis\":%.1f,\"telemetry_bus_utilization\":%.3f,"
+         "\"host_ns_per_cmd\":%.0f,\"response_latency_us\":%u,\"jitter_us\":%u}\n",
+         bitrate, axisCount,
+         commands / (cmdElapsedUs / 1e6), cmdLimit, failures,
+         latencyAvg, latencyP99, cmdUtilization,
+         telemetryPerAxis, telemetryLimitPerAxis, telemetryUtilization,
+         commands ? realNs / commands : 0.0, rig.bus.config().responseLatencyUs, rig.bus.config().jitterUs);
+}
+} // namespace
+
+int main() {
+  HostClock::setVirtual(true);
+  for (uint32_t bitrate : BITRATES) {
+    for (uint8_t axisCount : AXIS_COUNTS) {
+      runCase(bitrate, axisCount);
+    }
+  }
+  return 0;
+}
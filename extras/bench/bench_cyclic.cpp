@@ -0,0 +1,109 @@
+// MKSCyclicExchange on one simulated 1 Mbit/s bus, run in real time: 4, 8 and 16 axes with a
+// speed setpoint plus encoder and speed reads each cycle, at 2, 5 and 10 ms periods with the
+// default 80 % load budget. Reports the load the full exchange needs, cycle start jitter,
+// overruns, missing replies, reads left out by the budget and the share of snapshots in which
+// every requested field of every axis was fresh. One JSON object per line on stdout.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -Isrc/host -Isrc extras/bench/bench_cyclic.cpp src/*.cpp src/host/*.cpp -o bench_cyclic
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+#include "MKSCyclicExchange.h"
+#include "MKSServoE.h"
+#include "MKSServoGroup.h"
+#include "host/SimCanBus.h"
+
+namespace {
+const uint32_t BITRATE = 1000000;
+const uint32_t WINDOW_MS = 1000;
+
+struct Rig {
+  SimCanBus bus;
+  MKSServoGroup group;
+  std::vector<SimServoNode *> nodes;
+  std::vector<MKSServoE *> axes;
+
+  explicit Rig(uint8_t axisCount) : bus(SimCanBus::defaultConfig()), group(bus) {
+    for (uint8_t a = 0; a < axisCount; a++) {
+      SimServoNode *node = new SimServoNode((uint16_t)(a + 1));
+      node->setBitrateCode((uint8_t)MKS::CanBitrate::Mbps1);
+      bus.attach(*node);
+      nodes.push_back(node);
+    }
+    bus.begin(BITRATE);
+    for (uint8_t a = 0; a < axisCount; a++) {
+      MKSServoE *axis = new MKSServoE(bus);
+      axis->setTargetId((uint16_t)(a + 1));
+      axis->setTxId((uint16_t)(a + 1));
+      group.addAxis(*axis);
+      axis->enable();
+      axes.push_back(axis);
+    }
+  }
+
+  ~Rig() {
+    for (MKSServoE *axis : axes) {
+      delete axis;
+    }
+    for (SimServoNode *node : nodes) {
+      delete node;
+    }
+  }
+};
+
+void runCase(uint8_t axisCount, uint32_t cycleUs) {
+  Rig rig(axisCount);
+  MKSCyclicExchange cycle(rig.group, BITRATE);
+  cycle.setCycleUs(cycleUs);
+  cycle.setTelemetry(MKSCyclicExchange::FIELD_ENCODER | MKSCyclicExchange::FIELD_SPEED);
+  for (uint8_t a = 0; a < axisCount; a++) {
+    cycle.setSpeedSetpoint(a, MKSUnits::Rpm(100 + 10 * a), 0);
+  }
+
+  uint32_t snapshots = 0;
+  uint32_t complete = 0;
+  uint64_t durationSumUs = 0;
+  uint32_t maxDurationUs = 0;
+  cycle.start();
+  const uint32_t end = millis() + WINDOW_MS;
+  while ((int32_t)(millis() - end) < 0) {
+    if (!cycle.update()) {
+      continue;
+    }
+    snapshots++;
+    const MKSCyclicExchange::CycleReport &report = cycle.lastReport();
+    durationSumUs += report.durationUs;
+    if (report.durationUs > maxDurationUs) {
+      maxDurationUs = report.durationUs;
+    }
+    bool fresh = true;
+    for (uint8_t a = 0; a < axisCount; a++) {
+      const MKSCyclicExchange::AxisSnapshot *s = cycle.snapshot(a);
+      fresh = fresh && s->valid == s->requested;
+    }
+    complete += fresh ? 1 : 0;
+  }
+  cycle.stop();
+
+  printf("{\"bench\":\"cyclic\",\"axes\":%u,\"cycle_us\":%u,\"required_permille\":%u,\"cycles\":%u,"
+         "\"overruns\":%u,\"late_cycles\":%u,\"missing\":%u,\"skipped_reads\":%u,\"mean_jitter_us\":%u,"
+         "\"max_jitter_us\":%u,\"mean_duration_us\":%u,\"max_duration_us\":%u,\"complete_snapshots\":%.3f}\n",
+         axisCount, cycleUs, cycle.requiredBudgetPermille(), cycle.cycles(), cycle.overruns(), cycle.lateCycles(),
+         cycle.missingReplies(), cycle.skippedReads(), cycle.meanJitterUs(), cycle.maxJitterUs(),
+         snapshots ? (uint32_t)(durationSumUs / snapshots) : 0, maxDurationUs,
+         snapshots ? (double)complete / snapshots : 0.0);
+  fflush(stdout);
+}
+}
+
+int main() {
+  const uint8_t axisCounts[] = { 4, 8, 16 };
+  const uint32_t cycles[] = { 2000, 5000, 10000 };
+  for (uint8_t axes : axisCounts) {
+    for (uint32_t cycleUs : cycles) {
+      runCase(axes, cycleUs);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+// Decode throughput of MKSBusMonitor against a fully loaded 1 Mbit/s bus.
+// A synthetic capture of 16 axes is fed back to back, direction unknown as on a real sniffer:
+//   motion    : speed-mode setpoints (F6) and their acks
+//   telemetry : encoder addition (0x31), speed (0x32) and position error (0x39) reads with replies
+//   mixed     : both, plus position-mode moves (F5) and EN-status heartbeats (0x3A)
+// Timestamps advance by the exact wire time of each frame (stuff bits included), so the frame
+// rate of each mix is what a saturated 1 Mbit/s bus carries; headroom is decode rate over it.
+// One JSON object per line on stdout.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -Isrc/host -Isrc extras/bench/bench_monitor.cpp src/*.cpp src/host/*.cpp -o bench_monitor
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "host/MKSBusMonitor.h"
+#include "protocol/MksCommands.h"
+#include "protocol/MksCrc.h"
+#include "protocol/MksPacking.h"
+#include "transport/CanTiming.h"
+
+namespace {
+const uint32_t BITRATE = 1000000;
+const uint8_t AXES = 16;
+const uint32_t FRAMES = 1u << 20;
+const uint8_t PASSES = 5;
+volatile uint64_t sink = 0;
+
+struct Timed {
+  CanFrame frame;
+  uint64_t timestampUs;
+};
+
+CanFrame frame(uint16_t id, uint8_t cmd, const uint8_t *payload, uint8_t len) {
+  CanFrame f{};
+  f.id = id;
+  f.dlc = (uint8_t)(len + 2);
+  f.data[0] = cmd;
+  for (uint8_t i = 0; i < len; i++) {
+    f.data[1 + i] = payload[i];
+  }
+  f.data[len + 1] = MKS::crc8_sum_plus1(f.data, len + 1);
+  return f;
+}
+
+// Appends one command and its reply for the given axis.
+void exchange(std::vector<CanFrame> &out, uint16_t id, uint8_t cmd, uint32_t n) {
+  uint8_t p[6] = { 0 };
+  const uint8_t ok[1] = { 1 };
+  switch (cmd) {
+    case MKS::CMD_SPEED_MODE: {
+      p[0] = (uint8_t)(n & 0x80);
+      p[1] = (uint8_t)n;
+      p[2] = 10;
+      out.push_back(frame(id, cmd, p, 3));
+      out.push_back(frame(id, cmd, ok, 1));
+      break;
+    }
+    case MKS::CMD_POS_MODE4_ABS_AXIS: {
+      MKS::put_u16_be(p, 600);
+      p[2] = 50;
+      MKS::put_i24_be(&p[3], (int32_t)(n * 64));
+      out.push_back(frame(id, cmd, p, 6));
+      out.push_back(frame(id, cmd, ok, 1));
+      break;
+    }
+    case MKS::CMD_READ_ENCODER_ADDITION: {
+      out.push_back(frame(id, cmd, nullptr, 0));
+      MKS::put_i48_be(p, (int64_t)n * 16);
+      out.push_back(frame(id, cmd, p, 6));
+      break;
+    }
+    case MKS::CMD_READ_SPEED_RPM: {
+      out.push_back(frame(id, cmd, nullptr, 0));
+      MKS::put_u16_be(p, (uint16_t)(n & 0x7FF));
+      out.push_back(frame(id, cmd, p, 2));
+      break;
+    }
+    case MKS::CMD_READ_POS_ERROR: {
+      out.push_back(frame(id, cmd, nullptr, 0));
+      MKS::put_u32_be(p, n & 0xFF);
+      out.push_back(frame(id, cmd, p, 4));
+      break;
+    }
+    default: {
+      out.push_back(frame(id, cmd, nullptr, 0));
+      out.push_back(frame(id, cmd, ok, 1));
+      break;
+    }
+  }
+}
+
+std::vector<Timed> build(const uint8_t *cmds, uint8_t cmdCount, double &framesPerSecond) {
+  std::vector<CanFrame> frames;
+  frames.reserve(FRAMES + 2);
+  for (uint32_t n = 0; frames.size() < FRAMES; n++) {
+    exchange(frames, (uint16_t)(1 + n % AXES), cmds[(n / AXES) % cmdCount], n);
+  }
+  std::vector<Timed> timed;
+  timed.reserve(frames.size());
+  uint64_t nowUs = 0;
+  uint64_t busyBits = 0;
+  for (const CanFrame &f : frames) {
+    timed.push_back({ f, nowUs });
+    const uint16_t bits = CanTiming::frameBits(f);
+    busyBits += bits;
+    nowUs += CanTiming::bitsToUs(bits, BITRATE);
+  }
+  framesPerSecond = (double)frames.size() * BITRATE / (double)busyBits;
+  return timed;
+}
+
+void run(const char *name, const uint8_t *cmds, uint8_t cmdCount) {
+  static MKSBusMonitor monitor;
+  double busFramesPerSecond = 0;
+  const std::vector<Timed> frames = build(cmds, cmdCount, busFramesPerSecond);
+  double bestNs = 0;
+  for (uint8_t pass = 0; pass < PASSES; pass++) {
+    monitor.reset();
+    const auto start = std::chrono::steady_clock::now();
+    for (const Timed &t : frames) {
+      sink += monitor.feed(t.frame, t.timestampUs).latencyUs;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / frames.size();
+    if (pass == 0 || ns < bestNs) {
+      bestNs = ns;
+    }
+  }
+  uint64_t matched = 0;
+  for (uint16_t id = 1; id <= AXES; id++) {
+    matched += monitor.nodeStats(id).latencyCount;
+  }
+  printf("{\"bench\":\"monitor\",\"case\":\"%s\",\"frames\":%zu,\"matched\":%llu,\"unknown\":%llu,"
+         "\"ns_per_frame\":%.2f,\"decode_frames_per_s\":%.0f,\"bus_frames_per_s\":%.0f,\"headroom\":%.1f}\n",
+         name, frames.size(), (unsigned long long)matched, (unsigned long long)monitor.unknownFrames(), bestNs,
+         1e9 / bestNs, busFramesPerSecond, 1e9 / bestNs / busFramesPerSecond);
+}
+}
+
+int main() {
+  const uint8_t motion[] = { MKS::CMD_SPEED_MODE };
+  const uint8_t telemetry[] = { MKS::CMD_READ_ENCODER_ADDITION, MKS::CMD_READ_SPEED_RPM, MKS::CMD_READ_POS_ERROR };
+  const uint8_t mixed[] = { MKS::CMD_SPEED_MODE, MKS::CMD_READ_ENCODER_ADDITION, MKS::CMD_POS_MODE4_ABS_AXIS,
+                            MKS::CMD_READ_POS_ERROR, MKS::CMD_READ_EN_STATUS };
+  run("motion", motion, sizeof(motion));
+  run("telemetry", telemetry, sizeof(telemetry));
+  run("mixed", mixed, sizeof(mixed));
+  return 0;
+}
@@ -0,0 +1,108 @@
+// Submission cost of the MKSIoThread request queue: 1, 2, 4 and 8 producer threads push
+// request-sized items into MKSMpscQueue while one consumer drains it, against the same traffic
+// through a std::mutex guarding a std::deque. Producers retry when the ring is full.
+// One JSON object per line on stdout, in ns per item (wall time / items).
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -Isrc/host -Isrc extras/bench/bench_mpsc.cpp -o bench_mpsc
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "host/MKSMpscQueue.h"
+
+namespace {
+const uint32_t ITEMS = 1u << 21;
+
+// Same size as MKSIoThread's request record.
+struct Item {
+  uint8_t axisIndex;
+  uint8_t cmd;
+  uint8_t payload[6];
+  uint8_t payloadLen;
+  bool requireStatusSuccess;
+  uint32_t timeoutMs;
+  void *callback;
+  void *context;
+  void *promise;
+};
+
+class MutexQueue {
+public:
+  bool push(const Item &item) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _items.push_back(item);
+    return true;
+  }
+
+  bool pop(Item &out) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_items.empty()) {
+      return false;
+    }
+    out = _items.front();
+    _items.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex _mutex;
+  std::deque<Item> _items;
+};
+
+template <typename Queue>
+void run(const char *name, Queue &queue, unsigned producers) {
+  const uint32_t perProducer = ITEMS / producers;
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; p++) {
+    threads.emplace_back([&queue, &go, p, perProducer]() {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      Item item{};
+      item.axisIndex = (uint8_t)p;
+      for (uint32_t i = 0; i < perProducer; i++) {
+        item.timeoutMs = i;
+        while (!queue.push(item)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  const uint32_t total = perProducer * producers;
+  uint64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  Item item;
+  for (uint32_t received = 0; received < total;) {
+    if (queue.pop(item)) {
+      checksum += item.timeoutMs;
+      received++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  printf("{\"bench\":\"%s\",\"producers\":%u,\"items\":%u,\"ns_per_item\":%.1f,\"checksum\":%llu}\n", name, producers,
+         total, seconds * 1e9 / total, (unsigned long long)checksum);
+}
+}
+
+int main() {
+  for (unsigned producers = 1; producers <= 8; producers *= 2) {
+    static MKSMpscQueue<Item, 256> mpsc;
+    run("mpsc_queue", mpsc, producers);
+    MutexQueue locked;
+    run("mutex_deque", locked, producers);
+  }
+  return 0;
+}
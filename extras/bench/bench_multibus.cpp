@@ -0,0 +1,160 @@
+// Scaling of MKSMultiBus / MKSMultiBusIo with the number of CAN interfaces: 1 to 4 simulated
+// 1 Mbit/s buses with 8 axes each, run in real time. Each round sends one command to every
+// axis on every bus and waits for all replies, either
+//   poll    : MKSMultiBus::run() on the calling thread (the MCU loop, one poll slice per bus)
+//   threads : MKSMultiBusIo::callAll() with one I/O thread per bus
+// for telemetry reads (encoder) and speed setpoints. Reports exchanges per second over all
+// axes and the ratio to a single bus. One JSON object per line on stdout.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -Isrc/host -Isrc extras/bench/bench_multibus.cpp src/*.cpp src/host/*.cpp -o bench_multibus
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+#include "MKSMultiBus.h"
+#include "MKSServoE.h"
+#include "MKSServoGroup.h"
+#include "host/MKSMultiBusIo.h"
+#include "host/SimCanBus.h"
+#include "protocol/MksCommands.h"
+
+namespace {
+const uint8_t MAX_BUSES = 4;
+const uint8_t AXES_PER_BUS = 8;
+const uint32_t WINDOW_MS = 500;
+
+struct Rig {
+  std::vector<SimCanBus *> buses;
+  std::vector<MKSServoGroup *> groups;
+  std::vector<SimServoNode *> nodes;
+  std::vector<MKSServoE *> axes;
+  MKSMultiBus multi;
+
+  explicit Rig(uint8_t busCount) {
+    SimCanBus::Config config = SimCanBus::defaultConfig();
+    for (uint8_t b = 0; b < busCount; b++) {
+      config.seed = 21 + b;
+      SimCanBus *bus = new SimCanBus(config);
+      for (uint8_t a = 0; a < AXES_PER_BUS; a++) {
+        SimServoNode *node = new SimServoNode((uint16_t)(a + 1));
+        node->setBitrateCode((uint8_t)MKS::CanBitrate::Mbps1);
+        bus->attach(*node);
+        nodes.push_back(node);
+      }
+      bus->begin(1000000);
+      buses.push_back(bus);
+      groups.push_back(new MKSServoGroup(*bus));
+      multi.addBus(*groups.back());
+    }
+    // Axes are assigned to the least loaded bus, which spreads them round-robin here.
+    for (uint8_t n = 0; n < busCount * AXES_PER_BUS; n++) {
+      const int8_t b = multi.leastLoadedBus();
+      MKSServoE *axis = new MKSServoE(*buses[b]);
+      const uint16_t id = (uint16_t)(groups[b]->axisCount() + 1);
+      axis->setTargetId(id);
+      axis->setTxId(id);
+      multi.addAxis((uint8_t)b, *axis);
+      axes.push_back(axis);
+    }
+    const uint8_t enable[1] = { 1 };
+    multi.run(MKS::CMD_ENABLE_BUS, enable, 1);
+  }
+
+  ~Rig() {
+    for (MKSServoE *axis : axes) {
+      delete axis;
+    }
+    for (MKSServoGroup *group : groups) {
+      delete group;
+    }
+    for (SimServoNode *node : nodes) {
+      delete node;
+    }
+    for (SimCanBus *bus : buses) {
+      delete bus;
+    }
+  }
+};
+
+struct Command {
+  const char *name;
+  uint8_t cmd;
+  uint8_t payloadLen;
+  bool requireStatusSuccess;
+};
+
+const Command COMMANDS[] = {
+  { "encoder", MKS::CMD_READ_ENCODER_ADDITION, 0, false },
+  { "setpoint", MKS::CMD_SPEED_MODE, 3, true },
+};
+
+double baseline[2][2];
+
+void report(const char *mode, uint8_t modeIndex, uint8_t commandIndex, uint8_t buses, uint32_t exchanges,
+            uint32_t failures, uint32_t elapsedMs) {
+  const double perSecond = exchanges * 1000.0 / elapsedMs;
+  if (buses == 1) {
+    baseline[modeIndex][commandIndex] = perSecond;
+  }
+  printf("{\"bench\":\"multibus\",\"mode\":\"%s\",\"command\":\"%s\",\"buses\":%u,\"axes\":%u,\"exchanges_per_s\":%.0f,"
+         "\"failed\":%u,\"scaling\":%.2f}\n",
+         mode, COMMANDS[commandIndex].name, buses, buses * AXES_PER_BUS, perSecond, failures,
+         baseline[modeIndex][commandIndex] > 0 ? perSecond / baseline[modeIndex][commandIndex] : 0.0);
+}
+
+void fillSetpoints(uint8_t *payloads, uint8_t axes, uint32_t round) {
+  for (uint8_t i = 0; i < axes; i++) {
+    const uint16_t rpm = (uint16_t)(100 + (round + i) % 400);
+    payloads[i * 3] = (uint8_t)((rpm >> 8) & 0x0F);
+    payloads[i * 3 + 1] = (uint8_t)(rpm & 0xFF);
+    payloads[i * 3 + 2] = 20;
+  }
+}
+
+void runPoll(uint8_t busCount, uint8_t commandIndex) {
+  Rig rig(busCount);
+  const Command &c = COMMANDS[commandIndex];
+  uint8_t payloads[MKSMultiBus::MAX_AXES * 3];
+  uint32_t exchanges = 0;
+  uint32_t failures = 0;
+  const uint32_t start = millis();
+  for (uint32_t round = 0; millis() - start < WINDOW_MS; round++) {
+    fillSetpoints(payloads, rig.multi.axisCount(), round);
+    rig.multi.run(c.cmd, payloads, c.payloadLen, c.payloadLen, c.requireStatusSuccess);
+    exchanges += rig.multi.axisCount();
+    failures += rig.multi.axisCount() - rig.multi.succeeded();
+  }
+  report("poll", 0, commandIndex, busCount, exchanges, failures, millis() - start);
+}
+
+void runThreads(uint8_t busCount, uint8_t commandIndex) {
+  Rig rig(busCount);
+  const Command &c = COMMANDS[commandIndex];
+  MKSMultiBusIo io(rig.multi);
+  io.start();
+  uint8_t payloads[MKSMultiBus::MAX_AXES * 3];
+  MKSMultiBusIo::Response replies[MKSMultiBus::MAX_AXES];
+  uint32_t exchanges = 0;
+  const uint32_t start = millis();
+  for (uint32_t round = 0; millis() - start < WINDOW_MS; round++) {
+    fillSetpoints(payloads, rig.multi.axisCount(), round);
+    io.callAll(c.cmd, payloads, c.payloadLen, c.payloadLen, replies, 50, c.requireStatusSuccess);
+    exchanges += rig.multi.axisCount();
+  }
+  const uint32_t elapsed = millis() - start;
+  io.stop();
+  report("threads", 1, commandIndex, busCount, exchanges, io.failed(), elapsed);
+}
+}
+
+int main() {
+  for (uint8_t c = 0; c < 2; c++) {
+    for (uint8_t buses = 1; buses <= MAX_BUSES; buses++) {
+      runPoll(buses, c);
+    }
+    for (uint8_t buses = 1; buses <= MAX_BUSES; buses++) {
+      runThreads(buses, c);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,212 @@
+// Microbenchmarks for the protocol codec and the response-queue hot paths:
+// crc8_sum_plus1, the MksPacking.h helpers, findSlot, allocateSlot, enqueueFrame/popFrame,
+// poll() and pollAnyResponse() under three frame mixes:
+//   telemetry : steady 0x31/0x32/0x39 answers, each consumed right after it arrives
+//   burst     : a burst of position-mode active reports on one command
+//   eviction  : more distinct commands than RESPONSE_QUEUE_SLOTS, never consumed
+// Frames come from an in-memory replay bus so only driver cost is measured.
+// One JSON object per line on stdout, in ns per operation (or per frame).
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -Isrc/host -Isrc extras/bench/bench_queue.cpp src/*.cpp src/host/*.cpp -o bench_queue
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "MKSServoE.h"
+#include "protocol/MksCrc.h"
+#include "protocol/MksPacking.h"
+
+struct MKSServoEBenchAccess {
+  static int8_t findSlot(MKSServoE &s, uint8_t cmd) { return s.findSlot(cmd); }
+  static int8_t allocateSlot(MKSServoE &s, uint8_t cmd) { return s.allocateSlot(cmd); }
+  static void enqueueFrame(MKSServoE &s, uint8_t slot, const CanFrame &f) { s.enqueueFrame(slot, f); }
+  static bool popFrame(MKSServoE &s, uint8_t slot, CanFrame &f) { return s.popFrame(slot, f); }
+};
+
+namespace {
+using Access = MKSServoEBenchAccess;
+const uint16_t NODE_ID = 0x01;
+volatile uint32_t sink = 0;
+
+// Endless ICanBus source replaying a fixed frame list.
+class ReplayBus : public ICanBus {
+public:
+  explicit ReplayBus(const std::vector<CanFrame> &frames) : _frames(frames), _next(0), _budget(0) {}
+  void allow(uint32_t frames) { _budget = frames; }
+  bool begin(uint32_t) override { return true; }
+  bool send(const CanFrame &) override { return true; }
+  bool available() override { return _budget > 0; }
+  bool read(CanFrame &out) override {
+    if (_budget == 0) {
+      return false;
+    }
+    _budget--;
+    out = _frames[_next];
+    _next = (_next + 1) % _frames.size();
+    return true;
+  }
+  void setFilter(uint16_t, uint16_t) override {}
+
+private:
+  const std::vector<CanFrame> &_frames;
+  size_t _next;
+  uint32_t _budget;
+};
+
+CanFrame response(uint8_t cmd, uint8_t len) {
+  CanFrame f{};
+  f.id = NODE_ID;
+  f.dlc = len;
+  f.data[0] = cmd;
+  for (uint8_t i = 1; i + 1 < len; i++) {
+    f.data[i] = (uint8_t)(cmd + i);
+  }
+  f.data[len - 1] = MKS::crc8_sum_plus1(f.data, len - 1);
+  return f;
+}
+
+template <typename Fn>
+double timeNs(uint32_t iterations, Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) {
+    fn(i);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+}
+
+void report(const char *name, double ns) {
+  printf("{\"bench\":\"queue\",\"case\":\"%s\",\"ns_per_op\":%.2f}\n", name, ns);
+}
+
+void codec() {
+  const uint32_t n = 2000000;
+  uint8_t buf[8] = { 0x31, 0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x00 };
+  report("crc8_sum_plus1_7B", timeNs(n, [&](uint32_t i) {
+    buf[1] = (uint8_t)i;
+    sink += MKS::crc8_sum_plus1(buf, 7);
+  }));
+  report("put_get_u16_be", timeNs(n, [&](uint32_t i) {
+    MKS::put_u16_be(buf, (uint16_t)i);
+    sink += MKS::get_u16_be(buf);
+  }));
+  report("put_get_u32_be", timeNs(n, [&](uint32_t i) {
+    MKS::put_u32_be(buf, i);
+    sink += MKS::get_u32_be(buf);
+  }));
+  report("put_get_i24_be", timeNs(n, [&](uint32_t i) {
+    MKS::put_i24_be(buf, (int32_t)i - 8000000);
+    sink += (uint32_t)MKS::get_i24_be(buf);
+  }));
+  report("put_get_i48_be", timeNs(n, [&](uint32_t i) {
+    MKS::put_i48_be(buf, (int64_t)i * -977);
+    sink += (uint32_t)MKS::get_i48_be(buf);
+  }));
+}
+
+void slots() {
+  const uint32_t n = 1000000;
+  std::vector<CanFrame> none;
+  ReplayBus bus(none);
+  MKSServoE servo(bus);
+  // Plain FIFO everywhere so every eviction below has a victim regardless of the default policies.
+  for (uint16_t cmd = 0; cmd < 256; cmd++) {
+    servo.setResponsePolicy((uint8_t)cmd, MKSServoE::RESPONSE_POLICY_FIFO);
+  }
+
+  // Fill every slot so lookups walk a full table.
+  for (uint8_t i = 0; i < MKSServoE::RESPONSE_QUEUE_SLOTS; i++) {
+    const uint8_t cmd = (uint8_t)(0x80 + i);
+    int8_t slot = Access::allocateSlot(servo, cmd);
+    Access::enqueueFrame(servo, (uint8_t)slot, response(cmd, 3));
+  }
+  const uint8_t lastCmd = (uint8_t)(0x80 + MKSServoE::RESPONSE_QUEUE_SLOTS - 1);
+  report("findSlot_hit_last", timeNs(n, [&](uint32_t) { sink += (uint32_t)Access::findSlot(servo, lastCmd); }));
+  report("findSlot_miss", timeNs(n, [&](uint32_t) { sink += (uint32_t)Access::findSlot(servo, 0x31); }));
+  report("allocateSlot_existing", timeNs(n, [&](uint32_t) { sink += (uint32_t)Access::allocateSlot(servo, lastCmd); }));
+
+  // Every allocation of a new command has to evict the oldest slot.
+  const CanFrame evictFrame = response(0x10, 3);
+  report("allocateSlot_evict", timeNs(n, [&](uint32_t i) {
+    CanFrame f = evictFrame;
+    f.data[0] = (uint8_t)(0x10 + (i % 64));
+    int8_t slot = Access::allocateSlot(servo, f.data[0]);
+    Access::enqueueFrame(servo, (uint8_t)slot, f);
+  }));
+
+  MKSServoE fresh(bus);
+  int8_t slot = Access::allocateSlot(fresh, MKS::CMD_READ_SPEED_RPM);
+  const CanFrame speed = response(MKS::CMD_READ_SPEED_RPM, 4);
+  report("enqueue_pop_pair", timeNs(n, [&](uint32_t) {
+    CanFrame out{};
+    Access::enqueueFrame(fresh, (uint8_t)slot, speed);
+    Access::popFrame(fresh, (uint8_t)slot, out);
+    slot = Access::allocateSlot(fresh, MKS::CMD_READ_SPEED_RPM);
+    sink += out.data[1];
+  }));
+}
+
+void mixes() {
+  const uint32_t frames = 1000000;
+
+  std::vector<CanFrame> telemetry = {
+    response(MKS::CMD_READ_ENCODER_ADDITION, 8),
+    response(MKS::CMD_READ_SPEED_RPM, 4),
+    response(MKS::CMD_READ_POS_ERROR, 6),
+  };
+  {
+    ReplayBus bus(telemetry);
+    MKSServoE servo(bus);
+    report("poll_pollResponse_telemetry_per_frame", timeNs(frames, [&](uint32_t i) {
+      bus.allow(1);
+      CanFrame rx{};
+      servo.pollResponse(telemetry[i % telemetry.size()].data[0], rx);
+      sink += rx.dlc;
+    }));
+  }
+
+  std::vector<CanFrame> burst;
+  for (uint8_t i = 0; i < 16; i++) {
+    CanFrame f = response(MKS::CMD_POS_MODE4_ABS_AXIS, 3);
+    f.data[1] = (uint8_t)(i % 3);
+    f.data[2] = MKS::crc8_sum_plus1(f.data, 2);
+    burst.push_back(f);
+  }
+  {
+    ReplayBus bus(burst);
+    MKSServoE servo(bus);
+    report("poll_burst_per_frame", timeNs(frames / 16, [&](uint32_t) {
+      bus.allow(16);
+      servo.poll(16);
+    }) / 16);
+    report("pollAnyResponse_burst_per_frame", timeNs(frames, [&](uint32_t) {
+      bus.allow(1);
+      uint8_t cmd = 0;
+      CanFrame rx{};
+      servo.pollAnyResponse(cmd, rx);
+      sink += cmd;
+    }));
+  }
+
+  std::vector<CanFrame> eviction;
+  for (uint8_t i = 0; i < 2 * MKSServoE::RESPONSE_QUEUE_SLOTS; i++) {
+    eviction.push_back(response((uint8_t)(0x80 + i), 3));
+  }
+  {
+    ReplayBus bus(eviction);
+    MKSServoE servo(bus);
+    report("poll_eviction_per_frame", timeNs(frames / 16, [&](uint32_t) {
+      bus.allow(16);
+      servo.poll(16);
+    }) / 16);
+  }
+}
+} // namespace
+
+int main() {
+  codec();
+  slots();
+  mixes();
+  return sink == 0xFFFFFFFFu ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// Host demo for MKSBusMonitor.
+//   bus_monitor                 runs a short session on the simulated bus and prints every frame
+//                               as the monitor decodes it, both directions, with ack latency
+//   bus_monitor -w FILE         same, and records the session to a capture file
+//   bus_monitor FILE            decodes a capture file
+// A per-node summary follows the events.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -Isrc/host -Isrc extras/host/bus_monitor.cpp src/*.cpp src/host/*.cpp -o bus_monitor
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "MKSServoE.h"
+#include "host/MKSBusMonitor.h"
+#include "host/MKSCapture.h"
+#include "host/SimCanBus.h"
+
+namespace {
+// Stands in for a listen-only adapter on the same wire: every frame the driver sends or
+// receives is shown to the monitor without telling it the direction.
+class TapCanBus : public ICanBus {
+public:
+  TapCanBus(SimCanBus &bus, MKSBusMonitor &monitor, MKSCaptureWriter &capture)
+  : _bus(bus), _monitor(monitor), _capture(capture) {}
+
+  bool begin(uint32_t bitrate) override { return _bus.begin(bitrate); }
+  bool available() override { return _bus.available(); }
+  void setFilter(uint16_t id, uint16_t mask) override { _bus.setFilter(id, mask); }
+
+  bool send(const CanFrame &f) override {
+    if (!_bus.send(f)) {
+      return false;
+    }
+    tap(f, MKSCapture::FLAG_DIR_KNOWN | MKSCapture::FLAG_TO_DRIVE);
+    return true;
+  }
+
+  bool read(CanFrame &out) override {
+    if (!_bus.read(out)) {
+      return false;
+    }
+    tap(out, MKSCapture::FLAG_DIR_KNOWN);
+    return true;
+  }
+
+private:
+  SimCanBus &_bus;
+  MKSBusMonitor &_monitor;
+  MKSCaptureWriter &_capture;
+
+  void tap(const CanFrame &f, uint8_t flags) {
+    const uint64_t now = HostClock::nowUs();
+    _monitor.feed(f, now);
+    _capture.write(f, now, flags);
+  }
+};
+
+const char *kindName(MKSBusMonitor::Kind kind) {
+  switch (kind) {
+    case MKSBusMonitor::KIND_COMMAND:  return "cmd";
+    case MKSBusMonitor::KIND_RESPONSE: return "rsp";
+    default:                           return "???";
+  }
+}
+
+void printEvent(void *, const MKSBusMonitor::Event &ev) {
+  printf("%10llu  %03X %s %-22s", (unsigned long long)ev.timestampUs, ev.nodeId, kindName(ev.kind),
+         ev.info ? ev.info->name : "?");
+  switch (ev.layout) {
+    case MKSBusMonitor::LAYOUT_STATUS:     printf(" status=%lld", (long long)ev.value); break;
+    case MKSBusMonitor::LAYOUT_CARRY:      printf(" carry=%lld value=%u", (long long)ev.value, ev.aux); break;
+    case MKSBusMonitor::LAYOUT_SPEED:      printf(" dir=%u rpm=%u acc=%u", ev.dir, ev.speedRpm, ev.acc); break;
+    case MKSBusMonitor::LAYOUT_SPEED_AXIS: printf(" dir=%u rpm=%u acc=%u axis=%lld", ev.dir, ev.speedRpm, ev.acc, (long long)ev.value); break;
+    case MKSBusMonitor::LAYOUT_VERSION:    printf(" series=%u fw=%06llX", ev.code, (unsigned long long)ev.value); break;
+    case MKSBusMonitor::LAYOUT_PARAM:      printf(" param=%02X", ev.code); break;
+    case MKSBusMonitor::LAYOUT_NONE:
+    case MKSBusMonitor::LAYOUT_RAW:        break;
+    default:                               printf(" value=%lld", (long long)ev.value); break;
+  }
+  if (ev.matched) {
+    printf("  latency=%u us", (unsigned)ev.latencyUs);
+  }
+  if (!ev.crcOk) {
+    printf("  BAD CRC");
+  }
+  printf("\n");
+}
+
+void printSummary(const MKSBusMonitor &monitor) {
+  for (uint16_t id = 0; id <= MKSBusMonitor::MAX_NODE_ID; id++) {
+    const MKSBusMonitor::NodeStats &st = monitor.nodeStats(id);
+    if (st.commands == 0 && st.responses == 0) {
+      continue;
+    }
+    printf("node %03X: commands=%u responses=%u unsolicited=%u unanswered=%u crc=%u", id, st.commands,
+           st.responses, st.unsolicited, st.unanswered, st.crcErrors);
+    if (st.latencyCount) {
+      printf(" latency us min/avg/max=%u/%llu/%u", st.latencyMinUs,
+             (unsigned long long)(st.latencySumUs / st.latencyCount), st.latencyMaxUs);
+    }
+    printf("\n");
+  }
+  printf("frames=%llu unknown=%llu\n", (unsigned long long)monitor.frames(),
+         (unsigned long long)monitor.unknownFrames());
+}
+
+int runSimulation(MKSBusMonitor &monitor, const char *capturePath) {
+  HostClock::setVirtual(true);
+  SimCanBus::Config config = SimCanBus::defaultConfig();
+  config.jitterUs = 150;
+  config.crcCorruptRate = 0.02f;
+  config.seed = 3;
+  SimCanBus sim(config);
+  SimServoNode node1(0x01);
+  SimServoNode node2(0x02);
+  sim.attach(node1);
+  sim.attach(node2);
+
+  MKSCaptureWriter capture;
+  if (capturePath && !capture.open(capturePath, 500000)) {
+    printf("cannot write %s\n", capturePath);
+    return 1;
+  }
+  TapCanBus bus(sim, monitor, capture);
+  if (!bus.begin(500000)) {
+    printf("CAN init failed\n");
+    return 1;
+  }
+
+  MKSServoE servo(bus);
+  uint8_t status = 0;
+  for (uint16_t id = 1; id <= 2; id++) {
+    servo.setTargetId(id);
+    servo.setTxId(id);
+    MKSServoE::VersionInfo info;
+    servo.readVersionInfo(info);
+    servo.setMode(0x05, status);
+    servo.enable();
+    servo.runSpeed(id & 1, 300, 10, status);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint16_t id = 1; id <= 2; id++) {
+      servo.setTargetId(id);
+      servo.setTxId(id);
+      int64_t position = 0;
+      int16_t rpm = 0;
+      servo.readEncoderAddition(position);
+      servo.readSpeedRpm(rpm);
+    }
+  }
+  servo.setTargetId(0x01);
+  servo.setTxId(0x01);
+  servo.runPositionMode4AbsoluteAxis(600, 50, 0x4000, status);
+  servo.emergencyStop(status);
+  if (capturePath) {
+    printf("%llu frames written to %s\n", (unsigned long long)capture.records(), capturePath);
+  }
+  return 0;
+}
+}
+
+int main(int argc, char **argv) {
+  static MKSBusMonitor monitor;
+  monitor.setEventHandler(printEvent);
+
+  int rc = 0;
+  if (argc == 2 && strcmp(argv[1], "-w") != 0) {
+    MKSCaptureReader reader;
+    if (!reader.open(argv[1])) {
+      printf("cannot read capture %s\n", argv[1]);
+      return 1;
+    }
+    monitor.replay(reader);
+  } else {
+    rc = runSimulation(monitor, (argc == 3 && strcmp(argv[1], "-w") == 0) ? argv[2] : nullptr);
+  }
+  printSummary(monitor);
+  return rc;
+}
@@ -0,0 +1,156 @@
+// Host demo: hundreds of concurrent command sequences written as coroutines (MKSCoroutines.h).
+// 8 simulated buses with 16 axes each; every axis runs an enable/configure/move/verify
+// sequence plus a speed monitor, all on one thread through a single MKSScheduler.
+//
+// Build (from the repository root):
+//   g++ -std=c++20 -O2 -Isrc/host -Isrc extras/host/coroutine_demo.cpp src/*.cpp src/host/*.cpp -o coroutine_demo
+#include <Arduino.h>
+#include <stdio.h>
+#include "MKSServoE.h"
+#include "MKSServoGroup.h"
+#include "MKSStartupSequencer.h"
+#include "host/MKSCoroutines.h"
+#include "host/SimCanBus.h"
+#include "protocol/MksPacking.h"
+
+namespace {
+const uint8_t BUSES = 8;
+const uint8_t AXES_PER_BUS = 16;
+
+struct Axis {
+  MKSServoE *servo;
+  bool moving;
+  uint16_t peakRpm;
+  int64_t finalPosition;
+};
+
+MKSTask configure(MKSScheduler &sched, MKSServoE &servo) {
+  const MKSStartupSequencer::Step steps[] = {
+    MKSStartupSequencer::enableStep(),
+    MKSStartupSequencer::modeStep(5),
+    MKSStartupSequencer::currentStep(1600),
+    MKSStartupSequencer::microstepStep(16),
+  };
+  for (const MKSStartupSequencer::Step &step : steps) {
+    MKSScheduler::Response r = co_await sched.request(servo, step);
+    if (r.rc != MKSServoE::ERROR_OK) {
+      co_return r.rc;
+    }
+  }
+  co_return MKSServoE::ERROR_OK;
+}
+
+MKSTask moveAndVerify(MKSScheduler &sched, Axis &axis, int32_t target) {
+  MKSServoE &servo = *axis.servo;
+  MKSServoE::ERROR rc = co_await configure(sched, servo);
+  if (rc != MKSServoE::ERROR_OK) {
+    co_return rc;
+  }
+
+  uint8_t payload[6];
+  const uint16_t rpm = 1200;
+  payload[0] = (uint8_t)((rpm >> 8) & 0x7F);
+  payload[1] = (uint8_t)(rpm & 0xFF);
+  payload[2] = 200;
+  MKS::put_i24_be(&payload[3], target);
+  MKSScheduler::Response r = co_await sched.request(servo, MKS::CMD_POS_MODE4_ABS_AXIS, payload, 6, 50, true);
+  if (r.rc != MKSServoE::ERROR_OK) {
+    co_return r.rc;
+  }
+  axis.moving = true;
+  // Status 2 is the active "position reached" report sent by the drive.
+  r = co_await sched.response(servo, MKS::CMD_POS_MODE4_ABS_AXIS, 10000);
+  axis.moving = false;
+  if (r.rc != MKSServoE::ERROR_OK || r.status() != 2) {
+    co_return r.rc != MKSServoE::ERROR_OK ? r.rc : MKSServoE::ERROR_BAD_RESPONSE;
+  }
+
+  r = co_await sched.request(servo, MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, 50, false);
+  if (r.rc != MKSServoE::ERROR_OK) {
+    co_return r.rc;
+  }
+  axis.finalPosition = MKS::get_i48_be(&r.frame.data[1]);
+  co_return axis.finalPosition == target ? MKSServoE::ERROR_OK : MKSServoE::ERROR_BAD_RESPONSE;
+}
+
+MKSTask monitorSpeed(MKSScheduler &sched, Axis &axis) {
+  // Wait for the move to start, then sample the speed every 20 ms until it ends.
+  while (!axis.moving) {
+    co_await sched.sleep(5);
+  }
+  while (axis.moving) {
+    MKSScheduler::Response r = co_await sched.request(*axis.servo, MKS::CMD_READ_SPEED_RPM, nullptr, 0, 50, false);
+    if (r.rc == MKSServoE::ERROR_OK) {
+      int16_t rpm = (int16_t)MKS::get_u16_be(&r.frame.data[1]);
+      uint16_t magnitude = (uint16_t)(rpm < 0 ? -rpm : rpm);
+      if (magnitude > axis.peakRpm) {
+        axis.peakRpm = magnitude;
+      }
+    }
+    co_await sched.sleep(20);
+  }
+  co_return MKSServoE::ERROR_OK;
+}
+} // namespace
+
+int main() {
+  HostClock::setVirtual(true);
+
+  SimCanBus::Config config = SimCanBus::defaultConfig();
+  SimCanBus *buses[BUSES];
+  SimServoNode *nodes[BUSES][AXES_PER_BUS];
+  MKSServoGroup *groups[BUSES];
+  Axis axes[BUSES * AXES_PER_BUS];
+  MKSScheduler sched;
+
+  for (uint8_t b = 0; b < BUSES; b++) {
+    config.seed = 11 + b;
+    buses[b] = new SimCanBus(config);
+    groups[b] = new MKSServoGroup(*buses[b]);
+    for (uint8_t a = 0; a < AXES_PER_BUS; a++) {
+      nodes[b][a] = new SimServoNode((uint16_t)(a + 1));
+      nodes[b][a]->setBitrateCode((uint8_t)MKS::CanBitrate::Mbps1);
+      buses[b]->attach(*nodes[b][a]);
+    }
+    buses[b]->begin(1000000);
+    for (uint8_t a = 0; a < AXES_PER_BUS; a++) {
+      Axis &axis = axes[b * AXES_PER_BUS + a];
+      axis.servo = new MKSServoE(*buses[b]);
+      axis.servo->setTargetId((uint16_t)(a + 1));
+      axis.servo->setTxId((uint16_t)(a + 1));
+      groups[b]->addAxis(*axis.servo);
+      axis.moving = false;
+      axis.peakRpm = 0;
+      axis.finalPosition = 0;
+      sched.spawn(moveAndVerify(sched, axis, 0x4000 * (a + 1)));
+      sched.spawn(monitorSpeed(sched, axis));
+    }
+  }
+
+  printf("tasks started: %u\n", (unsigned)sched.activeTasks());
+  const uint32_t start = millis();
+  MKSServoE::ERROR rc = sched.run(30000);
+  printf("run rc=%d after %u ms (simulated): finished=%u failed=%u\n", rc, millis() - start, sched.finishedTasks(), sched.failedTasks());
+
+  uint16_t peak = 0;
+  for (const Axis &axis : axes) {
+    if (axis.peakRpm > peak) {
+      peak = axis.peakRpm;
+    }
+  }
+  printf("last axis position=%lld, highest sampled speed=%u rpm\n", (long long)axes[BUSES * AXES_PER_BUS - 1].finalPosition, peak);
+
+  for (uint8_t b = 0; b < BUSES; b++) {
+    for (uint8_t a = 0; a < AXES_PER_BUS; a++) {
+      delete nodes[b][a];
+    }
+  }
+  for (Axis &axis : axes) {
+    delete axis.servo;
+  }
+  for (uint8_t b = 0; b < BUSES; b++) {
+    delete groups[b];
+    delete buses[b];
+  }
+  return rc == MKSServoE::ERROR_OK && sched.failedTasks() == 0 ? 0 : 1;
+}
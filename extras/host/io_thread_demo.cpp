@@ -0,0 +1,171 @@
+// Host demo for MKSIoThread: several application threads share one bus without locking it.
+// 4 simulated axes in real time; for about one second
+//   - a motion thread sends speed setpoints to every axis each 5 ms and waits on the futures,
+//   - a telemetry thread requests encoder readings with a callback each 2 ms,
+//   - a UI thread does blocking calls (enable status) each 50 ms.
+// Prints per-thread request counts, failures and the round-trip times seen by the callers.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -Isrc/host -Isrc extras/host/io_thread_demo.cpp src/*.cpp src/host/*.cpp -o io_thread_demo
+#include <Arduino.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include "MKSServoE.h"
+#include "MKSServoGroup.h"
+#include "MKSStartupSequencer.h"
+#include "host/MKSIoThread.h"
+#include "host/SimCanBus.h"
+#include "protocol/MksCommands.h"
+#include "protocol/MksPacking.h"
+
+namespace {
+const uint8_t AXES = 4;
+const uint32_t RUN_MS = 1000;
+
+struct Stats {
+  uint32_t requests;
+  uint32_t failures;
+  uint32_t maxUs;
+  uint64_t sumUs;
+
+  void add(MKSServoE::ERROR rc, uint32_t us) {
+    requests++;
+    if (rc != MKSServoE::ERROR_OK) {
+      failures++;
+    }
+    sumUs += us;
+    if (us > maxUs) {
+      maxUs = us;
+    }
+  }
+};
+
+void print(const char *name, const Stats &st) {
+  printf("%-10s requests=%u failed=%u round trip us avg/max=%llu/%u\n", name, st.requests, st.failures,
+         (unsigned long long)(st.requests ? st.sumUs / st.requests : 0), st.maxUs);
+}
+
+void motion(MKSIoThread &io, Stats &st) {
+  const uint32_t end = millis() + RUN_MS;
+  for (uint16_t tick = 0; millis() < end; tick++) {
+    const uint16_t rpm = (uint16_t)(100 + (tick % 50) * 10);
+    uint8_t payload[3];
+    payload[0] = (uint8_t)((rpm >> 8) & 0x0F);
+    payload[1] = (uint8_t)(rpm & 0xFF);
+    payload[2] = 20;
+    const uint64_t start = HostClock::nowUs();
+    std::future<MKSIoThread::Response> replies[AXES];
+    for (uint8_t a = 0; a < AXES; a++) {
+      replies[a] = io.request(a, MKS::CMD_SPEED_MODE, payload, 3);
+    }
+    for (uint8_t a = 0; a < AXES; a++) {
+      st.add(replies[a].get().rc, (uint32_t)(HostClock::nowUs() - start));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+struct Telemetry {
+  Stats stats;
+  std::atomic<uint32_t> pending;
+  int64_t position[AXES];
+  uint64_t sentUs[AXES];
+};
+
+void onEncoder(void *context, uint8_t axisIndex, uint8_t, const MKSIoThread::Response &r) {
+  Telemetry &t = *(Telemetry *)context;
+  if (r.rc == MKSServoE::ERROR_OK) {
+    t.position[axisIndex] = MKS::get_i48_be(&r.frame.data[1]);
+  }
+  t.stats.add(r.rc, (uint32_t)(HostClock::nowUs() - t.sentUs[axisIndex]));
+  t.pending.fetch_sub(1, std::memory_order_release);
+}
+
+void telemetry(MKSIoThread &io, Telemetry &t) {
+  const uint32_t end = millis() + RUN_MS;
+  while (millis() < end) {
+    // One round at a time: the callback owns sentUs[] while a reading is outstanding.
+    if (t.pending.load(std::memory_order_acquire) == 0) {
+      for (uint8_t a = 0; a < AXES; a++) {
+        t.pending.fetch_add(1, std::memory_order_relaxed);
+        t.sentUs[a] = HostClock::nowUs();
+        if (io.request(a, MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, onEncoder, &t, 50, false) != MKSServoE::ERROR_OK) {
+          t.pending.fetch_sub(1, std::memory_order_relaxed);
+          t.stats.add(MKSServoE::ERROR_BUS_SEND, 0);
+        }
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  while (t.pending.load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
+}
+
+void ui(MKSIoThread &io, Stats &st) {
+  const uint32_t end = millis() + RUN_MS;
+  for (uint8_t a = 0; millis() < end; a = (uint8_t)((a + 1) % AXES)) {
+    const uint64_t start = HostClock::nowUs();
+    const MKSIoThread::Response r = io.call(a, MKS::CMD_READ_EN_STATUS, nullptr, 0, 50, false);
+    st.add(r.rc, (uint32_t)(HostClock::nowUs() - start));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+} // namespace
+
+int main() {
+  SimCanBus sim(SimCanBus::defaultConfig());
+  SimServoNode *nodes[AXES];
+  MKSServoE *servos[AXES];
+  MKSServoGroup group(sim);
+  for (uint8_t a = 0; a < AXES; a++) {
+    nodes[a] = new SimServoNode((uint16_t)(a + 1));
+    nodes[a]->setBitrateCode((uint8_t)MKS::CanBitrate::Mbps1);
+    sim.attach(*nodes[a]);
+  }
+  if (!sim.begin(1000000)) {
+    printf("CAN init failed\n");
+    return 1;
+  }
+  for (uint8_t a = 0; a < AXES; a++) {
+    servos[a] = new MKSServoE(sim);
+    servos[a]->setTargetId((uint16_t)(a + 1));
+    servos[a]->setTxId((uint16_t)(a + 1));
+    group.addAxis(*servos[a]);
+  }
+
+  MKSIoThread io(group);
+  io.start();
+  for (uint8_t a = 0; a < AXES; a++) {
+    io.request(a, MKSStartupSequencer::modeStep(5)).get();
+    io.request(a, MKSStartupSequencer::enableStep()).get();
+  }
+
+  Stats motionStats = {};
+  Stats uiStats = {};
+  static Telemetry telemetryState = {};
+  std::thread motionThread(motion, std::ref(io), std::ref(motionStats));
+  std::thread telemetryThread(telemetry, std::ref(io), std::ref(telemetryState));
+  std::thread uiThread(ui, std::ref(io), std::ref(uiStats));
+  motionThread.join();
+  telemetryThread.join();
+  uiThread.join();
+  io.stop();
+
+  print("motion", motionStats);
+  print("telemetry", telemetryState.stats);
+  print("ui", uiStats);
+  for (uint8_t a = 0; a < AXES; a++) {
+    printf("axis %u position=%lld\n", a, (long long)telemetryState.position[a]);
+  }
+  printf("io thread: completed=%u failed=%u rejected=%u\n", io.completed(), io.failed(), io.rejected());
+
+  for (uint8_t a = 0; a < AXES; a++) {
+    delete servos[a];
+    delete nodes[a];
+  }
+  return io.failed() == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Offline analysis of a capture file (MKSCapture.h, e.g. written by bus_monitor -w).
+//   log_analyzer FILE [-j THREADS] [-w WINDOW_MS] [-b BITRATE] [-csv DIR]
+// Prints bus-wide and per-axis statistics; with -csv it also writes the per-axis time series
+// as DIR/axis_<id>_<series>.csv.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -Isrc/host -Isrc extras/host/log_analyzer.cpp src/*.cpp src/host/*.cpp -o log_analyzer
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "host/MKSCapture.h"
+#include "host/MKSLogAnalyzer.h"
+
+namespace {
+template <typename T>
+bool writeCsv(const char *dir, uint16_t id, const char *name, const std::vector<uint64_t> &us,
+              const std::vector<T> &values) {
+  if (us.empty()) {
+    return true;
+  }
+  char path[512];
+  snprintf(path, sizeof(path), "%s/axis_%03X_%s.csv", dir, id, name);
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  fprintf(f, "timestamp_us,%s\n", name);
+  for (size_t i = 0; i < us.size(); i++) {
+    fprintf(f, "%llu,%lld\n", (unsigned long long)us[i], (long long)values[i]);
+  }
+  fclose(f);
+  return true;
+}
+
+bool writeStatusCsv(const char *dir, const MKSLogAnalyzer::Axis &axis) {
+  const MKSLogAnalyzer::AxisSeries &s = axis.series;
+  if (s.statusUs.empty()) {
+    return true;
+  }
+  char path[512];
+  snprintf(path, sizeof(path), "%s/axis_%03X_status.csv", dir, axis.id);
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  fprintf(f, "timestamp_us,cmd,status\n");
+  for (size_t i = 0; i < s.statusUs.size(); i++) {
+    fprintf(f, "%llu,0x%02X,%u\n", (unsigned long long)s.statusUs[i], s.statusCmd[i], s.status[i]);
+  }
+  fclose(f);
+  return true;
+}
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("usage: %s FILE [-j THREADS] [-w WINDOW_MS] [-b BITRATE] [-csv DIR]\n", argv[0]);
+    return 2;
+  }
+  MKSLogAnalyzer::Options options = MKSLogAnalyzer::defaultOptions();
+  options.series = false;
+  const char *csvDir = nullptr;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-j") == 0) {
+      options.threads = (uint8_t)atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-w") == 0) {
+      options.loadWindowUs = (uint32_t)atoi(argv[i + 1]) * 1000u;
+    } else if (strcmp(argv[i], "-b") == 0) {
+      options.bitrate = (uint32_t)atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-csv") == 0) {
+      csvDir = argv[i + 1];
+      options.series = true;
+    }
+  }
+
+  MKSCaptureMap capture;
+  if (!capture.open(argv[1])) {
+    printf("cannot map capture %s\n", argv[1]);
+    return 1;
+  }
+  MKSLogAnalyzer::Result result;
+  const auto start = std::chrono::steady_clock::now();
+  if (!MKSLogAnalyzer::analyze(capture, options, result)) {
+    printf("nothing to analyze in %s\n", argv[1]);
+    return 1;
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("frames=%llu crc_errors=%llu unknown=%llu span=%.3f s threads=%u analysis=%.3f s (%.1f Mframes/s)\n",
+         (unsigned long long)result.frames, (unsigned long long)result.crcErrors,
+         (unsigned long long)result.unknownFrames, (result.lastUs - result.firstUs) / 1e6, result.threads, seconds,
+         result.frames / seconds / 1e6);
+  if (result.bitrate) {
+    printf("bitrate=%u load avg=%.1f%% peak=%.1f%% (%u ms windows)\n", result.bitrate, result.averageLoad * 100,
+           result.peakLoad * 100, options.loadWindowUs / 1000);
+  }
+  printf("latency us p50<=%u p99<=%u max=%u\n", result.latencyP50Us, result.latencyP99Us, result.latencyMaxUs);
+  for (const MKSLogAnalyzer::Axis &axis : result.axes) {
+    const MKSBusMonitor::NodeStats &st = axis.stats;
+    printf("axis %03X: commands=%u responses=%u unsolicited=%u unanswered=%u crc=%u", axis.id, st.commands,
+           st.responses, st.unsolicited, st.unanswered, st.crcErrors);
+    if (st.latencyCount) {
+      printf(" latency us min/avg/max=%u/%llu/%u", st.latencyMinUs,
+             (unsigned long long)(st.latencySumUs / st.latencyCount), st.latencyMaxUs);
+    }
+    printf("\n");
+    if (csvDir) {
+      const MKSLogAnalyzer::AxisSeries &s = axis.series;
+      if (!writeCsv(csvDir, axis.id, "speed_rpm", s.speedUs, s.speedRpm) ||
+          !writeCsv(csvDir, axis.id, "encoder_addition", s.encoderUs, s.encoder) ||
+          !writeCsv(csvDir, axis.id, "position_error", s.posErrorUs, s.posError) ||
+          !writeStatusCsv(csvDir, axis)) {
+        printf("cannot write series to %s\n", csvDir);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
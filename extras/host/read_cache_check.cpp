@@ -0,0 +1,71 @@
+// Host check: one driver addressing several nodes with the read cache and deduplication on.
+// Reads after setTargetId/setTxId must never be answered from another node's frame. Exits
+// non-zero on the first failed check.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -Isrc/host -Isrc extras/host/read_cache_check.cpp src/*.cpp src/host/*.cpp -o read_cache_check
+#include <Arduino.h>
+#include <stdio.h>
+#include "MKSServoE.h"
+#include "host/SimCanBus.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+  printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+  if (!ok) {
+    failures++;
+  }
+}
+
+static void select(MKSServoE &servo, uint16_t id) {
+  servo.setTargetId(id);
+  servo.setTxId(id);
+}
+
+int main() {
+  HostClock::setVirtual(true);
+
+  SimCanBus bus(SimCanBus::defaultConfig());
+  SimServoNode node1(0x01);
+  node1.setBitrateCode((uint8_t)MKS::CanBitrate::Mbps1);
+  bus.attach(node1);
+  if (!bus.begin(1000000)) {
+    printf("CAN init failed\n");
+    return 1;
+  }
+
+  MKSServoE servo(bus);
+  servo.setReadCacheMaxAgeMs(100);
+  select(servo, 0x01);
+  check(servo.enable() == MKSServoE::ERROR_OK, "enable node 1");
+
+  // Cached frames of node 1 must not answer reads to the missing node 2.
+  uint8_t enable = 0;
+  MKSServoE::VersionInfo info{};
+  check(servo.readEnStatus(enable) == MKSServoE::ERROR_OK, "node 1 enable status");
+  check(servo.readVersionInfo(info) == MKSServoE::ERROR_OK, "node 1 version");
+  select(servo, 0x02);
+  check(servo.readEnStatus(enable) == MKSServoE::ERROR_TIMEOUT, "node 2 enable status times out");
+  check(servo.readVersionInfo(info) == MKSServoE::ERROR_TIMEOUT, "node 2 version times out");
+
+  // The same through the non-blocking path, with a request to node 1 still pending.
+  select(servo, 0x01);
+  check(servo.sendRequest(MKS::CMD_READ_EN_STATUS, nullptr, 0) == MKSServoE::ERROR_OK, "node 1 request");
+  select(servo, 0x02);
+  check(servo.readEnStatus(enable) == MKSServoE::ERROR_TIMEOUT, "node 2 does not share node 1's request");
+  select(servo, 0x01);
+  check(servo.readEnStatus(enable) == MKSServoE::ERROR_OK, "node 1 again");
+
+  // The probe must stop at the missing node before node 1 is switched.
+  const uint16_t nodes[] = { 0x01, 0x02 };
+  MKSServoE::BitrateMigrationReport report{};
+  MKSServoE::ERROR rc = servo.migrateBitrate(nodes, 2, (uint8_t)MKS::CanBitrate::Mbps1,
+                                             (uint8_t)MKS::CanBitrate::Kbps500, &report);
+  check(rc == MKSServoE::ERROR_TIMEOUT && report.failedIndex == 1 && report.switchedCount == 0,
+        "bitrate migration fails at the probe of node 2");
+  check(node1.bitrateCode() == (uint8_t)MKS::CanBitrate::Mbps1, "node 1 keeps its bitrate");
+
+  printf("%d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+// Host demo for the shared-memory telemetry segment (MKSTelemetryShm.h).
+//   telemetry_shm publish [SECONDS]   drives 4 simulated axes in real time (speed moves plus a
+//                                     20 ms telemetry poll) and publishes every reply through
+//                                     MKSTelemetryTapBus to /mks-telemetry (default 10 s)
+//   telemetry_shm read [COUNT]        in another terminal: prints the segment every 200 ms
+//   telemetry_shm                     both at once, publisher on a second thread, 2 s
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -Isrc/host -Isrc extras/host/telemetry_shm.cpp src/*.cpp src/host/*.cpp -o telemetry_shm
+// (older glibc also needs -lrt for shm_open)
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "MKSServoE.h"
+#include "MKSServoGroup.h"
+#include "host/MKSTelemetryShm.h"
+#include "host/SimCanBus.h"
+
+namespace {
+const char *SEGMENT = "/mks-telemetry";
+const uint8_t AXES = 4;
+
+std::atomic<bool> published(false);
+
+int publish(uint32_t seconds) {
+  SimCanBus sim(SimCanBus::defaultConfig());
+  SimServoNode *nodes[AXES];
+  for (uint8_t a = 0; a < AXES; a++) {
+    nodes[a] = new SimServoNode((uint16_t)(a + 1));
+    nodes[a]->setBitrateCode((uint8_t)MKS::CanBitrate::Mbps1);
+    sim.attach(*nodes[a]);
+  }
+  MKSTelemetryPublisher telemetry;
+  if (!telemetry.open(SEGMENT, AXES)) {
+    printf("cannot create %s\n", SEGMENT);
+    return 1;
+  }
+  MKSTelemetryTapBus bus(sim, telemetry);
+  if (!bus.begin(1000000)) {
+    printf("CAN init failed\n");
+    return 1;
+  }
+  MKSServoGroup group(bus);
+  MKSServoE *servos[AXES];
+  for (uint8_t a = 0; a < AXES; a++) {
+    servos[a] = new MKSServoE(bus);
+    servos[a]->setTargetId((uint16_t)(a + 1));
+    servos[a]->setTxId((uint16_t)(a + 1));
+    group.addAxis(*servos[a]);
+    telemetry.setNodeId(a, (uint16_t)(a + 1));
+    uint8_t status = 0;
+    servos[a]->setMode(0x05, status);
+    servos[a]->enable();
+  }
+  published = true;
+
+  // The application's own reads: each reply also lands in the segment through the tap.
+  const uint32_t end = millis() + seconds * 1000;
+  for (uint32_t tick = 0; millis() < end; tick++) {
+    for (uint8_t a = 0; a < AXES; a++) {
+      MKSServoE &servo = *servos[a];
+      uint8_t status = 0;
+      if (tick % 100 == 0) {
+        servo.runSpeed((uint8_t)((tick / 100 + a) & 1), (uint16_t)(200 + 100 * a), 10, status);
+      }
+      int64_t position = 0;
+      int16_t rpm = 0;
+      int32_t error = 0;
+      servo.readEncoderAddition(position);
+      servo.readSpeedRpm(rpm);
+      servo.readPositionError(error);
+      if (tick % 10 == 0) {
+        uint8_t io = 0;
+        uint8_t stall = 0;
+        servo.readIoStatus(io);
+        servo.readStallState(stall);
+      }
+    }
+    delay(20);
+  }
+  for (uint8_t a = 0; a < AXES; a++) {
+    delete servos[a];
+    delete nodes[a];
+  }
+  return 0;
+}
+
+int read(uint32_t count) {
+  MKSTelemetryReader reader;
+  if (!reader.open(SEGMENT)) {
+    printf("cannot open %s (is a publisher running?)\n", SEGMENT);
+    return 1;
+  }
+  for (uint32_t n = 0; n < count; n++) {
+    const uint64_t now = MKSTelemetryShm::nowUs();
+    printf("publishes=%llu last=%llu us ago\n", (unsigned long long)reader.publishes(),
+           (unsigned long long)(now - reader.lastPublishUs()));
+    for (uint16_t i = 0; i < reader.axisCount(); i++) {
+      MKSTelemetryShm::Sample s;
+      if (!reader.read(i, s)) {
+        printf("  slot %u busy\n", i);
+        continue;
+      }
+      printf("  node %03X encoder=%lld rpm=%d pos_err=%d io=%02X stall=%u age_ms=%llu updates=%u\n", s.nodeId,
+             (long long)s.encoderAddition, s.speedRpm, (int)s.positionError, s.ioStatus, s.stallState,
+             (unsigned long long)((now - s.encoderUs) / 1000), s.updates);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  return 0;
+}
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "publish") == 0) {
+    return publish(argc >= 3 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 10);
+  }
+  if (argc >= 2 && strcmp(argv[1], "read") == 0) {
+    return read(argc >= 3 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 0xFFFFFFFFu);
+  }
+  std::thread publisher(publish, 2);
+  while (!published) {
+    std::this_thread::yield();
+  }
+  const int rc = read(8);
+  publisher.join();
+  return rc;
+}
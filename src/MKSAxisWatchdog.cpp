@@ -0,0 +1,136 @@
+#include <Arduino.h>
+#include "MKSAxisWatchdog.h"
+#include "transport/CanTiming.h"
+
+MKSAxisWatchdog::MKSAxisWatchdog(MKSServoGroup &group, uint32_t bitrate)
+: _group(group), _axes(), _handler(nullptr), _context(nullptr), _bitrate(bitrate), _intervalMs(50), _silenceMs(250),
+  _budgetPermille(20), _budgetUs(0), _lastBudgetUs(0), _heartbeatsSent(0), _heartbeatsDeferred(0), _heartbeatBusUs(0) {}
+
+void MKSAxisWatchdog::setEventHandler(EventHandler handler, void *context) {
+  _handler = handler;
+  _context = context;
+}
+
+uint32_t MKSAxisWatchdog::heartbeatCostUs() const {
+  return CanTiming::bitsToUs((uint32_t)CanTiming::worstCaseBits(2) + CanTiming::worstCaseBits(3), _bitrate);
+}
+
+uint16_t MKSAxisWatchdog::requiredBudgetPermille() const {
+  if (_intervalMs == 0) {
+    return 1000;
+  }
+  // Every axis quiet: one exchange per axis per interval.
+  const uint32_t needUs = heartbeatCostUs() * _group.axisCount();
+  const uint32_t permille = (needUs + _intervalMs - 1) / _intervalMs;
+  return permille > 1000 ? 1000 : (uint16_t)permille;
+}
+
+void MKSAxisWatchdog::start() {
+  const uint32_t now = millis();
+  _lastBudgetUs = micros();
+  // Start with one heartbeat per axis so a fresh watchdog can check every axis at once.
+  _budgetUs = heartbeatCostUs() * _group.axisCount();
+  for (uint8_t i = 0; i < MKSServoGroup::MAX_AXES; i++) {
+    AxisState &st = _axes[i];
+    MKSServoE *axis = _group.axis(i);
+    st.rxFrames = axis ? axis->rxFrames() : 0;
+    st.lastSeenMs = now;
+    st.lastHeartbeatMs = now - _intervalMs;
+    st.waiting = false;
+    st.deferred = false;
+    st.silent = false;
+    st.restartReported = false;
+  }
+}
+
+bool MKSAxisWatchdog::silent(uint8_t axisIndex) const {
+  return axisIndex < MKSServoGroup::MAX_AXES && _axes[axisIndex].silent;
+}
+
+uint32_t MKSAxisWatchdog::silentForMs(uint8_t axisIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return 0;
+  }
+  return millis() - _axes[axisIndex].lastSeenMs;
+}
+
+void MKSAxisWatchdog::raise(uint8_t axisIndex, Event event) {
+  if (_handler) {
+    _handler(_context, axisIndex, event);
+  }
+}
+
+void MKSAxisWatchdog::refillBudget(uint32_t nowUs) {
+  const uint32_t elapsedUs = nowUs - _lastBudgetUs;
+  _lastBudgetUs = nowUs;
+  // Never bank more than one heartbeat per axis, so an idle period cannot fund a burst.
+  const uint32_t cap = heartbeatCostUs() * _group.axisCount();
+  const uint64_t budget = _budgetUs + (uint64_t)elapsedUs * _budgetPermille / 1000u;
+  _budgetUs = budget > cap ? cap : (uint32_t)budget;
+}
+
+void MKSAxisWatchdog::collect(uint8_t axisIndex, AxisState &st, MKSServoE &axis, uint32_t now) {
+  uint8_t enabled = 0;
+  MKSServoE::ERROR rc = axis.pollStatusResponse(MKS::CMD_READ_EN_STATUS, enabled);
+  if (rc == MKSServoE::ERROR_OK) {
+    st.waiting = false;
+    if (enabled == 0 && axis.requestedEnable() == 1) {
+      if (!st.restartReported) {
+        st.restartReported = true;
+        raise(axisIndex, EVENT_RESTARTED);
+      }
+    } else {
+      st.restartReported = false;
+    }
+  } else if ((uint32_t)(now - st.lastHeartbeatMs) > _intervalMs) {
+    // The reply is lost; ask again and let the silence check decide whether the axis is gone.
+    st.waiting = false;
+  }
+}
+
+void MKSAxisWatchdog::update() {
+  _group.poll();
+  const uint32_t now = millis();
+  refillBudget(micros());
+  const uint32_t cost = heartbeatCostUs();
+
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    AxisState &st = _axes[i];
+    MKSServoE &axis = *_group.axis(i);
+
+    if (st.waiting) {
+      collect(i, st, axis, now);
+    }
+    const uint32_t rx = axis.rxFrames();
+    if (rx != st.rxFrames) {
+      st.rxFrames = rx;
+      st.lastSeenMs = now;
+      if (st.silent) {
+        st.silent = false;
+        raise(i, EVENT_ALIVE);
+      }
+    } else if (!st.silent && (uint32_t)(now - st.lastSeenMs) > _silenceMs) {
+      st.silent = true;
+      raise(i, EVENT_SILENT);
+    }
+
+    if (st.waiting || (uint32_t)(now - st.lastSeenMs) < _intervalMs || (uint32_t)(now - st.lastHeartbeatMs) < _intervalMs) {
+      continue;
+    }
+    if (_budgetUs < cost) {
+      if (!st.deferred) {
+        st.deferred = true;
+        _heartbeatsDeferred++;
+      }
+      continue;
+    }
+    if (axis.sendRequest(MKS::CMD_READ_EN_STATUS, nullptr, 0, _intervalMs) == MKSServoE::ERROR_OK) {
+      st.waiting = true;
+      st.deferred = false;
+      st.lastHeartbeatMs = now;
+      _budgetUs -= cost;
+      _heartbeatsSent++;
+      _heartbeatBusUs += cost;
+    }
+  }
+}
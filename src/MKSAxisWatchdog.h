@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoGroup.h"
+
+// Liveness watchdog for every axis of a group. Any valid frame from an axis counts as proof of
+// life; only an axis that has been quiet for the heartbeat interval is sent a heartbeat
+// (CMD_READ_EN_STATUS, 2-byte request, 3-byte reply), so busy axes cost nothing. Heartbeats
+// are paced by a bus-load budget and deferred when it is used up. A heartbeat reply is awaited
+// for one interval before the next heartbeat is sent.
+//
+// An axis is reported SILENT once nothing arrived for the silence timeout, i.e. at most
+// silenceTimeoutMs plus one update() period after its last frame. It is reported RESTARTED
+// when the heartbeat shows the drive disabled although the last CMD_ENABLE_BUS sent to it
+// enabled it: drives power up disabled, so this catches a reboot too short to go silent.
+class MKSAxisWatchdog {
+public:
+  enum Event : uint8_t {
+    EVENT_SILENT = 0,   // nothing received for the silence timeout
+    EVENT_ALIVE,        // frames again after EVENT_SILENT
+    EVENT_RESTARTED     // enabled axis reports itself disabled
+  };
+
+  typedef void (*EventHandler)(void *context, uint8_t axisIndex, Event event);
+
+  MKSAxisWatchdog(MKSServoGroup &group, uint32_t bitrate);
+
+  void setEventHandler(EventHandler handler, void *context = nullptr);
+  // Quiet time before an axis gets a heartbeat; default 50 ms.
+  void setHeartbeatIntervalMs(uint16_t intervalMs) { _intervalMs = intervalMs; }
+  // Detection time for a silent axis; default 250 ms. Keep it a few heartbeat intervals long.
+  void setSilenceTimeoutMs(uint16_t timeoutMs) { _silenceMs = timeoutMs; }
+  // Share of bus time heartbeats may use, in permille; default 20 (2 %). Below
+  // requiredBudgetPermille() quiet axes miss heartbeats and may be reported SILENT while alive.
+  void setLoadBudgetPermille(uint16_t permille) { _budgetPermille = permille; }
+  // Budget that covers a heartbeat per axis per interval when every axis is quiet.
+  uint16_t requiredBudgetPermille() const;
+  void setBitrate(uint32_t bitrate) { _bitrate = bitrate; }
+
+  // Treats every axis as just seen and clears pending heartbeats.
+  void start();
+  // Non-blocking: reads the bus, collects heartbeat replies, sends due heartbeats and raises
+  // events. Call it at least every few milliseconds.
+  void update();
+
+  bool silent(uint8_t axisIndex) const;
+  // Milliseconds since the axis was last heard from.
+  uint32_t silentForMs(uint8_t axisIndex) const;
+  uint32_t heartbeatsSent() const { return _heartbeatsSent; }
+  // Heartbeats postponed because the load budget was used up (once per heartbeat).
+  uint32_t heartbeatsDeferred() const { return _heartbeatsDeferred; }
+  // Wire time of the heartbeats sent so far, requests and replies.
+  uint32_t heartbeatBusUs() const { return _heartbeatBusUs; }
+  // Wire time of one heartbeat exchange at the configured bitrate.
+  uint32_t heartbeatCostUs() const;
+
+private:
+  struct AxisState {
+    uint32_t rxFrames;
+    uint32_t lastSeenMs;
+    uint32_t lastHeartbeatMs;
+    bool waiting;
+    bool deferred;
+    bool silent;
+    bool restartReported;
+  };
+
+  MKSServoGroup &_group;
+  AxisState _axes[MKSServoGroup::MAX_AXES];
+  EventHandler _handler;
+  void *_context;
+  uint32_t _bitrate;
+  uint16_t _intervalMs;
+  uint16_t _silenceMs;
+  uint16_t _budgetPermille;
+  uint32_t _budgetUs;
+  uint32_t _lastBudgetUs;
+  uint32_t _heartbeatsSent;
+  uint32_t _heartbeatsDeferred;
+  uint32_t _heartbeatBusUs;
+
+  void raise(uint8_t axisIndex, Event event);
+  void refillBudget(uint32_t nowUs);
+  void collect(uint8_t axisIndex, AxisState &st, MKSServoE &axis, uint32_t now);
+};
@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include "MKSBusHealthMonitor.h"
+
+MKSBusHealthMonitor::MKSBusHealthMonitor(ICanBus &bus)
+: _bus(bus), _status{CanErrorState::Active, 0, 0}, _handler(nullptr), _context(nullptr), _policy(RECOVERY_AUTO),
+  _abortOnBusOff(true), _retryDelayMs(10), _maxRetryDelayMs(1000), _stableMs(1000), _attempts(0), _busOffMs(0),
+  _nextAttemptMs(0), _backOnMs(0), _busOffCount(0), _recoveries(0), _failedRecoveries(0), _lastDowntimeMs(0),
+  _totalDowntimeMs(0) {}
+
+void MKSBusHealthMonitor::setTransitionHandler(TransitionHandler handler, void *context) {
+  _handler = handler;
+  _context = context;
+}
+
+uint32_t MKSBusHealthMonitor::retryDelay() const {
+  if (_attempts == 0) {
+    return 0;
+  }
+  uint32_t delayMs = _retryDelayMs;
+  for (uint8_t i = 1; i < _attempts && delayMs < _maxRetryDelayMs; i++) {
+    delayMs *= 2;
+  }
+  return delayMs < _maxRetryDelayMs ? delayMs : _maxRetryDelayMs;
+}
+
+void MKSBusHealthMonitor::transition(const CanErrorStatus &next, uint32_t now) {
+  const CanErrorState from = _status.state;
+  _status = next;
+  if (next.state == CanErrorState::BusOff) {
+    _busOffCount++;
+    _busOffMs = now;
+    if ((uint32_t)(now - _backOnMs) >= _stableMs) {
+      _attempts = 0;
+    }
+    _nextAttemptMs = now + retryDelay();
+    if (_abortOnBusOff) {
+      _bus.abortPendingTx();
+    }
+  } else if (from == CanErrorState::BusOff) {
+    _lastDowntimeMs = now - _busOffMs;
+    _totalDowntimeMs += _lastDowntimeMs;
+    _backOnMs = now;
+    _recoveries++;
+  }
+  if (_handler) {
+    _handler(_context, from, next.state);
+  }
+}
+
+bool MKSBusHealthMonitor::update() {
+  CanErrorStatus next;
+  if (!_bus.errorStatus(next)) {
+    return false;
+  }
+  uint32_t now = millis();
+  if (next.state != _status.state) {
+    transition(next, now);
+  } else {
+    _status = next;
+  }
+  if (_status.state == CanErrorState::BusOff && _policy == RECOVERY_AUTO && (int32_t)(now - _nextAttemptMs) >= 0) {
+    recoverNow();
+    now = millis();
+    if (_attempts < 255) {
+      _attempts++;
+    }
+    _nextAttemptMs = now + retryDelay();
+  }
+  return true;
+}
+
+bool MKSBusHealthMonitor::recoverNow() {
+  const bool ok = _bus.recover();
+  if (!ok) {
+    _failedRecoveries++;
+  }
+  CanErrorStatus next;
+  if (_bus.errorStatus(next) && next.state != _status.state) {
+    transition(next, millis());
+  }
+  return ok;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+#include "transport/ICanBus.h"
+
+// Watches the adapter's error state (ICanBus::errorStatus) and reports every transition.
+// With automatic recovery a bus-off controller is brought back with ICanBus::recover() right
+// away; if it falls off the bus again soon after, each further attempt waits twice as long
+// (up to maxRetryDelayMs) so a shorted or mis-terminated bus is not hammered. Frames still
+// queued when the controller went bus-off are dropped by default so stale setpoints are not
+// sent once it is back.
+class MKSBusHealthMonitor {
+public:
+  enum RecoveryPolicy : uint8_t {
+    RECOVERY_AUTO = 0,  // recover() as described above
+    RECOVERY_MANUAL     // only report; the sketch calls recoverNow() or the controller recovers itself
+  };
+
+  typedef void (*TransitionHandler)(void *context, CanErrorState from, CanErrorState to);
+
+  explicit MKSBusHealthMonitor(ICanBus &bus);
+
+  void setTransitionHandler(TransitionHandler handler, void *context = nullptr);
+  void setRecoveryPolicy(RecoveryPolicy policy) { _policy = policy; }
+  // Delay before the second attempt in a row; default 10 ms, doubling up to maxRetryDelayMs.
+  void setRetryDelayMs(uint16_t firstMs, uint16_t maxMs) { _retryDelayMs = firstMs; _maxRetryDelayMs = maxMs; }
+  // Time on the bus after which a new bus-off counts as a first attempt again; default 1 s.
+  void setStableMs(uint16_t stableMs) { _stableMs = stableMs; }
+  void setAbortOnBusOff(bool enable) { _abortOnBusOff = enable; }
+
+  // Reads the error state, raises transitions and runs recovery. Returns false if the adapter
+  // cannot report its error state.
+  bool update();
+  // Calls ICanBus::recover() regardless of policy and backoff.
+  bool recoverNow();
+
+  CanErrorState state() const { return _status.state; }
+  const CanErrorStatus &status() const { return _status; }
+  uint32_t busOffCount() const { return _busOffCount; }
+  uint32_t recoveries() const { return _recoveries; }
+  uint32_t failedRecoveries() const { return _failedRecoveries; }
+  // Bus-off time of the last completed bus-off period and of all periods.
+  uint32_t lastDowntimeMs() const { return _lastDowntimeMs; }
+  uint32_t totalDowntimeMs() const { return _totalDowntimeMs; }
+
+private:
+  ICanBus &_bus;
+  CanErrorStatus _status;
+  TransitionHandler _handler;
+  void *_context;
+  RecoveryPolicy _policy;
+  bool _abortOnBusOff;
+  uint16_t _retryDelayMs;
+  uint16_t _maxRetryDelayMs;
+  uint16_t _stableMs;
+  uint8_t _attempts;
+  uint32_t _busOffMs;
+  uint32_t _nextAttemptMs;
+  uint32_t _backOnMs;
+  uint32_t _busOffCount;
+  uint32_t _recoveries;
+  uint32_t _failedRecoveries;
+  uint32_t _lastDowntimeMs;
+  uint32_t _totalDowntimeMs;
+
+  void transition(const CanErrorStatus &next, uint32_t now);
+  uint32_t retryDelay() const;
+};
@@ -0,0 +1,365 @@
+#include <Arduino.h>
+#include "MKSCyclicExchange.h"
+#include "protocol/MksPacking.h"
+#include "transport/CanTiming.h"
+
+MKSCyclicExchange::MKSCyclicExchange(MKSServoGroup &group, uint32_t bitrate)
+: _group(group), _bitrate(bitrate), _cycleUs(10000), _budgetPermille(800), _telemetry(FIELD_ENCODER | FIELD_SPEED),
+  _handler(nullptr), _context(nullptr), _setpoints(), _running(false), _inCycle(false), _nextStartUs(0), _cycleStartUs(0),
+  _frames(), _frameCount(0), _sendIndex(0), _openFrames(0), _readCursor(0), _working(), _snapshot(), _snapshotCycle(0),
+  _current(), _report(), _cycles(0), _overruns(0), _lateCycles(0), _missingReplies(0), _skippedReads(0), _maxJitterUs(0),
+  _jitterSumUs(0) {}
+
+void MKSCyclicExchange::setCycleHandler(CycleHandler handler, void *context) {
+  _handler = handler;
+  _context = context;
+}
+
+bool MKSCyclicExchange::setSpeedSetpoint(uint8_t axisIndex, MKSUnits::Rpm speed, uint8_t acc) {
+  if (axisIndex >= _group.axisCount()) {
+    return false;
+  }
+  const uint16_t rpm = MKSUnits::speedField(speed);
+  Setpoint &sp = _setpoints[axisIndex];
+  sp.payload[0] = (uint8_t)((MKSUnits::directionOf(speed.value) ? MKS::BUS_DIR_BIT : 0) | ((rpm >> 8) & MKS::BUS_SPEED_HI_NIBBLE_MSK));
+  sp.payload[1] = (uint8_t)(rpm & 0xFF);
+  sp.payload[2] = acc;
+  sp.payloadLen = 3;
+  sp.kind = SETPOINT_SPEED;
+  return true;
+}
+
+bool MKSCyclicExchange::setPositionSetpoint(uint8_t axisIndex, MKSUnits::Counts absAxis, MKSUnits::Rpm speed, uint8_t acc) {
+  if (axisIndex >= _group.axisCount() || absAxis.value < MKS::AXIS_FIELD_MIN || absAxis.value > MKS::AXIS_FIELD_MAX) {
+    return false;
+  }
+  const uint16_t rpm = MKSUnits::speedField(speed);
+  Setpoint &sp = _setpoints[axisIndex];
+  sp.payload[0] = (uint8_t)((rpm >> 8) & MKS::BUS_SPEED_HI_NIBBLE_MSK);
+  sp.payload[1] = (uint8_t)(rpm & 0xFF);
+  sp.payload[2] = acc;
+  MKS::put_i24_be(&sp.payload[3], (int32_t)absAxis.value);
+  sp.payloadLen = 6;
+  sp.kind = SETPOINT_POSITION;
+  return true;
+}
+
+void MKSCyclicExchange::clearSetpoint(uint8_t axisIndex) {
+  if (axisIndex < MKSServoGroup::MAX_AXES) {
+    _setpoints[axisIndex].kind = SETPOINT_NONE;
+  }
+}
+
+uint8_t MKSCyclicExchange::fieldCommand(uint8_t field) {
+  switch (field) {
+    case FIELD_ENCODER: return MKS::CMD_READ_ENCODER_ADDITION;
+    case FIELD_SPEED: return MKS::CMD_READ_SPEED_RPM;
+    case FIELD_POS_ERROR: return MKS::CMD_READ_POS_ERROR;
+    case FIELD_IO: return MKS::CMD_READ_IO_STATUS;
+    case FIELD_ENABLE: return MKS::CMD_READ_EN_STATUS;
+    default: return 0;
+  }
+}
+
+uint8_t MKSCyclicExchange::replyDlc(uint8_t cmd) {
+  switch (cmd) {
+    case MKS::CMD_READ_ENCODER_ADDITION: return 8;
+    case MKS::CMD_READ_POS_ERROR: return 6;
+    case MKS::CMD_READ_SPEED_RPM: return 4;
+    default: return 3;
+  }
+}
+
+uint32_t MKSCyclicExchange::frameCostUs(uint8_t requestDlc, uint8_t cmd) const {
+  return CanTiming::bitsToUs((uint32_t)CanTiming::worstCaseBits(requestDlc) + CanTiming::worstCaseBits(replyDlc(cmd)), _bitrate);
+}
+
+uint32_t MKSCyclicExchange::setpointCostUs(uint8_t axisIndex) const {
+  const Setpoint &sp = _setpoints[axisIndex];
+  if (sp.kind == SETPOINT_NONE) {
+    return 0;
+  }
+  return frameCostUs((uint8_t)(sp.payloadLen + 2), sp.kind == SETPOINT_SPEED ? MKS::CMD_SPEED_MODE : MKS::CMD_POS_MODE4_ABS_AXIS);
+}
+
+uint32_t MKSCyclicExchange::readsCostUs() const {
+  uint32_t perAxis = 0;
+  for (uint8_t f = 0; f < READ_FIELDS; f++) {
+    if (_telemetry & (1 << f)) {
+      perAxis += frameCostUs(2, fieldCommand((uint8_t)(1 << f)));
+    }
+  }
+  return perAxis * _group.axisCount();
+}
+
+uint16_t MKSCyclicExchange::requiredBudgetPermille() const {
+  uint32_t needUs = readsCostUs();
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    needUs += setpointCostUs(i);
+  }
+  const uint64_t permille = ((uint64_t)needUs * 1000u + _cycleUs - 1) / _cycleUs;
+  return permille > 1000 ? 1000 : (uint16_t)permille;
+}
+
+void MKSCyclicExchange::start() {
+  _running = true;
+  _inCycle = false;
+  _nextStartUs = micros();
+  _frameCount = 0;
+  _sendIndex = 0;
+  _openFrames = 0;
+  _readCursor = 0;
+  _snapshotCycle = 0;
+  _current = CycleReport();
+  _report = CycleReport();
+  _cycles = 0;
+  _overruns = 0;
+  _lateCycles = 0;
+  _missingReplies = 0;
+  _skippedReads = 0;
+  _maxJitterUs = 0;
+  _jitterSumUs = 0;
+}
+
+void MKSCyclicExchange::stop() {
+  // Replies still outstanding expire in the driver after one cycle.
+  _running = false;
+  _inCycle = false;
+}
+
+const MKSCyclicExchange::AxisSnapshot *MKSCyclicExchange::snapshot(uint8_t axisIndex) const {
+  return axisIndex < _group.axisCount() ? &_snapshot[axisIndex] : nullptr;
+}
+
+bool MKSCyclicExchange::update() {
+  if (!_running) {
+    return false;
+  }
+  _group.poll(POLL_FRAMES);
+  bool published = false;
+  if (_inCycle) {
+    collect();
+    sendFrames();
+    if (_openFrames == 0) {
+      closeCycle(micros(), false);
+      published = true;
+    }
+  }
+  const uint32_t now = micros();
+  if ((int32_t)(now - _nextStartUs) >= 0) {
+    if (_inCycle) {
+      // A late update() may find more replies waiting than one poll slice takes.
+      for (uint8_t n = 0; n < MAX_FRAMES / POLL_FRAMES && _openFrames; n++) {
+        _group.poll(POLL_FRAMES);
+        collect();
+      }
+      closeCycle(now, _openFrames != 0);
+      published = true;
+    }
+    beginCycle(now);
+    sendFrames();
+    if (_openFrames == 0) {
+      closeCycle(now, false);
+      published = true;
+    }
+  }
+  return published;
+}
+
+void MKSCyclicExchange::beginCycle(uint32_t nowUs) {
+  uint32_t lateUs = nowUs - _nextStartUs;
+  if (lateUs >= _cycleUs) {
+    // Keep the phase: the cycle takes the latest start slot that has passed.
+    const uint32_t dropped = lateUs / _cycleUs;
+    _lateCycles += dropped;
+    _nextStartUs += dropped * _cycleUs;
+    lateUs -= dropped * _cycleUs;
+  }
+  _nextStartUs += _cycleUs;
+  _cycleStartUs = nowUs;
+  _cycles++;
+  _jitterSumUs += lateUs;
+  if (lateUs > _maxJitterUs) {
+    _maxJitterUs = lateUs;
+  }
+  _current = CycleReport();
+  _current.cycle = _cycles;
+  _current.startUs = nowUs;
+  _current.jitterUs = lateUs;
+
+  uint8_t fields[READ_FIELDS];
+  uint8_t fieldCount = 0;
+  for (uint8_t f = 0; f < READ_FIELDS; f++) {
+    if (_telemetry & (1 << f)) {
+      fields[fieldCount++] = (uint8_t)(1 << f);
+    }
+  }
+
+  // Replies that missed their cycle (and extra completion reports of position setpoints) must
+  // not be taken for this cycle's.
+  const uint8_t axisCount = _group.axisCount();
+  CanFrame rx{};
+  for (uint8_t i = 0; i < axisCount; i++) {
+    MKSServoE &axis = *_group.axis(i);
+    _working[i].requested = 0;
+    _working[i].valid = 0;
+    while (axis.takeResponse(MKS::CMD_SPEED_MODE, rx) == MKSServoE::ERROR_OK) {}
+    while (axis.takeResponse(MKS::CMD_POS_MODE4_ABS_AXIS, rx) == MKSServoE::ERROR_OK) {}
+    for (uint8_t f = 0; f < fieldCount; f++) {
+      while (axis.takeResponse(fieldCommand(fields[f]), rx) == MKSServoE::ERROR_OK) {}
+    }
+  }
+
+  const uint32_t budgetUs = (uint32_t)((uint64_t)_cycleUs * _budgetPermille / 1000u);
+  uint32_t usedUs = 0;
+  _frameCount = 0;
+  for (uint8_t i = 0; i < axisCount; i++) {
+    const Setpoint &sp = _setpoints[i];
+    if (sp.kind == SETPOINT_NONE) {
+      continue;
+    }
+    // Setpoints go out even over budget; the report shows the load.
+    Frame &frame = _frames[_frameCount++];
+    frame.axis = i;
+    frame.cmd = sp.kind == SETPOINT_SPEED ? MKS::CMD_SPEED_MODE : MKS::CMD_POS_MODE4_ABS_AXIS;
+    frame.field = FIELD_SETPOINT;
+    frame.state = FRAME_SEND;
+    _working[i].requested |= FIELD_SETPOINT;
+    usedUs += setpointCostUs(i);
+  }
+
+  const uint16_t reads = (uint16_t)axisCount * fieldCount;
+  if (_readCursor >= reads) {
+    _readCursor = 0;
+  }
+  int32_t firstSkipped = -1;
+  for (uint16_t k = 0; k < reads; k++) {
+    const uint16_t index = (uint16_t)((_readCursor + k) % reads);
+    const uint8_t axisIndex = (uint8_t)(index / fieldCount);
+    const uint8_t field = fields[index % fieldCount];
+    const uint8_t cmd = fieldCommand(field);
+    const uint32_t cost = frameCostUs(2, cmd);
+    if (usedUs + cost > budgetUs) {
+      if (firstSkipped < 0) {
+        firstSkipped = index;
+      }
+      _current.skipped++;
+      continue;
+    }
+    Frame &frame = _frames[_frameCount++];
+    frame.axis = axisIndex;
+    frame.cmd = cmd;
+    frame.field = field;
+    frame.state = FRAME_SEND;
+    _working[axisIndex].requested |= field;
+    usedUs += cost;
+  }
+  // Reads left out go first next time.
+  _readCursor = firstSkipped < 0 ? 0 : (uint16_t)firstSkipped;
+  _skippedReads += _current.skipped;
+  _current.plannedBusUs = usedUs;
+  _sendIndex = 0;
+  _openFrames = _frameCount;
+  _inCycle = true;
+}
+
+void MKSCyclicExchange::sendFrames() {
+  const uint32_t timeoutMs = (_cycleUs + 999u) / 1000u;
+  while (_sendIndex < _frameCount) {
+    Frame &frame = _frames[_sendIndex];
+    MKSServoE &axis = *_group.axis(frame.axis);
+    const Setpoint &sp = _setpoints[frame.axis];
+    const MKSServoE::ERROR rc = frame.field == FIELD_SETPOINT
+      ? axis.sendRequest(frame.cmd, sp.payload, sp.payloadLen, timeoutMs)
+      : axis.sendRequest(frame.cmd, nullptr, 0, timeoutMs);
+    if (rc == MKSServoE::ERROR_BUS_SEND) {
+      // Adapter full: keep the order and retry on the next update.
+      return;
+    }
+    if (rc == MKSServoE::ERROR_OK) {
+      frame.state = FRAME_WAIT;
+      _current.sent++;
+    } else {
+      frame.state = FRAME_DONE;
+      _openFrames--;
+      _current.missing++;
+    }
+    _sendIndex++;
+  }
+}
+
+void MKSCyclicExchange::collect() {
+  CanFrame rx{};
+  for (uint8_t n = 0; n < _sendIndex; n++) {
+    Frame &frame = _frames[n];
+    if (frame.state != FRAME_WAIT || _group.axis(frame.axis)->takeResponse(frame.cmd, rx) != MKSServoE::ERROR_OK) {
+      continue;
+    }
+    store(_working[frame.axis], frame.field, rx);
+    frame.state = FRAME_DONE;
+    _openFrames--;
+    _current.received++;
+  }
+}
+
+void MKSCyclicExchange::store(AxisSnapshot &s, uint8_t field, const CanFrame &rx) {
+  const uint8_t *p = &rx.data[1];
+  switch (field) {
+    case FIELD_ENCODER:
+      if (rx.dlc < 8) {
+        return;
+      }
+      s.encoderAddition = MKS::get_i48_be(p);
+      break;
+    case FIELD_SPEED:
+      if (rx.dlc < 4) {
+        return;
+      }
+      s.speedRpm = (int16_t)MKS::get_u16_be(p);
+      break;
+    case FIELD_POS_ERROR:
+      if (rx.dlc < 6) {
+        return;
+      }
+      s.positionError = (int32_t)MKS::get_u32_be(p);
+      break;
+    case FIELD_IO:
+      s.ioStatus = p[0];
+      break;
+    case FIELD_ENABLE:
+      s.enabled = p[0];
+      break;
+    case FIELD_SETPOINT:
+      s.setpointStatus = p[0];
+      break;
+    default:
+      return;
+  }
+  s.valid |= field;
+}
+
+void MKSCyclicExchange::closeCycle(uint32_t nowUs, bool deadline) {
+  _inCycle = false;
+  for (uint8_t n = 0; n < _sendIndex; n++) {
+    if (_frames[n].state == FRAME_WAIT) {
+      _current.missing++;
+    }
+  }
+  _current.unsent = (uint8_t)(_frameCount - _sendIndex);
+  _current.overrun = deadline;
+  _current.durationUs = nowUs - _cycleStartUs;
+  if (_current.overrun) {
+    _overruns++;
+  }
+  _missingReplies += _current.missing;
+
+  const uint8_t axisCount = _group.axisCount();
+  for (uint8_t i = 0; i < axisCount; i++) {
+    _snapshot[i] = _working[i];
+  }
+  _snapshotCycle = _current.cycle;
+  _report = _current;
+  if (_handler) {
+    _handler(_context, _report);
+  }
+}
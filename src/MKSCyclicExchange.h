@@ -0,0 +1,179 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoGroup.h"
+
+// Fixed-rate process-data exchange for every axis of a group, in the spirit of a CANopen SYNC
+// cycle. At each cycle start the engine sends every axis its setpoint (speed 0xF6 or absolute
+// axis position 0xF5), then the configured telemetry reads, and collects the replies into a
+// working image. When every reply is in, or at the next cycle start at the latest, the image
+// is published as the snapshot: all axes from the same cycle, never mixed with the next one.
+//
+// Frames are budgeted on the bus-time model (CanTiming, worst-case stuffing, request plus
+// reply): setpoints always go out, reads fill the rest of the load budget and the ones that do
+// not fit are sent first in the next cycle, so every read still comes round. Each cycle ends
+// with a CycleReport (start jitter, overrun, missing replies, frames left out).
+//
+//   MKSCyclicExchange cycle(group, 1000000);
+//   cycle.setCycleUs(5000);
+//   cycle.setTelemetry(MKSCyclicExchange::FIELD_ENCODER | MKSCyclicExchange::FIELD_SPEED);
+//   cycle.setSpeedSetpoint(0, MKSUnits::Rpm(300), 10);
+//   cycle.start();
+//   loop: if (cycle.update()) { use cycle.snapshot(i) }
+class MKSCyclicExchange {
+public:
+  // Fields of AxisSnapshot; setTelemetry() takes the read ones.
+  enum Field : uint8_t {
+    FIELD_ENCODER = 1 << 0,    // CMD_READ_ENCODER_ADDITION
+    FIELD_SPEED = 1 << 1,      // CMD_READ_SPEED_RPM
+    FIELD_POS_ERROR = 1 << 2,  // CMD_READ_POS_ERROR
+    FIELD_IO = 1 << 3,         // CMD_READ_IO_STATUS
+    FIELD_ENABLE = 1 << 4,     // CMD_READ_EN_STATUS
+    FIELD_SETPOINT = 1 << 5,   // ack of the setpoint frame
+  };
+  static const uint8_t READ_FIELDS = 5;
+  static const uint8_t TELEMETRY_MASK = (1 << READ_FIELDS) - 1;
+  static const uint8_t MAX_FRAMES = MKSServoGroup::MAX_AXES * (READ_FIELDS + 1);
+  // Frames read from the bus per update().
+  static const uint8_t POLL_FRAMES = 16;
+
+  struct AxisSnapshot {
+    int64_t encoderAddition;  // 0x4000 per turn
+    int32_t positionError;    // 51200 per 360 degrees
+    int16_t speedRpm;
+    uint8_t ioStatus;
+    uint8_t enabled;
+    uint8_t setpointStatus;   // status byte of the setpoint ack
+    uint8_t requested;        // Field bits asked for in the cycle
+    uint8_t valid;            // Field bits answered in the cycle; the other values are older
+  };
+
+  struct CycleReport {
+    uint32_t cycle;
+    uint32_t startUs;       // micros() when the cycle began
+    uint32_t jitterUs;      // start delay past the scheduled start
+    uint32_t durationUs;    // until the last reply, or the deadline on overrun
+    uint32_t plannedBusUs;  // wire time of the frames scheduled for the cycle
+    uint8_t sent;
+    uint8_t received;
+    uint8_t missing;        // sent, not answered within the cycle
+    uint8_t unsent;         // scheduled, not accepted by the adapter within the cycle
+    uint8_t skipped;        // reads left out by the load budget
+    bool overrun;           // the deadline came before every reply
+  };
+
+  typedef void (*CycleHandler)(void *context, const CycleReport &report);
+
+  MKSCyclicExchange(MKSServoGroup &group, uint32_t bitrate);
+
+  // Cycle period, default 10 ms. Takes effect at the next start().
+  void setCycleUs(uint32_t cycleUs) { _cycleUs = cycleUs ? cycleUs : 1; }
+  uint32_t cycleUs() const { return _cycleUs; }
+  // Share of each cycle the exchange may keep the bus busy, in permille; default 800. The rest
+  // is left for other traffic and for adapter latency.
+  void setLoadBudgetPermille(uint16_t permille) { _budgetPermille = permille > 1000 ? 1000 : permille; }
+  // Budget that fits every setpoint and read in every cycle.
+  uint16_t requiredBudgetPermille() const;
+  void setBitrate(uint32_t bitrate) { _bitrate = bitrate; }
+  // Reads for every axis, FIELD_* bits below FIELD_SETPOINT; default encoder and speed.
+  void setTelemetry(uint8_t fields) { _telemetry = fields & TELEMETRY_MASK; }
+  void setCycleHandler(CycleHandler handler, void *context = nullptr);
+
+  // Sent every cycle until changed. False for an unknown axis or a position outside the
+  // 24-bit field.
+  bool setSpeedSetpoint(uint8_t axisIndex, MKSUnits::Rpm speed, uint8_t acc);
+  bool setPositionSetpoint(uint8_t axisIndex, MKSUnits::Counts absAxis, MKSUnits::Rpm speed, uint8_t acc);
+  void clearSetpoint(uint8_t axisIndex);
+
+  // The first cycle starts on the next update().
+  void start();
+  void stop();
+  bool running() const { return _running; }
+  // Non-blocking: reads the bus, sends the cycle's frames as the adapter takes them, collects
+  // replies and starts cycles on time. Call it well within a cycle. Returns true when a new
+  // snapshot was published.
+  bool update();
+
+  // Latest published cycle, 0 before the first.
+  uint32_t snapshotCycle() const { return _snapshotCycle; }
+  const AxisSnapshot *snapshot(uint8_t axisIndex) const;
+  // Report of the cycle behind the snapshot.
+  const CycleReport &lastReport() const { return _report; }
+
+  uint32_t cycles() const { return _cycles; }
+  uint32_t overruns() const { return _overruns; }
+  // Cycle starts that were dropped because update() came more than a period late.
+  uint32_t lateCycles() const { return _lateCycles; }
+  uint32_t missingReplies() const { return _missingReplies; }
+  uint32_t skippedReads() const { return _skippedReads; }
+  uint32_t maxJitterUs() const { return _maxJitterUs; }
+  uint32_t meanJitterUs() const { return _cycles ? (uint32_t)(_jitterSumUs / _cycles) : 0; }
+
+private:
+  enum SetpointKind : uint8_t {
+    SETPOINT_NONE = 0,
+    SETPOINT_SPEED,
+    SETPOINT_POSITION,
+  };
+
+  enum FrameState : uint8_t {
+    FRAME_SEND = 0,
+    FRAME_WAIT,
+    FRAME_DONE,
+  };
+
+  struct Setpoint {
+    SetpointKind kind;
+    uint8_t payloadLen;
+    uint8_t payload[6];
+  };
+
+  struct Frame {
+    uint8_t axis;
+    uint8_t cmd;
+    uint8_t field;
+    FrameState state;
+  };
+
+  MKSServoGroup &_group;
+  uint32_t _bitrate;
+  uint32_t _cycleUs;
+  uint16_t _budgetPermille;
+  uint8_t _telemetry;
+  CycleHandler _handler;
+  void *_context;
+  Setpoint _setpoints[MKSServoGroup::MAX_AXES];
+
+  bool _running;
+  bool _inCycle;
+  uint32_t _nextStartUs;
+  uint32_t _cycleStartUs;
+  Frame _frames[MAX_FRAMES];
+  uint8_t _frameCount;
+  uint8_t _sendIndex;
+  uint8_t _openFrames;    // not yet FRAME_DONE
+  uint16_t _readCursor;   // first (axis, field) read of the next cycle
+  AxisSnapshot _working[MKSServoGroup::MAX_AXES];
+  AxisSnapshot _snapshot[MKSServoGroup::MAX_AXES];
+  uint32_t _snapshotCycle;
+  CycleReport _current;   // cycle in progress
+  CycleReport _report;    // last closed cycle
+
+  uint32_t _cycles;
+  uint32_t _overruns;
+  uint32_t _lateCycles;
+  uint32_t _missingReplies;
+  uint32_t _skippedReads;
+  uint32_t _maxJitterUs;
+  uint64_t _jitterSumUs;
+
+  static uint8_t fieldCommand(uint8_t field);
+  static uint8_t replyDlc(uint8_t cmd);
+  uint32_t frameCostUs(uint8_t requestDlc, uint8_t cmd) const;
+  uint32_t setpointCostUs(uint8_t axisIndex) const;
+  uint32_t readsCostUs() const;
+  void beginCycle(uint32_t nowUs);
+  void sendFrames();
+  void collect();
+  void store(AxisSnapshot &s, uint8_t field, const CanFrame &rx);
+  void closeCycle(uint32_t nowUs, bool deadline);
+};
@@ -0,0 +1,132 @@
+#include <Arduino.h>
+#include "MKSEmergencyStop.h"
+#include "protocol/MksCrc.h"
+#include "transport/CanTiming.h"
+
+MKSEmergencyStop::MKSEmergencyStop(MKSServoGroup &group, uint32_t bitrate)
+: _group(group), _bitrate(bitrate), _broadcastId(0), _broadcast(true), _active(false), _issued(false), _sentMask(0), _ackTimeoutMs(50),
+  _startUs(0), _startMs(0), _maxBoundUs(0), _report() {}
+
+uint32_t MKSEmergencyStop::worstCaseWireUs() const {
+  // A full 8-byte frame may have just won arbitration, then the 2-byte stop frame follows.
+  return CanTiming::bitsToUs((uint32_t)CanTiming::worstCaseBits(8) + CanTiming::worstCaseBits(2), _bitrate);
+}
+
+void MKSEmergencyStop::markIssued(uint32_t nowUs) {
+  if (_issued) {
+    return;
+  }
+  _issued = true;
+  _report.issueUs = nowUs - _startUs;
+  _report.boundUs = _report.issueUs + worstCaseWireUs();
+  if (_report.boundUs > _maxBoundUs) {
+    _maxBoundUs = _report.boundUs;
+  }
+}
+
+void MKSEmergencyStop::sendPending() {
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    const uint16_t bit = (uint16_t)(1u << i);
+    if (_sentMask & bit) {
+      continue;
+    }
+    const uint32_t elapsedMs = millis() - _startMs;
+    const uint32_t remainingMs = elapsedMs < _ackTimeoutMs ? _ackTimeoutMs - elapsedMs : 0;
+    if (_group.axis(i)->sendRequest(MKS::CMD_EMERGENCY_STOP, nullptr, 0, remainingMs) != MKSServoE::ERROR_OK) {
+      // Mailboxes full: keep the order and retry from this axis on the next update().
+      return;
+    }
+    _sentMask |= bit;
+    _report.sentCount++;
+    const uint32_t now = micros();
+    markIssued(now);
+    _report.sendAllUs = now - _startUs;
+  }
+}
+
+MKSServoE::ERROR MKSEmergencyStop::sendFailure() {
+  CanErrorStatus status{};
+  if (_group.bus().errorStatus(status) && status.state == CanErrorState::BusOff) {
+    return MKSServoE::ERROR_BUS_OFF;
+  }
+  return MKSServoE::ERROR_BUS_SEND;
+}
+
+MKSServoE::ERROR MKSEmergencyStop::trigger(uint16_t ackTimeoutMs) {
+  _startUs = micros();
+  _startMs = millis();
+  _ackTimeoutMs = ackTimeoutMs;
+  _active = true;
+  _issued = false;
+  _sentMask = 0;
+  _report = Report();
+  _report.rc = MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+  _report.axisCount = _group.axisCount();
+
+  ICanBus &bus = _group.bus();
+  _report.abortedFrames = bus.abortPendingTx();
+
+  if (_broadcast) {
+    CanFrame stop{};
+    stop.id = _broadcastId;
+    stop.dlc = 2;
+    stop.data[0] = MKS::CMD_EMERGENCY_STOP;
+    stop.data[1] = MKS::crc8_sum_plus1(stop.data, 1);
+    if (bus.send(stop)) {
+      _report.broadcastSent = true;
+      markIssued(micros());
+    }
+  }
+  sendPending();
+
+  if (!_issued) {
+    // Nothing reached the adapter yet; update() keeps retrying the per-axis frames.
+    const MKSServoE::ERROR rc = sendFailure();
+    if (_group.axisCount() == 0) {
+      _active = false;
+      _report.rc = rc;
+    }
+    return rc;
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+bool MKSEmergencyStop::update() {
+  if (!_active) {
+    return true;
+  }
+  sendPending();
+
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    const uint16_t bit = (uint16_t)(1u << i);
+    if (!(_sentMask & bit) || (_report.ackedMask & bit)) {
+      continue;
+    }
+    uint8_t status = 0;
+    MKSServoE::ERROR rc = _group.axis(i)->pollStatusResponse(MKS::CMD_EMERGENCY_STOP, status);
+    if (rc == MKSServoE::ERROR_OK && status != 0) {
+      _report.ackedMask |= bit;
+      _report.ackedCount++;
+      _report.lastAckUs = micros() - _startUs;
+    } else if (rc == MKSServoE::ERROR_OK) {
+      _report.rc = MKSServoE::ERROR_DEVICE_STATUS_FAIL;
+    }
+  }
+
+  if (_report.ackedCount == _report.axisCount) {
+    _report.rc = MKSServoE::ERROR_OK;
+    _active = false;
+  } else if ((uint32_t)(millis() - _startMs) > _ackTimeoutMs) {
+    if (_report.rc == MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+      _report.rc = _report.sentCount == _report.axisCount ? MKSServoE::ERROR_TIMEOUT : sendFailure();
+    }
+    _active = false;
+  }
+  return !_active;
+}
+
+MKSServoE::ERROR MKSEmergencyStop::run(uint16_t ackTimeoutMs) {
+  trigger(ackTimeoutMs);
+  while (!update()) {}
+  return _report.rc;
+}
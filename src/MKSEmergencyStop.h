@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoGroup.h"
+
+// Emergency stop for every axis of a group with a bounded, measured latency.
+// trigger() first drops TX frames still queued in the adapter (ICanBus::abortPendingTx), then
+// sends a single CMD_EMERGENCY_STOP to the broadcast ID (or a group ID) so all drives stop on
+// one frame, then sends the same command to each axis as a fallback for drives that missed
+// the broadcast. Drives do not answer broadcast/group frames, so the per-axis frames are also
+// what produces acks; update() collects those without blocking.
+//
+// Stop latency = time until the stop frame has left the wire. It is bounded by the software
+// time to hand the frame to the adapter (measured on every trigger) plus worstCaseWireUs():
+// one maximum-length frame already on the wire, which cannot be preempted, followed by the
+// stop frame itself. The broadcast ID 0 wins arbitration against every other frame.
+class MKSEmergencyStop {
+public:
+  struct Report {
+    MKSServoE::ERROR rc;     // ERROR_OK once every axis acked with status 1
+    bool broadcastSent;
+    uint8_t abortedFrames;   // TX frames dropped by abortPendingTx
+    uint8_t axisCount;
+    uint8_t sentCount;       // per-axis frames accepted by the adapter
+    uint8_t ackedCount;
+    uint16_t ackedMask;      // bit i set once axis i acked
+    uint32_t issueUs;        // trigger() -> first stop frame accepted by the adapter
+    uint32_t boundUs;        // issueUs + worstCaseWireUs(): stop frame certainly off the wire
+    uint32_t sendAllUs;      // trigger() -> last per-axis frame accepted
+    uint32_t lastAckUs;      // trigger() -> last ack
+  };
+
+  MKSEmergencyStop(MKSServoGroup &group, uint32_t bitrate);
+
+  // 0 (default) addresses every drive on the bus; a group ID set with setGroupId() only those.
+  void setBroadcastId(uint16_t id) { _broadcastId = id; }
+  // Per-axis frames only, e.g. when other drives on the bus must keep running.
+  void setBroadcastEnabled(bool enable) { _broadcast = enable; }
+  void setBitrate(uint32_t bitrate) { _bitrate = bitrate; }
+
+  // Sends the stop without waiting for acks. ERROR_BUS_SEND if no stop frame could be sent,
+  // ERROR_BUS_OFF if that is because the controller is bus-off.
+  MKSServoE::ERROR trigger(uint16_t ackTimeoutMs = 50);
+  // Non-blocking: retries per-axis frames the adapter refused and collects acks. Returns true
+  // once every axis acked or the ack timeout passed.
+  bool update();
+  // trigger() followed by update() until done; returns report().rc.
+  MKSServoE::ERROR run(uint16_t ackTimeoutMs = 50);
+
+  bool active() const { return _active; }
+  const Report &report() const { return _report; }
+  // Wire-time part of the latency bound at the configured bitrate.
+  uint32_t worstCaseWireUs() const;
+  // Largest boundUs seen since construction.
+  uint32_t maxBoundUs() const { return _maxBoundUs; }
+
+private:
+  MKSServoGroup &_group;
+  uint32_t _bitrate;
+  uint16_t _broadcastId;
+  bool _broadcast;
+  bool _active;
+  bool _issued;
+  uint16_t _sentMask;
+  uint16_t _ackTimeoutMs;
+  uint32_t _startUs;
+  uint32_t _startMs;
+  uint32_t _maxBoundUs;
+  Report _report;
+
+  void markIssued(uint32_t nowUs);
+  void sendPending();
+  MKSServoE::ERROR sendFailure();
+};
@@ -0,0 +1,391 @@
+#include <Arduino.h>
+#include "MKSHomingEngine.h"
+#include "MKSStartupSequencer.h"
+#include "protocol/MksPacking.h"
+
+MKSHomingEngine::AxisConfig MKSHomingEngine::defaultConfig() {
+  AxisConfig config{};
+  config.home = true;
+  config.writeConfig = false;
+  config.homeSpeedRpm = 60;
+  config.endLimitEnable = 1;
+  config.stage = 0;
+  config.zeroAfterHome = true;
+  config.timeoutMs = 20000;
+  return config;
+}
+
+MKSHomingEngine::MKSHomingEngine(MKSServoGroup &group)
+: _group(group), _axes(), _pollIntervalMs(100), _stage(0), _aborted(false), _startMs(0) {}
+
+bool MKSHomingEngine::configure(uint8_t axisIndex, const AxisConfig &config) {
+  // 0xFF marks "no stage yet" in nextStage().
+  if (axisIndex >= MKSServoGroup::MAX_AXES || config.stage == 0xFF) {
+    return false;
+  }
+  _axes[axisIndex].config = config;
+  return true;
+}
+
+bool MKSHomingEngine::configureAll(const AxisConfig &config) {
+  if (config.stage == 0xFF) {
+    return false;
+  }
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    _axes[i].config = config;
+  }
+  return _group.axisCount() > 0;
+}
+
+void MKSHomingEngine::start() {
+  _startMs = millis();
+  _aborted = false;
+  for (uint8_t i = 0; i < MKSServoGroup::MAX_AXES; i++) {
+    AxisState &st = _axes[i];
+    st.phase = PHASE_IDLE;
+    st.failedPhase = PHASE_IDLE;
+    st.rc = MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+    st.waiting = false;
+    st.startMs = _startMs;
+    st.homingStartMs = _startMs;
+    st.homingMs = 0;
+    st.finishedMs = _startMs;
+  }
+  _stage = 0xFF;
+  nextStage();
+}
+
+bool MKSHomingEngine::nextStage() {
+  // The next stage is the lowest stage number above the current one that still has axes.
+  uint8_t next = 0xFF;
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    const AxisState &st = _axes[i];
+    if (!st.config.home || st.phase != PHASE_IDLE) {
+      continue;
+    }
+    if ((_stage == 0xFF || st.config.stage > _stage) && st.config.stage < next) {
+      next = st.config.stage;
+    }
+  }
+  if (next == 0xFF) {
+    return false;
+  }
+  _stage = next;
+  const uint32_t now = millis();
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    AxisState &st = _axes[i];
+    if (st.config.home && st.phase == PHASE_IDLE && st.config.stage == _stage) {
+      st.startMs = now;
+      enterPhase(st, *_group.axis(i), st.config.writeConfig ? PHASE_CONFIG : PHASE_START, now);
+    }
+  }
+  return true;
+}
+
+void MKSHomingEngine::enterPhase(AxisState &st, MKSServoE &axis, Phase phase, uint32_t now) {
+  st.phase = phase;
+  st.waiting = false;
+  st.cmdStartMs = now;
+  st.finishedMs = now;
+  if (phase == PHASE_START) {
+    // Drop home reports left over from an earlier run so they are not taken for this one.
+    CanFrame stale{};
+    while (axis.takeResponse(MKS::CMD_GO_HOME, stale) == MKSServoE::ERROR_OK) {}
+    st.originKnown = false;
+  } else if (phase == PHASE_HOMING) {
+    st.homingStartMs = now;
+    // The first status query is due at once, so even a short home is seen running.
+    st.lastQueryMs = now - _pollIntervalMs;
+    st.sawMotion = false;
+    st.confirming = false;
+  } else if (phase == PHASE_DONE) {
+    st.rc = MKSServoE::ERROR_OK;
+  }
+}
+
+void MKSHomingEngine::fail(AxisState &st, MKSServoE::ERROR rc, uint32_t now) {
+  st.failedPhase = st.phase;
+  st.phase = PHASE_FAILED;
+  st.rc = rc;
+  st.waiting = false;
+  st.finishedMs = now;
+}
+
+void MKSHomingEngine::homed(AxisState &st, MKSServoE &axis, uint32_t now) {
+  st.homingMs = st.phase == PHASE_HOMING ? now - st.homingStartMs : 0;
+  if (st.config.zeroAfterHome) {
+    enterPhase(st, axis, PHASE_ZERO, now);
+  } else {
+    enterPhase(st, axis, PHASE_DONE, now);
+  }
+}
+
+MKSServoE::ERROR MKSHomingEngine::exchange(AxisState &st, MKSServoE &axis, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t &status, uint32_t now) {
+  CanFrame rx{};
+  MKSServoE::ERROR rc = exchangeFrame(st, axis, cmd, payload, payloadLen, rx, now);
+  if (rc == MKSServoE::ERROR_OK) {
+    if (rx.dlc < 3) {
+      return MKSServoE::ERROR_BAD_FRAME;
+    }
+    status = rx.data[1];
+  }
+  return rc;
+}
+
+MKSServoE::ERROR MKSHomingEngine::readPosition(AxisState &st, MKSServoE &axis, int64_t &position, uint32_t now) {
+  CanFrame rx{};
+  MKSServoE::ERROR rc = exchangeFrame(st, axis, MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, rx, now);
+  if (rc == MKSServoE::ERROR_OK) {
+    if (rx.dlc < 8) {
+      return MKSServoE::ERROR_BAD_FRAME;
+    }
+    position = MKS::get_i48_be(&rx.data[1]);
+  }
+  return rc;
+}
+
+MKSServoE::ERROR MKSHomingEngine::exchangeFrame(AxisState &st, MKSServoE &axis, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, CanFrame &rx, uint32_t now) {
+  if (!st.waiting) {
+    MKSServoE::ERROR rc = axis.sendRequest(cmd, payload, payloadLen, COMMAND_TIMEOUT_MS);
+    if (rc == MKSServoE::ERROR_OK) {
+      st.waiting = true;
+      st.cmdStartMs = now;
+      return MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+    }
+    if (rc == MKSServoE::ERROR_BUS_SEND && (uint32_t)(now - st.cmdStartMs) <= COMMAND_TIMEOUT_MS) {
+      // A busy TX mailbox is retried on the next update until the command times out.
+      return MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+    }
+    return rc;
+  }
+  MKSServoE::ERROR rc = axis.pollResponse(cmd, rx);
+  if (rc == MKSServoE::ERROR_NO_RESPONSE_AVAILABLE && (uint32_t)(now - st.cmdStartMs) > COMMAND_TIMEOUT_MS) {
+    rc = MKSServoE::ERROR_TIMEOUT;
+  }
+  if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+    st.waiting = false;
+  }
+  return rc;
+}
+
+void MKSHomingEngine::advance(AxisState &st, MKSServoE &axis, uint32_t now) {
+  uint8_t status = 0;
+  MKSServoE::ERROR rc;
+  switch (st.phase) {
+    case PHASE_CONFIG: {
+      const MKSStartupSequencer::Step step = MKSStartupSequencer::homeConfigStep(st.config.trigLevel, st.config.homeDir, st.config.homeSpeedRpm, st.config.endLimitEnable, st.config.mode);
+      rc = exchange(st, axis, step.cmd, step.payload, step.payloadLen, status, now);
+      if (rc == MKSServoE::ERROR_OK && status == 0) {
+        rc = MKSServoE::ERROR_DEVICE_STATUS_FAIL;
+      }
+      if (rc == MKSServoE::ERROR_OK) {
+        enterPhase(st, axis, PHASE_START, now);
+      } else if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+        fail(st, rc, now);
+      }
+      break;
+    }
+    case PHASE_START:
+      if (_pollIntervalMs > 0 && !st.originKnown) {
+        // Baseline for confirming a polled home that was never seen running.
+        rc = readPosition(st, axis, st.origin, now);
+        if (rc == MKSServoE::ERROR_OK) {
+          st.originKnown = true;
+          st.cmdStartMs = now;
+        } else if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+          fail(st, rc, now);
+        }
+        break;
+      }
+      rc = exchange(st, axis, MKS::CMD_GO_HOME, nullptr, 0, status, now);
+      if (rc == MKSServoE::ERROR_OK) {
+        if (status == (uint8_t)MKS::GoHomeStatus::Start) {
+          enterPhase(st, axis, PHASE_HOMING, now);
+        } else if (status == (uint8_t)MKS::GoHomeStatus::Success) {
+          homed(st, axis, now);
+        } else {
+          fail(st, MKSServoE::ERROR_DEVICE_STATUS_FAIL, now);
+        }
+      } else if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+        fail(st, rc, now);
+      }
+      break;
+    case PHASE_HOMING:
+      // The drive reports the end of homing on 0x91 when active reporting is on.
+      if (axis.pollStatusResponse(MKS::CMD_GO_HOME, status) == MKSServoE::ERROR_OK) {
+        if (status == (uint8_t)MKS::GoHomeStatus::Success) {
+          homed(st, axis, now);
+          break;
+        }
+        if (status == (uint8_t)MKS::GoHomeStatus::Fail) {
+          fail(st, MKSServoE::ERROR_DEVICE_STATUS_FAIL, now);
+          break;
+        }
+      }
+      if (st.confirming) {
+        int64_t position = 0;
+        rc = readPosition(st, axis, position, now);
+        if (rc == MKSServoE::ERROR_OK) {
+          const int64_t moved = position - st.origin;
+          if (moved > HOME_MOVED_MIN_COUNTS || moved < -HOME_MOVED_MIN_COUNTS) {
+            homed(st, axis, now);
+          } else {
+            fail(st, MKSServoE::ERROR_DEVICE_STATUS_FAIL, now);
+          }
+          break;
+        }
+        if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+          fail(st, rc, now);
+          break;
+        }
+      } else if (_pollIntervalMs > 0 && (st.waiting || (uint32_t)(now - st.lastQueryMs) >= _pollIntervalMs)) {
+        if (!st.waiting) {
+          st.lastQueryMs = now;
+          st.cmdStartMs = now;
+        }
+        rc = exchange(st, axis, MKS::CMD_QUERY_STATUS, nullptr, 0, status, now);
+        if (rc == MKSServoE::ERROR_OK) {
+          // Without the report, a stop only counts once the axis was seen moving. A stop seen
+          // first is confirmed by the encoder having left the start position.
+          if (status == (uint8_t)MKS::MotorRunState::Stop) {
+            if (st.sawMotion) {
+              homed(st, axis, now);
+            } else {
+              st.confirming = true;
+            }
+            break;
+          }
+          if (status == (uint8_t)MKS::MotorRunState::QueryFail) {
+            fail(st, MKSServoE::ERROR_DEVICE_STATUS_FAIL, now);
+            break;
+          }
+          st.sawMotion = true;
+        }
+        // A lost status query is not fatal; the next interval asks again.
+      }
+      if ((uint32_t)(now - st.homingStartMs) > st.config.timeoutMs) {
+        fail(st, MKSServoE::ERROR_TIMEOUT, now);
+      }
+      break;
+    case PHASE_ZERO:
+      rc = exchange(st, axis, MKS::CMD_SET_AXIS_ZERO, nullptr, 0, status, now);
+      if (rc == MKSServoE::ERROR_OK && status == 0) {
+        rc = MKSServoE::ERROR_DEVICE_STATUS_FAIL;
+      }
+      if (rc == MKSServoE::ERROR_OK) {
+        enterPhase(st, axis, PHASE_DONE, now);
+      } else if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+        fail(st, rc, now);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+bool MKSHomingEngine::update() {
+  if (_aborted) {
+    return true;
+  }
+  bool stageDone = true;
+  bool stageFailed = false;
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    AxisState &st = _axes[i];
+    if (!st.config.home || st.config.stage != _stage || st.phase == PHASE_IDLE) {
+      continue;
+    }
+    if (st.phase != PHASE_DONE && st.phase != PHASE_FAILED) {
+      advance(st, *_group.axis(i), millis());
+    }
+    if (st.phase == PHASE_FAILED) {
+      stageFailed = true;
+    } else if (st.phase != PHASE_DONE) {
+      stageDone = false;
+    }
+  }
+  if (!stageDone) {
+    return false;
+  }
+  if (stageFailed) {
+    _aborted = true;
+    for (uint8_t i = 0; i < _group.axisCount(); i++) {
+      if (_axes[i].config.home && _axes[i].phase == PHASE_IDLE) {
+        _axes[i].rc = MKSServoE::ERROR_ABORTED;
+      }
+    }
+    return true;
+  }
+  return !nextStage();
+}
+
+MKSServoE::ERROR MKSHomingEngine::run(uint32_t timeoutMs) {
+  start();
+  while (!update()) {
+    if ((uint32_t)(millis() - _startMs) > timeoutMs) {
+      return MKSServoE::ERROR_TIMEOUT;
+    }
+  }
+  // The axis that stopped homing explains the skipped ones, whatever their index.
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    if (_axes[i].config.home && _axes[i].phase == PHASE_FAILED) {
+      return _axes[i].rc;
+    }
+  }
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    MKSServoE::ERROR rc = axisResult(i);
+    if (rc != MKSServoE::ERROR_OK) {
+      return rc;
+    }
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+bool MKSHomingEngine::done() const {
+  if (_aborted) {
+    return true;
+  }
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    const AxisState &st = _axes[i];
+    if (st.config.home && st.phase != PHASE_DONE && st.phase != PHASE_FAILED) {
+      return false;
+    }
+  }
+  return true;
+}
+
+MKSHomingEngine::Phase MKSHomingEngine::phase(uint8_t axisIndex) const {
+  return axisIndex < MKSServoGroup::MAX_AXES ? _axes[axisIndex].phase : PHASE_IDLE;
+}
+
+MKSHomingEngine::Phase MKSHomingEngine::failedPhase(uint8_t axisIndex) const {
+  return axisIndex < MKSServoGroup::MAX_AXES ? _axes[axisIndex].failedPhase : PHASE_IDLE;
+}
+
+MKSServoE::ERROR MKSHomingEngine::axisResult(uint8_t axisIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return MKSServoE::ERROR_INVALID_ARG;
+  }
+  const AxisState &st = _axes[axisIndex];
+  if (!st.config.home) {
+    return MKSServoE::ERROR_OK;
+  }
+  return st.rc;
+}
+
+uint32_t MKSHomingEngine::axisElapsedMs(uint8_t axisIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return 0;
+  }
+  return _axes[axisIndex].finishedMs - _axes[axisIndex].startMs;
+}
+
+uint32_t MKSHomingEngine::axisHomingMs(uint8_t axisIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return 0;
+  }
+  const AxisState &st = _axes[axisIndex];
+  if (st.phase == PHASE_HOMING) {
+    return millis() - st.homingStartMs;
+  }
+  return st.homingMs;
+}
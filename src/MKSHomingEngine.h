@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoGroup.h"
+
+// Homes every axis of a group at once without blocking: per axis it writes the home
+// parameters (0x90), starts homing (0x91), waits for the drive's "home success" report (or,
+// when polling 0xF1, a stop after the axis was seen moving or away from where it started),
+// then optionally zeroes the axis (0x92). Axes are split into
+// stages; all axes of a stage home concurrently and the next stage starts once they are done,
+// so e.g. Z can clear the work area before X/Y move. A failed stage stops later stages.
+class MKSHomingEngine {
+public:
+  static const uint8_t COMMAND_TIMEOUT_MS = 50;
+  // Encoder travel (axis counts) that confirms a home whose run state was only ever seen as
+  // Stop: about one degree.
+  static const int32_t HOME_MOVED_MIN_COUNTS = 0x4000 / 360;
+
+  enum Phase : uint8_t {
+    PHASE_IDLE = 0,   // not started yet (or skipped because an earlier stage failed)
+    PHASE_CONFIG,     // writing home parameters
+    PHASE_START,      // go-home sent, waiting for its ack
+    PHASE_HOMING,     // moving towards the home switch
+    PHASE_ZERO,       // setting the axis zero
+    PHASE_DONE,
+    PHASE_FAILED
+  };
+
+  struct AxisConfig {
+    bool home;              // false leaves the axis out
+    bool writeConfig;       // send the parameters below before homing
+    uint8_t trigLevel;
+    uint8_t homeDir;
+    uint16_t homeSpeedRpm;
+    uint8_t endLimitEnable;
+    uint8_t mode;
+    uint8_t stage;          // lower stages home first; 0..254
+    bool zeroAfterHome;
+    uint32_t timeoutMs;     // for the homing move itself
+  };
+
+  // Homes with the drive's stored parameters, stage 0, zero afterwards, 20 s timeout.
+  static AxisConfig defaultConfig();
+
+  explicit MKSHomingEngine(MKSServoGroup &group);
+
+  // False for an unknown axis or stage 255.
+  bool configure(uint8_t axisIndex, const AxisConfig &config);
+  bool configureAll(const AxisConfig &config);
+  // How often 0xF1 is queried while homing, for drives with active reporting disabled; the
+  // first query goes out right after the go-home ack. 0 relies on the active report alone.
+  void setStatusPollIntervalMs(uint16_t intervalMs) { _pollIntervalMs = intervalMs; }
+
+  void start();
+  // Non-blocking: advances every axis as far as possible. Returns true once homing is over.
+  bool update();
+  // Blocking helper around start()/update(). Returns the error of the first failed axis,
+  // ERROR_TIMEOUT if homing did not finish within timeoutMs.
+  MKSServoE::ERROR run(uint32_t timeoutMs = 30000);
+
+  bool done() const;
+  uint8_t currentStage() const { return _stage; }
+  Phase phase(uint8_t axisIndex) const;
+  // Phase the axis was in when it failed, PHASE_IDLE if it did not fail.
+  Phase failedPhase(uint8_t axisIndex) const;
+  // ERROR_OK once the axis is homed (or not configured to home), ERROR_NO_RESPONSE_AVAILABLE
+  // while pending, ERROR_ABORTED when skipped after an earlier stage failed, otherwise the
+  // error that stopped it.
+  MKSServoE::ERROR axisResult(uint8_t axisIndex) const;
+  // From the start of the axis' stage to the end of its last phase.
+  uint32_t axisElapsedMs(uint8_t axisIndex) const;
+  // Time spent in PHASE_HOMING (so far, while still homing).
+  uint32_t axisHomingMs(uint8_t axisIndex) const;
+
+private:
+  struct AxisState {
+    AxisConfig config;
+    Phase phase;
+    Phase failedPhase;
+    MKSServoE::ERROR rc;
+    bool waiting;
+    bool sawMotion;         // 0xF1 reported a running state since homing started
+    bool originKnown;
+    bool confirming;        // 0xF1 said Stop before any motion: checking the encoder
+    int64_t origin;         // encoder addition before go-home, when polling
+    uint32_t cmdStartMs;
+    uint32_t lastQueryMs;
+    uint32_t startMs;
+    uint32_t homingStartMs;
+    uint32_t homingMs;
+    uint32_t finishedMs;
+  };
+
+  MKSServoGroup &_group;
+  AxisState _axes[MKSServoGroup::MAX_AXES];
+  uint16_t _pollIntervalMs;
+  uint8_t _stage;
+  bool _aborted;
+  uint32_t _startMs;
+
+  MKSServoE::ERROR exchangeFrame(AxisState &st, MKSServoE &axis, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, CanFrame &rx, uint32_t now);
+  MKSServoE::ERROR exchange(AxisState &st, MKSServoE &axis, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t &status, uint32_t now);
+  MKSServoE::ERROR readPosition(AxisState &st, MKSServoE &axis, int64_t &position, uint32_t now);
+  void enterPhase(AxisState &st, MKSServoE &axis, Phase phase, uint32_t now);
+  void fail(AxisState &st, MKSServoE::ERROR rc, uint32_t now);
+  void advance(AxisState &st, MKSServoE &axis, uint32_t now);
+  void homed(AxisState &st, MKSServoE &axis, uint32_t now);
+  bool nextStage();
+};
@@ -0,0 +1,263 @@
+#include <Arduino.h>
+#include "MKSLongMove.h"
+#include "protocol/MksPacking.h"
+
+MKSLongMove::MKSLongMove(MKSServoE &servo)
+: _servo(servo), _segmentLimit(MAX_SEGMENT), _pollIntervalMs(10), _lookahead(0),
+  _tolerance(DEFAULT_TOLERANCE), _phase(PHASE_IDLE),
+  _rc(MKSServoE::ERROR_NO_RESPONSE_AVAILABLE), _absolute(false), _request(0), _speedRpm(0), _acc(0), _timeoutMs(0),
+  _startMs(0), _finishedMs(0), _origin(0), _target(0), _commandedEnd(0), _position(0), _readPending(false),
+  _readStale(false), _readStartMs(0), _ackPending(false), _ackStartMs(0), _stopped(false), _segmentsSent(0), _stops(0),
+  _corrections(0), _failedStatus(0) {}
+
+void MKSLongMove::setSegmentLimit(int32_t counts) {
+  if (counts < 1) {
+    counts = 1;
+  }
+  _segmentLimit = counts > MAX_SEGMENT ? MAX_SEGMENT : counts;
+}
+
+MKSServoE::ERROR MKSLongMove::startRelative(int64_t relAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs) {
+  return start(false, relAxis, speedRpm, acc, timeoutMs);
+}
+
+MKSServoE::ERROR MKSLongMove::startAbsolute(int64_t absAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs) {
+  return start(true, absAxis, speedRpm, acc, timeoutMs);
+}
+
+MKSServoE::ERROR MKSLongMove::start(bool absolute, int64_t value, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs) {
+  if (active()) {
+    return MKSServoE::ERROR_BUS_SEND;
+  }
+  if (value > MAX_POSITION || value < -MAX_POSITION) {
+    return MKSServoE::ERROR_INVALID_ARG;
+  }
+  _absolute = absolute;
+  _request = value;
+  _speedRpm = speedRpm > 3000 ? 3000 : speedRpm;
+  _acc = acc;
+  _timeoutMs = timeoutMs;
+  _startMs = millis();
+  _finishedMs = _startMs;
+  _origin = 0;
+  _target = 0;
+  _commandedEnd = 0;
+  _position = 0;
+  _readPending = false;
+  _readStale = false;
+  _ackPending = false;
+  _stopped = false;
+  _segmentsSent = 0;
+  _stops = 0;
+  _corrections = 0;
+  _failedStatus = 0;
+  _rc = MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+  _phase = PHASE_ORIGIN;
+  return MKSServoE::ERROR_OK;
+}
+
+bool MKSLongMove::update() {
+  if (!active()) {
+    return true;
+  }
+  const uint32_t now = millis();
+  if (_timeoutMs && (uint32_t)(now - _startMs) > _timeoutMs) {
+    finish(MKSServoE::ERROR_TIMEOUT);
+    return true;
+  }
+  _servo.poll();
+  updatePosition(now);
+  if (_phase != PHASE_MOVING) {
+    return !active();
+  }
+  collectReports();
+  if (_phase != PHASE_MOVING) {
+    return !active();
+  }
+  if (_ackPending) {
+    if ((uint32_t)(now - _ackStartMs) > COMMAND_TIMEOUT_MS) {
+      finish(MKSServoE::ERROR_TIMEOUT);
+    }
+    return !active();
+  }
+  if (_commandedEnd != _target) {
+    // An older position only overstates the remaining distance, so the send is never early.
+    const int64_t remaining = _commandedEnd - _position;
+    if (_segmentsSent == 0 || _stopped || (remaining < 0 ? -remaining : remaining) <= lookahead()) {
+      sendSegment(now);
+    }
+  }
+  return !active();
+}
+
+void MKSLongMove::abort() {
+  if (active()) {
+    finish(MKSServoE::ERROR_TIMEOUT);
+  }
+}
+
+MKSServoE::ERROR MKSLongMove::moveRelative(int64_t relAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs) {
+  MKSServoE::ERROR rc = startRelative(relAxis, speedRpm, acc, timeoutMs);
+  if (rc != MKSServoE::ERROR_OK) {
+    return rc;
+  }
+  while (!update()) {}
+  return _rc;
+}
+
+MKSServoE::ERROR MKSLongMove::moveAbsolute(int64_t absAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs) {
+  MKSServoE::ERROR rc = startAbsolute(absAxis, speedRpm, acc, timeoutMs);
+  if (rc != MKSServoE::ERROR_OK) {
+    return rc;
+  }
+  while (!update()) {}
+  return _rc;
+}
+
+uint32_t MKSLongMove::elapsedMs() const {
+  if (_phase == PHASE_IDLE) {
+    return 0;
+  }
+  return (uint32_t)((active() ? millis() : _finishedMs) - _startMs);
+}
+
+int32_t MKSLongMove::lookahead() const {
+  if (_lookahead > 0) {
+    return _lookahead;
+  }
+  // 0x4000 counts per turn.
+  const int64_t countsPerSecond = (int64_t)_speedRpm * 0x4000 / 60;
+  int64_t covered = countsPerSecond * (3 * (int64_t)_pollIntervalMs + 20) / 1000;
+  if (_acc) {
+    // The drive ramps down towards the commanded end: 1 RPM per (256 - acc) * 50 us, so the
+    // braking distance v^2 / 2a is rpm^2 * 0x4000 * (256 - acc) / (60 * 40000) counts.
+    covered += (int64_t)_speedRpm * _speedRpm * 0x4000 * (256 - _acc) / (60 * 40000);
+  }
+  const int64_t half = _segmentLimit / 2;
+  return (int32_t)(covered > half ? covered : half);
+}
+
+void MKSLongMove::updatePosition(uint32_t now) {
+  if (_readPending) {
+    CanFrame rx{};
+    MKSServoE::ERROR rc = _servo.takeResponse(MKS::CMD_READ_ENCODER_ADDITION, rx);
+    if (rc == MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+      if ((uint32_t)(now - _readStartMs) > COMMAND_TIMEOUT_MS) {
+        _readPending = false;
+        if (_phase != PHASE_MOVING) {
+          finish(MKSServoE::ERROR_TIMEOUT);
+        }
+      }
+      return;
+    }
+    _readPending = false;
+    if (rc == MKSServoE::ERROR_OK && rx.dlc < 8) {
+      rc = MKSServoE::ERROR_BAD_FRAME;
+    }
+    if (rc != MKSServoE::ERROR_OK) {
+      // A lost telemetry read while moving only delays the next segment.
+      if (_phase != PHASE_MOVING) {
+        finish(rc);
+      }
+      return;
+    }
+    if (_readStale) {
+      // Sent before the completion report; the final position needs a new read.
+      _readStale = false;
+      return;
+    }
+    _position = MKS::get_i48_be(&rx.data[1]);
+    if (_phase == PHASE_ORIGIN) {
+      _origin = _position;
+      _commandedEnd = _origin;
+      _target = _absolute ? _request : _origin + _request;
+      if (_target > MAX_POSITION || _target < -MAX_POSITION) {
+        finish(MKSServoE::ERROR_INVALID_ARG);
+      } else if (_target == _origin) {
+        finish(MKSServoE::ERROR_OK);
+      } else {
+        _phase = PHASE_MOVING;
+      }
+    } else if (_phase == PHASE_VERIFY) {
+      const int64_t error = _target - _position;
+      if ((error < 0 ? -error : error) <= _tolerance) {
+        finish(MKSServoE::ERROR_OK);
+      } else if (_corrections >= MAX_CORRECTIONS) {
+        finish(MKSServoE::ERROR_BAD_RESPONSE);
+      } else {
+        // Stream the rest from where the axis actually stopped.
+        _corrections++;
+        _commandedEnd = _position;
+        _stopped = true;
+        _phase = PHASE_MOVING;
+      }
+    }
+    return;
+  }
+  if (_phase == PHASE_MOVING && (uint32_t)(now - _readStartMs) < _pollIntervalMs) {
+    return;
+  }
+  MKSServoE::ERROR rc = _servo.sendRequest(MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, COMMAND_TIMEOUT_MS);
+  if (rc == MKSServoE::ERROR_OK) {
+    _readPending = true;
+    _readStartMs = now;
+  } else if (rc != MKSServoE::ERROR_BUS_SEND) {
+    finish(rc);
+  }
+}
+
+void MKSLongMove::collectReports() {
+  CanFrame rx{};
+  while (_phase == PHASE_MOVING && _servo.takeResponse(MKS::CMD_POS_MODE3_REL_AXIS, rx) == MKSServoE::ERROR_OK) {
+    const uint8_t status = rx.dlc >= 3 ? rx.data[1] : 0;
+    if (status == (uint8_t)MKS::PositionStatus::RunStarting) {
+      _ackPending = false;
+    } else if (status == (uint8_t)MKS::PositionStatus::RunComplete) {
+      if (_ackPending || _commandedEnd != _target) {
+        // The axis stopped before the next segment reached it; the next one restarts it.
+        _stops++;
+        _stopped = !_ackPending;
+      } else {
+        _phase = PHASE_VERIFY;
+        _readStale = _readPending;
+      }
+    } else {
+      _failedStatus = status;
+      finish(MKSServoE::ERROR_DEVICE_STATUS_FAIL);
+    }
+  }
+}
+
+void MKSLongMove::sendSegment(uint32_t now) {
+  int64_t segment = _target - _commandedEnd;
+  if (segment > _segmentLimit) {
+    segment = _segmentLimit;
+  } else if (segment < -(int64_t)_segmentLimit) {
+    segment = -(int64_t)_segmentLimit;
+  }
+  uint8_t payload[6];
+  payload[0] = (uint8_t)((_speedRpm >> 8) & 0x7F);
+  payload[1] = (uint8_t)(_speedRpm & 0xFF);
+  payload[2] = _acc;
+  MKS::put_i24_be(&payload[3], (int32_t)segment);
+  MKSServoE::ERROR rc = _servo.sendRequest(MKS::CMD_POS_MODE3_REL_AXIS, payload, 6, COMMAND_TIMEOUT_MS);
+  if (rc == MKSServoE::ERROR_BUS_SEND) {
+    // Retried on the next update; the overall timeout bounds it.
+    return;
+  }
+  if (rc != MKSServoE::ERROR_OK) {
+    finish(rc);
+    return;
+  }
+  _commandedEnd += segment;
+  _segmentsSent++;
+  _ackPending = true;
+  _ackStartMs = now;
+  _stopped = false;
+}
+
+void MKSLongMove::finish(MKSServoE::ERROR rc) {
+  _rc = rc;
+  _phase = rc == MKSServoE::ERROR_OK ? PHASE_DONE : PHASE_FAILED;
+  _finishedMs = millis();
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoE.h"
+
+// Relative or absolute moves of one axis beyond the 24-bit field of the position commands.
+// The distance is split into relative-axis segments (0xF4) of at most the segment limit. The
+// drive chains a relative command received during a move onto its commanded target, so the
+// next segment is sent while the previous one is still running: the encoder addition (0x31,
+// 48 bits) is read every poll interval and the next segment goes out once the axis is within
+// the lookahead of the end of what was commanded so far. The axis never ramps down between
+// segments as long as the lookahead covers the braking distance plus a poll interval and the
+// bus round trip.
+// After the completion report the final position is read back; if it is off the target by
+// more than the tolerance, the rest is streamed again from where the axis stopped.
+//
+// Non-blocking like the group engines: start*() then update() until it returns true, or the
+// blocking moveRelative()/moveAbsolute().
+class MKSLongMove {
+public:
+  static const int32_t MAX_SEGMENT = MKS::AXIS_FIELD_MAX;
+  static const uint8_t COMMAND_TIMEOUT_MS = 50;
+  // The encoder addition is 48 bits wide.
+  static const int64_t MAX_POSITION = 0x7FFFFFFFFFFFLL;
+  // Final position error accepted without a correction, in axis counts (0x4000 per turn).
+  static const int32_t DEFAULT_TOLERANCE = 32;
+  // Correcting segments sent after the axis stopped outside the tolerance.
+  static const uint8_t MAX_CORRECTIONS = 2;
+
+  enum Phase : uint8_t {
+    PHASE_IDLE = 0,
+    PHASE_ORIGIN,  // reading the start position
+    PHASE_MOVING,  // streaming segments, waiting for the completion report
+    PHASE_VERIFY,  // reading the final position; outside the tolerance streaming resumes
+    PHASE_DONE,
+    PHASE_FAILED
+  };
+
+  explicit MKSLongMove(MKSServoE &servo);
+
+  // Largest segment in axis counts, 1..MAX_SEGMENT.
+  void setSegmentLimit(int32_t counts);
+  void setPositionPollIntervalMs(uint16_t intervalMs) { _pollIntervalMs = intervalMs ? intervalMs : 1; }
+  // Remaining commanded distance below which the next segment is sent; 0 (default) picks
+  // max(segment limit / 2, braking distance at acc + distance over 3 poll intervals + 20 ms).
+  void setLookahead(int32_t counts) { _lookahead = counts < 0 ? 0 : counts; }
+  void setTolerance(int32_t counts) { _tolerance = counts < 0 ? 0 : counts; }
+
+  // ERROR_INVALID_ARG if the target leaves the 48-bit encoder range, ERROR_BUS_SEND while a
+  // move is active. timeoutMs bounds the whole move, 0 = no limit.
+  MKSServoE::ERROR startRelative(int64_t relAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs = 0);
+  MKSServoE::ERROR startAbsolute(int64_t absAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs = 0);
+  // Non-blocking. Returns true once the move is over (or was never started).
+  bool update();
+  // Stops following the move; the drive keeps running the segments it already has.
+  void abort();
+
+  MKSServoE::ERROR moveRelative(int64_t relAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs = 0);
+  MKSServoE::ERROR moveAbsolute(int64_t absAxis, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs = 0);
+
+  // Typed variants (MKSUnits.h); only the magnitude of the speed is used.
+  MKSServoE::ERROR startRelative(MKSUnits::Counts relAxis, MKSUnits::Rpm speed, uint8_t acc, uint32_t timeoutMs = 0) {
+    return startRelative(relAxis.value, MKSUnits::speedField(speed), acc, timeoutMs);
+  }
+  MKSServoE::ERROR startAbsolute(MKSUnits::Counts absAxis, MKSUnits::Rpm speed, uint8_t acc, uint32_t timeoutMs = 0) {
+    return startAbsolute(absAxis.value, MKSUnits::speedField(speed), acc, timeoutMs);
+  }
+  MKSServoE::ERROR moveRelative(MKSUnits::Counts relAxis, MKSUnits::Rpm speed, uint8_t acc, uint32_t timeoutMs = 0) {
+    return moveRelative(relAxis.value, MKSUnits::speedField(speed), acc, timeoutMs);
+  }
+  MKSServoE::ERROR moveAbsolute(MKSUnits::Counts absAxis, MKSUnits::Rpm speed, uint8_t acc, uint32_t timeoutMs = 0) {
+    return moveAbsolute(absAxis.value, MKSUnits::speedField(speed), acc, timeoutMs);
+  }
+
+  Phase phase() const { return _phase; }
+  bool active() const { return _phase != PHASE_IDLE && _phase != PHASE_DONE && _phase != PHASE_FAILED; }
+  // ERROR_OK once done, ERROR_NO_RESPONSE_AVAILABLE while active, otherwise the failure;
+  // ERROR_BAD_RESPONSE when the axis still stops outside the tolerance after MAX_CORRECTIONS.
+  MKSServoE::ERROR result() const { return _rc; }
+  // Status byte of the 0xF4 frame that failed the move (MKS::PositionStatus).
+  uint8_t failedStatus() const { return _failedStatus; }
+  int64_t origin() const { return _origin; }
+  int64_t target() const { return _target; }
+  // Last encoder addition read; after PHASE_DONE the final position.
+  int64_t position() const { return _position; }
+  MKSUnits::Counts positionCounts() const { return MKSUnits::Counts(_position); }
+  uint32_t segmentsSent() const { return _segmentsSent; }
+  // Completion reports that arrived before the last segment: the drive stopped between
+  // segments (lookahead too short, or firmware that does not chain relative moves).
+  uint16_t stops() const { return _stops; }
+  uint8_t corrections() const { return _corrections; }
+  uint32_t elapsedMs() const;
+
+private:
+  MKSServoE &_servo;
+  int32_t _segmentLimit;
+  uint16_t _pollIntervalMs;
+  int32_t _lookahead;
+  int32_t _tolerance;
+
+  Phase _phase;
+  MKSServoE::ERROR _rc;
+  bool _absolute;
+  int64_t _request;       // relative distance or absolute target as passed to start*()
+  uint16_t _speedRpm;
+  uint8_t _acc;
+  uint32_t _timeoutMs;
+  uint32_t _startMs;
+  uint32_t _finishedMs;
+
+  int64_t _origin;
+  int64_t _target;
+  int64_t _commandedEnd;  // origin + every segment sent so far
+  int64_t _position;
+  bool _readPending;
+  bool _readStale;        // pending read was sent before the completion report
+  uint32_t _readStartMs;
+  bool _ackPending;
+  uint32_t _ackStartMs;
+  bool _stopped;
+  uint32_t _segmentsSent;
+  uint16_t _stops;
+  uint8_t _corrections;
+  uint8_t _failedStatus;
+
+  MKSServoE::ERROR start(bool absolute, int64_t value, uint16_t speedRpm, uint8_t acc, uint32_t timeoutMs);
+  int32_t lookahead() const;
+  void updatePosition(uint32_t now);
+  void collectReports();
+  void sendSegment(uint32_t now);
+  void finish(MKSServoE::ERROR rc);
+};
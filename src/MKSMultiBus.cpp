@@ -0,0 +1,187 @@
+#include <Arduino.h>
+#include "MKSMultiBus.h"
+
+MKSMultiBus::MKSMultiBus()
+: _groups{nullptr}, _busCount(0), _slots(), _results(), _axisCount(0), _active(false), _cmd(0), _payloadLen(0),
+  _requireStatusSuccess(true), _timeoutMs(0), _pending(0), _succeeded(0) {}
+
+int8_t MKSMultiBus::addBus(MKSServoGroup &group) {
+  if (_busCount >= MAX_BUSES) {
+    return -1;
+  }
+  for (uint8_t b = 0; b < _busCount; b++) {
+    if (_groups[b] == &group) {
+      return -1;
+    }
+  }
+  _groups[_busCount] = &group;
+  return (int8_t)_busCount++;
+}
+
+int8_t MKSMultiBus::addAxis(uint8_t busIndex, MKSServoE &axis) {
+  if (busIndex >= _busCount || _axisCount >= MAX_AXES || _active) {
+    return -1;
+  }
+  MKSServoGroup &group = *_groups[busIndex];
+  if (!group.addAxis(axis)) {
+    return -1;
+  }
+  Slot &slot = _slots[_axisCount];
+  slot.bus = busIndex;
+  slot.local = (uint8_t)(group.axisCount() - 1);
+  slot.state = AXIS_IDLE;
+  return (int8_t)_axisCount++;
+}
+
+int8_t MKSMultiBus::leastLoadedBus() const {
+  int8_t best = -1;
+  for (uint8_t b = 0; b < _busCount; b++) {
+    if (best < 0 || _groups[b]->axisCount() < _groups[best]->axisCount()) {
+      best = (int8_t)b;
+    }
+  }
+  return best;
+}
+
+MKSServoGroup *MKSMultiBus::group(uint8_t busIndex) {
+  return busIndex < _busCount ? _groups[busIndex] : nullptr;
+}
+
+MKSServoE *MKSMultiBus::axis(uint8_t index) {
+  if (index >= _axisCount) {
+    return nullptr;
+  }
+  return _groups[_slots[index].bus]->axis(_slots[index].local);
+}
+
+int8_t MKSMultiBus::busOf(uint8_t index) const {
+  return index < _axisCount ? (int8_t)_slots[index].bus : -1;
+}
+
+int8_t MKSMultiBus::localIndex(uint8_t index) const {
+  return index < _axisCount ? (int8_t)_slots[index].local : -1;
+}
+
+int8_t MKSMultiBus::globalIndex(uint8_t busIndex, uint8_t localIndex) const {
+  for (uint8_t i = 0; i < _axisCount; i++) {
+    if (_slots[i].bus == busIndex && _slots[i].local == localIndex) {
+      return (int8_t)i;
+    }
+  }
+  return -1;
+}
+
+void MKSMultiBus::poll(uint8_t maxFrames) {
+  for (uint8_t b = 0; b < _busCount; b++) {
+    _groups[b]->poll(maxFrames);
+  }
+}
+
+MKSServoE::ERROR MKSMultiBus::begin(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride,
+                                    bool requireStatusSuccess, uint16_t timeoutMs) {
+  if (payloadLen > sizeof(_slots[0].payload) || (payloadLen > 0 && !payloads)) {
+    return MKSServoE::ERROR_INVALID_ARG;
+  }
+  if (_active) {
+    return MKSServoE::ERROR_BUS_SEND;
+  }
+  _cmd = cmd;
+  _payloadLen = payloadLen;
+  _requireStatusSuccess = requireStatusSuccess;
+  _timeoutMs = timeoutMs;
+  _pending = _axisCount;
+  _succeeded = 0;
+  const uint32_t now = millis();
+  for (uint8_t i = 0; i < _axisCount; i++) {
+    Slot &slot = _slots[i];
+    for (uint8_t k = 0; k < payloadLen; k++) {
+      slot.payload[k] = payloads[(uint16_t)i * stride + k];
+    }
+    slot.state = AXIS_SEND;
+    slot.startMs = now;
+    _results[i] = AxisResult{};
+    _results[i].rc = MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+  }
+  _active = _pending > 0;
+  return MKSServoE::ERROR_OK;
+}
+
+bool MKSMultiBus::update() {
+  if (!_active) {
+    return true;
+  }
+  // Enough frames per slice for one reply from every axis of a full group.
+  poll(MKSServoGroup::MAX_AXES);
+  const uint32_t now = millis();
+  bool busFull[MAX_BUSES] = { false };
+  for (uint8_t i = 0; i < _axisCount; i++) {
+    Slot &slot = _slots[i];
+    if (slot.state == AXIS_IDLE) {
+      continue;
+    }
+    MKSServoE *servo = _groups[slot.bus]->axis(slot.local);
+    if (slot.state == AXIS_SEND) {
+      if (busFull[slot.bus]) {
+        continue;
+      }
+      MKSServoE::ERROR rc = servo->sendRequest(_cmd, slot.payload, _payloadLen, _timeoutMs);
+      if (rc == MKSServoE::ERROR_OK) {
+        slot.state = AXIS_WAIT;
+        slot.startMs = now;
+      } else if (rc != MKSServoE::ERROR_BUS_SEND || (uint32_t)(now - slot.startMs) > _timeoutMs) {
+        finish(i, rc);
+      } else {
+        // A full TX mailbox only holds back the axes on that bus.
+        busFull[slot.bus] = true;
+      }
+      continue;
+    }
+
+    AxisResult &result = _results[i];
+    MKSServoE::ERROR rc = servo->takeResponse(_cmd, result.frame);
+    if (rc == MKSServoE::ERROR_OK) {
+      result.status = result.frame.dlc >= 3 ? result.frame.data[1] : 0;
+      if (_requireStatusSuccess && result.frame.dlc < 3) {
+        rc = MKSServoE::ERROR_BAD_FRAME;
+      } else if (_requireStatusSuccess && result.status == 0) {
+        rc = MKSServoE::ERROR_DEVICE_STATUS_FAIL;
+      }
+      finish(i, rc);
+    } else if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+      finish(i, rc);
+    } else if ((uint32_t)(now - slot.startMs) > _timeoutMs) {
+      finish(i, MKSServoE::ERROR_TIMEOUT);
+    }
+  }
+  return !_active;
+}
+
+MKSServoE::ERROR MKSMultiBus::run(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride,
+                                  bool requireStatusSuccess, uint16_t timeoutMs) {
+  MKSServoE::ERROR rc = begin(cmd, payloads, payloadLen, stride, requireStatusSuccess, timeoutMs);
+  if (rc != MKSServoE::ERROR_OK) {
+    return rc;
+  }
+  while (!update()) {}
+  for (uint8_t i = 0; i < _axisCount; i++) {
+    if (_results[i].rc != MKSServoE::ERROR_OK) {
+      return _results[i].rc;
+    }
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+const MKSMultiBus::AxisResult *MKSMultiBus::result(uint8_t index) const {
+  return index < _axisCount ? &_results[index] : nullptr;
+}
+
+void MKSMultiBus::finish(uint8_t index, MKSServoE::ERROR rc) {
+  _slots[index].state = AXIS_IDLE;
+  _results[index].rc = rc;
+  if (rc == MKSServoE::ERROR_OK) {
+    _succeeded++;
+  }
+  if (--_pending == 0) {
+    _active = false;
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoGroup.h"
+
+// Axes spread over several CAN interfaces, one MKSServoGroup per interface, behind a single
+// axis index. Buses never wait for each other: poll() gives every bus its own slice, and a
+// fan-out operation (begin()/update()) sends and collects on all buses side by side, so a
+// round over all axes takes as long as the busiest bus instead of the sum of all buses.
+//
+//   MKSMultiBus axes;
+//   axes.addBus(groupCan0);
+//   axes.addBus(groupCan1);
+//   axes.addAxis(0, servoA);  // global index 0
+//   axes.addAxis(1, servoB);  // global index 1
+//
+// On an MCU, update()/poll() are the I/O loop of every bus; on Linux, MKSMultiBusIo runs one
+// I/O thread per bus instead.
+class MKSMultiBus {
+public:
+  static const uint8_t MAX_BUSES = 4;
+  static const uint8_t MAX_AXES = MAX_BUSES * MKSServoGroup::MAX_AXES;
+
+  struct AxisResult {
+    MKSServoE::ERROR rc;
+    uint8_t status;  // frame.data[1] when the reply has one, else 0
+    CanFrame frame;  // full reply, for reads
+  };
+
+  MKSMultiBus();
+
+  // Returns the bus index, or -1 if all MAX_BUSES are taken or the group was added before.
+  int8_t addBus(MKSServoGroup &group);
+  // Adds the axis to the group of busIndex (the axis must have been constructed on its bus)
+  // and returns its global index, or -1 if the group refused it.
+  int8_t addAxis(uint8_t busIndex, MKSServoE &axis);
+  // Bus with the fewest axes, to construct the next axis on; -1 without buses.
+  int8_t leastLoadedBus() const;
+
+  uint8_t busCount() const { return _busCount; }
+  uint8_t axisCount() const { return _axisCount; }
+  MKSServoGroup *group(uint8_t busIndex);
+  MKSServoE *axis(uint8_t index);
+  // -1 for an unknown index.
+  int8_t busOf(uint8_t index) const;
+  int8_t localIndex(uint8_t index) const;
+  int8_t globalIndex(uint8_t busIndex, uint8_t localIndex) const;
+
+  // One poll slice per bus, up to maxFrames each.
+  void poll(uint8_t maxFrames = MKSServoE::DEFAULT_MAX_FRAMES);
+
+  // Fan-out operation: sends cmd to every axis on every bus and collects one reply each.
+  // Axis i gets payloads + i * stride, so stride 0 sends the same payload to all and
+  // stride == payloadLen takes one payload per axis from a packed array. The payloads are
+  // copied. ERROR_INVALID_ARG for payloadLen > 6; ERROR_BUS_SEND if an operation is active.
+  MKSServoE::ERROR begin(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride = 0,
+                         bool requireStatusSuccess = true, uint16_t timeoutMs = 50);
+  // Non-blocking: polls every bus, sends what the adapters accept and collects replies.
+  // Returns true once every axis has a result.
+  bool update();
+  // begin() followed by update() until done; returns the first axis error.
+  MKSServoE::ERROR run(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride = 0,
+                       bool requireStatusSuccess = true, uint16_t timeoutMs = 50);
+
+  bool active() const { return _active; }
+  const AxisResult *result(uint8_t index) const;
+  // Axes finished with ERROR_OK in the last operation.
+  uint8_t succeeded() const { return _succeeded; }
+
+private:
+  enum AxisState : uint8_t {
+    AXIS_IDLE = 0,
+    AXIS_SEND,
+    AXIS_WAIT,
+  };
+
+  struct Slot {
+    uint8_t bus;
+    uint8_t local;
+    AxisState state;
+    uint8_t payload[6];
+    uint32_t startMs;
+  };
+
+  MKSServoGroup *_groups[MAX_BUSES];
+  uint8_t _busCount;
+  Slot _slots[MAX_AXES];
+  AxisResult _results[MAX_AXES];
+  uint8_t _axisCount;
+  bool _active;
+  uint8_t _cmd;
+  uint8_t _payloadLen;
+  bool _requireStatusSuccess;
+  uint16_t _timeoutMs;
+  uint8_t _pending;
+  uint8_t _succeeded;
+
+  void finish(uint8_t index, MKSServoE::ERROR rc);
+};
@@ -2,6 +2,9 @@
 #include <stdint.h>
 #include "transport/ICanBus.h"
 #include "protocol/MksProtocol.h"
+#include "MKSUnits.h"
+
+class MKSServoGroup;
 
 class MKSServoE {
 public:
@@ -14,17 +17,35 @@ public:
     ERROR_BAD_RESPONSE,
     ERROR_INVALID_ARG,
     ERROR_DEVICE_STATUS_FAIL,
-    ERROR_NO_RESPONSE_AVAILABLE
+    ERROR_NO_RESPONSE_AVAILABLE,
+    ERROR_ABORTED,              // not attempted because an earlier step of the operation failed
+    ERROR_BUS_OFF,              // the send failed with the controller bus-off (ICanBus::recover())
+    ERROR_BUS_INIT              // the adapter could not be started at the requested bitrate
   };
 
   static const uint8_t RESPONSE_QUEUE_DEPTH = 3;
   static const uint8_t RESPONSE_QUEUE_SLOTS = 8;
   static const uint8_t DEFAULT_MAX_FRAMES = 4;
+  // Reads without payload that can share a response: 0x30-0x34, 0x39, 0x3A, 0x3E, 0x40, 0xF1.
+  static const uint8_t READ_CACHE_SIZE = 10;
+
+  // What the response queue does for a command when its frames arrive faster than they are
+  // collected, or when every slot is taken.
+  enum ResponsePolicy : uint8_t {
+    RESPONSE_POLICY_FIFO = 0,     // up to RESPONSE_QUEUE_DEPTH frames, oldest overwritten when full
+    RESPONSE_POLICY_LATEST,       // a new frame replaces the queued ones beyond one per reserved
+                                  // waiter; every replaced frame counts as dropped (telemetry)
+    RESPONSE_POLICY_KEEP,         // frames are never overwritten and the slot is never evicted for
+                                  // LATEST/DROP_NEWEST traffic; new frames are refused when full (acks)
+    RESPONSE_POLICY_DROP_NEWEST   // new frames are refused when full, never evicts another slot and is
+                                  // the first to be evicted (low-priority reads)
+  };
 
   explicit MKSServoE(ICanBus& bus);
 
   void setTargetId(uint16_t id);
   void setTxId(uint16_t id);
+  uint16_t targetId() const { return _targetId; }
 
   struct VersionInfo {
     uint8_t series;
@@ -54,11 +75,23 @@ public:
   ERROR setEnActive(uint8_t mode, uint8_t &status, uint32_t timeoutMs = 50);
   ERROR setPulseDelay(uint8_t delay, uint8_t &status, uint32_t timeoutMs = 50);
 
-  ERROR runSpeed(uint8_t dir, uint16_t speedRpm, uint8_t acc, uint8_t &status, uint32_t timeoutMs = 50);
+  // Absolute setpoints (speed, mode 2, mode 4) can be streamed with waitForResponse=false; on a
+  // PriorityTxCanBus only the newest one per axis and command waits for the bus.
+  // Position values must fit the 24-bit field (MKS::AXIS_FIELD_MIN..MAX), otherwise
+  // ERROR_INVALID_ARG and nothing is sent; MKSLongMove splits longer moves.
+  ERROR runSpeed(uint8_t dir, uint16_t speedRpm, uint8_t acc, uint8_t &status, uint32_t timeoutMs = 50, bool waitForResponse = true);
   ERROR runPositionMode1Relative(uint8_t dir, uint16_t speedRpm, uint8_t acc, int32_t pulses, uint8_t &status, uint32_t timeoutMs = 2000);
-  ERROR runPositionMode2Absolute(uint8_t dir, uint16_t speedRpm, uint8_t acc, int32_t absPulses, uint8_t &status, uint32_t timeoutMs = 2000);
+  ERROR runPositionMode2Absolute(uint8_t dir, uint16_t speedRpm, uint8_t acc, int32_t absPulses, uint8_t &status, uint32_t timeoutMs = 2000, bool waitForResponse = true);
   ERROR runPositionMode3RelativeAxis(uint16_t speedRpm, uint8_t acc, int32_t relAxis, uint8_t &status, uint32_t timeoutMs = 2000);
-  ERROR runPositionMode4AbsoluteAxis(uint16_t speedRpm, uint8_t acc, int32_t absAxis, uint8_t &status, uint32_t timeoutMs = 2000);
+  ERROR runPositionMode4AbsoluteAxis(uint16_t speedRpm, uint8_t acc, int32_t absAxis, uint8_t &status, uint32_t timeoutMs = 2000, bool waitForResponse = true);
+  // Typed variants (MKSUnits.h): the sign of the speed (runSpeed) or of the pulses (mode 1)
+  // picks the direction, the speed field takes the magnitude capped at 3000 RPM. Positions
+  // outside the 24-bit field return ERROR_INVALID_ARG.
+  ERROR runSpeed(MKSUnits::Rpm speed, uint8_t acc, uint8_t &status, uint32_t timeoutMs = 50, bool waitForResponse = true);
+  ERROR runPositionMode1Relative(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Pulses pulses, uint8_t &status, uint32_t timeoutMs = 2000);
+  ERROR runPositionMode2Absolute(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Pulses absPulses, uint8_t &status, uint32_t timeoutMs = 2000, bool waitForResponse = true);
+  ERROR runPositionMode3RelativeAxis(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Counts relAxis, uint8_t &status, uint32_t timeoutMs = 2000);
+  ERROR runPositionMode4AbsoluteAxis(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Counts absAxis, uint8_t &status, uint32_t timeoutMs = 2000, bool waitForResponse = true);
   ERROR emergencyStop(uint8_t &status, uint32_t timeoutMs = 50);
 
   ERROR setHomeConfig(uint8_t trigLevel, uint8_t homeDir, uint16_t homeSpeedRpm, uint8_t endLimitEnable, uint8_t mode, uint8_t &status, uint32_t timeoutMs = 50);
@@ -72,6 +105,10 @@ public:
   ERROR readIoStatus(uint8_t &status, uint32_t timeoutMs = 50);
   ERROR readPositionError(int32_t &error, uint32_t timeoutMs = 50);
   ERROR readEnStatus(uint8_t &enable, uint32_t timeoutMs = 50);
+  ERROR readSpeedRpm(MKSUnits::Rpm &speed, uint32_t timeoutMs = 50);
+  ERROR readEncoderAddition(MKSUnits::Counts &position, uint32_t timeoutMs = 50);
+  ERROR readInputPulses(MKSUnits::Pulses &pulses, uint32_t timeoutMs = 50);
+  ERROR readPositionError(MKSUnits::ErrorUnits &error, uint32_t timeoutMs = 50);
   ERROR releaseStallProtection(uint8_t &status, uint32_t timeoutMs = 50);
   ERROR readStallState(uint8_t &status, uint32_t timeoutMs = 50);
   ERROR restoreDefaults(uint8_t &status, uint32_t timeoutMs = 200);
@@ -91,11 +128,80 @@ public:
   ERROR setPendDivOutput(const uint8_t *payload, uint8_t payloadLen, uint8_t &status, uint32_t timeoutMs = 50);
   ERROR saveCleanSpeedMode(bool save, uint8_t &status, uint32_t timeoutMs = 50);
 
+  struct BitrateMigrationReport {
+    uint8_t failedIndex;   // index into nodeIds of the first node that failed, 0xFF if none
+    ERROR failedRc;        // error seen on that node
+    uint8_t switchedCount; // nodes that acknowledged the new bitrate
+    bool rolledBack;       // all nodes answer at the old bitrate again after a failure
+  };
+
+  // Maps an MKS::CanBitrate code to bps, 0 for unknown codes.
+  static uint32_t bitrateBps(uint8_t code);
+  // Moves every listed node and the local adapter from fromCode to toCode (MKS::CanBitrate).
+  // Nodes are probed first, switched, then verified at the new rate; on any failure the
+  // switched nodes are sent back to fromCode and the adapter is re-initialized at the old rate.
+  // ERROR_BUS_INIT if the adapter did not start at the new rate; it then goes straight back to
+  // the old rate and the switched nodes stay at the new one (rolledBack is false).
+  ERROR migrateBitrate(const uint16_t *nodeIds, uint8_t nodeCount, uint8_t fromCode, uint8_t toCode, BitrateMigrationReport *report = nullptr, uint32_t timeoutMs = 50);
+
+  struct ScanResult {
+    uint16_t id;
+    VersionInfo info;
+  };
+
+  // Sends CMD_READ_VERSION_INFO to every ID in firstId..lastId back-to-back (no per-ID wait)
+  // while collecting answers. Finishes settleMs after the last probe went out, or after budgetMs.
+  // Returns ERROR_TIMEOUT if the budget ran out before every ID was probed.
+  ERROR scanBus(uint16_t firstId, uint16_t lastId, ScanResult *results, uint8_t maxResults, uint8_t &found, uint32_t settleMs = 20, uint32_t budgetMs = 1000);
+
+  // Non-blocking request: sends cmd and reserves its response slot until the reply is
+  // collected with pollResponse/pollStatusResponse or timeoutMs expires.
+  ERROR sendRequest(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint32_t timeoutMs = 50);
+
+  // Defaults: LATEST for position/speed/error telemetry reads and 0xF1, KEEP for acks of
+  // write, homing, calibration and motion commands, DROP_NEWEST for other reads, FIFO otherwise.
+  void setResponsePolicy(uint8_t cmd, ResponsePolicy policy);
+  ResponsePolicy responsePolicy(uint8_t cmd) const { return (ResponsePolicy)_responsePolicy[cmd]; }
+  // Valid response frames that were discarded or evicted before being collected.
+  uint32_t droppedResponses() const { return _droppedResponses; }
+
+  // A read (see READ_CACHE_SIZE) issued while the same read is already in flight on this axis,
+  // from sendRequest or a blocking call made from the idle hook, sends nothing and is completed
+  // from the pending request's response. On by default.
+  void setReadDedup(bool enable) { _readDedup = enable; }
+  // Reads answered without touching the bus when the last response for that command is at most
+  // maxAgeMs old. 0 (default) disables the cache. Commands other than reads and motion
+  // setpoints clear it.
+  void setReadCacheMaxAgeMs(uint16_t maxAgeMs) { _readCacheMaxAgeMs = maxAgeMs; }
+  void clearReadCache();
+  uint32_t dedupedReads() const { return _dedupedReads; }
+  uint32_t cachedReads() const { return _cachedReads; }
+
+  // Called from blocking waits between polls with the time left before the wait gives up, so
+  // the sketch can service serial, watchdogs or other axes. Blocking calls on this driver made
+  // from inside the hook do not call it again.
+  typedef void (*IdleHook)(void *context, uint32_t remainingMs);
+  void setIdleHook(IdleHook hook, void *context = nullptr);
+  // Sleep the core between frames while waiting (ICanBus::waitForRx); off by default.
+  void setSleepWhileWaiting(bool enable) { _sleepWhileWaiting = enable; }
+
   void poll(uint8_t maxFrames = DEFAULT_MAX_FRAMES);
   ERROR pollResponse(uint8_t expectedCmd, CanFrame &rx);
+  // pollResponse without reading the bus, for callers that run poll() themselves.
+  ERROR takeResponse(uint8_t expectedCmd, CanFrame &rx);
+  // Valid frames received from this axis, replies and active reports alike.
+  uint32_t rxFrames() const { return _rxFrames; }
+  // State of the last CMD_ENABLE_BUS sent to the axis: 1, 0, or 0xFF if none was sent.
+  uint8_t requestedEnable() const { return _requestedEnable; }
+  // Group this axis was added to, nullptr when standalone.
+  MKSServoGroup *group() const { return _group; }
   ERROR pollAnyResponse(uint8_t &cmdOut, CanFrame &rx, bool skipReserved = true);
 
 private:
+  friend class MKSServoGroup;
+  // Host microbenchmarks (extras/bench/bench_queue.cpp) time the private queue helpers.
+  friend struct MKSServoEBenchAccess;
+
   struct ResponseSlot {
     bool used;
     uint8_t cmd;
@@ -111,23 +217,77 @@ private:
     uint32_t entries[RESPONSE_QUEUE_DEPTH];
   };
 
+  // One entry per enqueued frame, in arrival order. Entries whose frame has since been
+  // popped or dropped go stale and are skipped; the first live entry is always the head of
+  // the slot holding the oldest frame, which is what eviction and pollAnyResponse want.
+  struct FrameRef {
+    uint8_t slot;
+    uint32_t sequence;
+  };
+
+  // Last response of a shareable read plus the waiters still owed a copy of it.
+  struct ReadCacheEntry {
+    CanFrame frame;
+    uint32_t timeMs;
+    bool valid;
+    uint8_t shared;    // collected copies still owed to other waiters
+    uint8_t waiting;   // blocking reads currently waiting for this command
+    uint16_t targetId; // node the frame and the last request belong to
+    uint16_t txId;
+  };
+
+  static const uint8_t EVICTION_RING_SIZE = 2 * RESPONSE_QUEUE_SLOTS * RESPONSE_QUEUE_DEPTH;
+
   ICanBus& _bus;
+  MKSServoGroup *_group;
   uint16_t _targetId;
   uint16_t _txId;
   ResponseSlot _slots[RESPONSE_QUEUE_SLOTS];
+  int8_t _slotOf[256];
+  uint8_t _freeSlots[RESPONSE_QUEUE_SLOTS];
+  uint8_t _freeCount;
+  FrameRef _evictionRing[EVICTION_RING_SIZE];
+  uint8_t _evictionHead;
+  uint8_t _evictionCount;
+  uint8_t _responsePolicy[256];
+  uint32_t _droppedResponses;
   uint8_t _reservedCount[256];
   DeadlineQueue _deadlineQueues[256];
+  uint16_t _pendingDeadlines;
   uint32_t _nextSequence;
+  IdleHook _idleHook;
+  void *_idleContext;
+  bool _inIdleHook;
+  bool _sleepWhileWaiting;
+  ReadCacheEntry _readCache[READ_CACHE_SIZE];
+  bool _readDedup;
+  uint16_t _readCacheMaxAgeMs;
+  uint32_t _dedupedReads;
+  uint32_t _cachedReads;
+  uint32_t _rxFrames;
+  uint8_t _requestedEnable;
+
+  static const uint8_t BITRATE_SETTLE_MS = 20;
 
   uint8_t checksum(const uint8_t* data, uint8_t len) const;
   bool validateCrc(const CanFrame &frame) const;
+  static bool parseVersionInfo(const CanFrame &rx, VersionInfo &info);
+  void handleFrame(const CanFrame &rx);
   ERROR waitForResponse(uint8_t expectedCmd, CanFrame &rx, uint32_t timeoutMs);
+  void idle(uint32_t remainingMs);
   ERROR sendStatusCommand(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t &statusOut, uint32_t timeoutMs, bool requireStatusSuccess = true, bool waitForResponse = true);
   ERROR sendCommand(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t expectedRespCmd, CanFrame *response, uint32_t timeoutMs);
   void packSpeedFields(uint8_t dir, uint16_t speedRpm, uint8_t acc, uint8_t *outBuf);
   void clearSlot(uint8_t slotIndex);
   int8_t findSlot(uint8_t cmd) const;
   int8_t allocateSlot(uint8_t cmd);
+  bool isLive(const FrameRef &ref) const;
+  void pushFrameRef(uint8_t slotIndex, uint32_t sequence);
+  void compactEvictionRing();
+  int8_t oldestSlot(bool skipReserved);
+  uint8_t evictionRank(uint8_t cmd, bool mayEvictKeep) const;
+  int8_t evictionVictim(ResponsePolicy incoming);
+  static ResponsePolicy defaultResponsePolicy(uint8_t cmd);
   void enqueueFrame(uint8_t slotIndex, const CanFrame &frame);
   bool popFrame(uint8_t slotIndex, CanFrame &outFrame);
   bool isReserved(uint8_t cmd) const;
@@ -136,4 +296,11 @@ private:
   void pushDeadline(uint8_t cmd, uint32_t deadline);
   bool popDeadline(uint8_t cmd);
   void expireDeadlines();
+  static int8_t readCacheIndex(uint8_t cmd);
+  void forgetReads();
+  bool sameNode(const ReadCacheEntry &entry) const;
+  bool freshRead(uint8_t cmd) const;
+  bool readInFlight(uint8_t cmd) const;
+  void recordRead(uint8_t cmd, const CanFrame &rx, bool blockingWaiter);
+  bool takeSharedRead(uint8_t cmd, CanFrame &rx);
 };
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+#include "MKSServoE.h"
+
+uint32_t MKSServoE::bitrateBps(uint8_t code) {
+  switch (code) {
+    case (uint8_t)MKS::CanBitrate::Kbps125: return 125000;
+    case (uint8_t)MKS::CanBitrate::Kbps250: return 250000;
+    case (uint8_t)MKS::CanBitrate::Kbps500: return 500000;
+    case (uint8_t)MKS::CanBitrate::Mbps1:   return 1000000;
+    default: {
+      return 0;
+    }
+  }
+}
+
+MKSServoE::ERROR MKSServoE::migrateBitrate(const uint16_t *nodeIds, uint8_t nodeCount, uint8_t fromCode, uint8_t toCode, BitrateMigrationReport *report, uint32_t timeoutMs) {
+  BitrateMigrationReport local{};
+  BitrateMigrationReport &rep = report ? *report : local;
+  rep.failedIndex = 0xFF;
+  rep.failedRc = ERROR_OK;
+  rep.switchedCount = 0;
+  rep.rolledBack = false;
+
+  const uint32_t fromBps = bitrateBps(fromCode);
+  const uint32_t toBps = bitrateBps(toCode);
+  if (!nodeIds || nodeCount == 0 || fromBps == 0 || toBps == 0) {
+    return ERROR_INVALID_ARG;
+  }
+  if (fromCode == toCode) {
+    return ERROR_OK;
+  }
+
+  const uint16_t savedTarget = _targetId;
+  const uint16_t savedTx = _txId;
+  ERROR rc = ERROR_OK;
+
+  // Every node has to answer at the current rate before anything is changed.
+  for (uint8_t i = 0; i < nodeCount; i++) {
+    setTargetId(nodeIds[i]);
+    setTxId(nodeIds[i]);
+    VersionInfo info{};
+    rc = readVersionInfo(info, timeoutMs);
+    if (rc != ERROR_OK) {
+      rep.failedIndex = i;
+      rep.failedRc = rc;
+      setTargetId(savedTarget);
+      setTxId(savedTx);
+      return rc;
+    }
+  }
+
+  for (uint8_t i = 0; i < nodeCount; i++) {
+    setTargetId(nodeIds[i]);
+    setTxId(nodeIds[i]);
+    uint8_t status = 0;
+    rc = setCanBitrate(toCode, status, timeoutMs);
+    if (rc != ERROR_OK) {
+      rep.failedIndex = i;
+      rep.failedRc = rc;
+      break;
+    }
+    rep.switchedCount++;
+  }
+
+  // Drives apply the new rate right after acknowledging; give them time before re-initializing.
+  delay(BITRATE_SETTLE_MS);
+  const bool adapterSwitched = _bus.begin(toBps);
+  if (!adapterSwitched) {
+    rc = ERROR_BUS_INIT;
+  }
+
+  if (rc == ERROR_OK) {
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      setTargetId(nodeIds[i]);
+      setTxId(nodeIds[i]);
+      uint8_t enable = 0;
+      rc = readEnStatus(enable, timeoutMs);
+      if (rc != ERROR_OK) {
+        rep.failedIndex = i;
+        rep.failedRc = rc;
+        break;
+      }
+    }
+  }
+
+  if (rc != ERROR_OK) {
+    // A lost ack does not prove the node stayed at the old rate, so every node is asked to
+    // switch back; nodes that never left the old rate simply do not answer here. An adapter
+    // that failed to start at the new rate cannot send, so it goes straight back instead.
+    for (uint8_t i = 0; adapterSwitched && i < nodeCount; i++) {
+      setTargetId(nodeIds[i]);
+      setTxId(nodeIds[i]);
+      uint8_t status = 0;
+      setCanBitrate(fromCode, status, timeoutMs);
+    }
+    if (adapterSwitched) {
+      delay(BITRATE_SETTLE_MS);
+    }
+    bool restored = _bus.begin(fromBps);
+    for (uint8_t i = 0; restored && i < nodeCount; i++) {
+      setTargetId(nodeIds[i]);
+      setTxId(nodeIds[i]);
+      uint8_t enable = 0;
+      restored = readEnStatus(enable, timeoutMs) == ERROR_OK;
+    }
+    rep.rolledBack = restored;
+  }
+
+  setTargetId(savedTarget);
+  setTxId(savedTx);
+  return rc;
+}
+
+MKSServoE::ERROR MKSServoE::scanBus(uint16_t firstId, uint16_t lastId, ScanResult *results, uint8_t maxResults, uint8_t &found, uint32_t settleMs, uint32_t budgetMs) {
+  found = 0;
+  if (!results || maxResults == 0 || firstId == 0 || firstId > lastId || lastId > 0x7FF) {
+    return ERROR_INVALID_ARG;
+  }
+
+  CanFrame probe{};
+  probe.dlc = 2;
+  probe.data[0] = MKS::CMD_READ_VERSION_INFO;
+  probe.data[1] = checksum(probe.data, 1);
+
+  uint16_t nextId = firstId;
+  const uint32_t start = millis();
+  uint32_t lastSendMs = start;
+  while ((uint32_t)(millis() - start) <= budgetMs) {
+    if (nextId <= lastId) {
+      probe.id = nextId;
+      // A full TX mailbox is not an error here: drain RX and retry the same ID.
+      if (_bus.send(probe)) {
+        nextId++;
+        lastSendMs = millis();
+      }
+    } else if ((uint32_t)(millis() - lastSendMs) >= settleMs) {
+      break;
+    }
+
+    uint8_t handled = 0;
+    while (handled < DEFAULT_MAX_FRAMES && _bus.available()) {
+      CanFrame rx{};
+      if (!_bus.read(rx)) {
+        break;
+      }
+      handled++;
+      const bool isProbeAnswer = rx.dlc >= 2 && rx.data[0] == MKS::CMD_READ_VERSION_INFO &&
+                                 rx.id >= firstId && rx.id <= lastId && validateCrc(rx);
+      if (!isProbeAnswer) {
+        handleFrame(rx);
+        continue;
+      }
+      bool duplicate = false;
+      for (uint8_t i = 0; i < found; i++) {
+        if (results[i].id == rx.id) {
+          duplicate = true;
+          break;
+        }
+      }
+      if (duplicate || found >= maxResults) {
+        continue;
+      }
+      ScanResult &entry = results[found];
+      entry.id = rx.id;
+      if (parseVersionInfo(rx, entry.info)) {
+        found++;
+      }
+    }
+  }
+  return nextId <= lastId ? ERROR_TIMEOUT : ERROR_OK;
+}
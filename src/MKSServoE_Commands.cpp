@@ -204,42 +204,129 @@ MKSServoE::ERROR MKSServoE::setPulseDelay(uint8_t delay, uint8_t &status, uint32
   return sendStatusCommand(MKS::CMD_SET_PULSE_DELAY, payload, 1, status, timeoutMs);
 }
 
-MKSServoE::ERROR MKSServoE::runSpeed(uint8_t dir, uint16_t speedRpm, uint8_t acc, uint8_t &status, uint32_t timeoutMs) {
+MKSServoE::ERROR MKSServoE::runSpeed(uint8_t dir, uint16_t speedRpm, uint8_t acc, uint8_t &status, uint32_t timeoutMs, bool waitForResponse) {
   uint8_t payload[3];
   packSpeedFields(dir, speedRpm, acc, payload);
-  return sendStatusCommand(MKS::CMD_SPEED_MODE, payload, 3, status, timeoutMs);
+  return sendStatusCommand(MKS::CMD_SPEED_MODE, payload, 3, status, timeoutMs, /*requireStatusSuccess=*/true, waitForResponse);
 }
 
-static void putAxis(uint8_t *buf, int32_t value) {
+// The position field is 24 bits; put_i24_be would clamp, which silently shortens the move.
+static bool putAxis(uint8_t *buf, int32_t value) {
+  if (value < MKS::AXIS_FIELD_MIN || value > MKS::AXIS_FIELD_MAX) {
+    return false;
+  }
   MKS::put_i24_be(buf, value);
+  return true;
 }
 
 MKSServoE::ERROR MKSServoE::runPositionMode1Relative(uint8_t dir, uint16_t speedRpm, uint8_t acc, int32_t pulses, uint8_t &status, uint32_t timeoutMs) {
   uint8_t payload[6];
   packSpeedFields(dir, speedRpm, acc, payload);
-  putAxis(&payload[3], pulses);
+  if (!putAxis(&payload[3], pulses)) {
+    return ERROR_INVALID_ARG;
+  }
   return sendStatusCommand(MKS::CMD_POS_MODE1_REL_PULSES, payload, 6, status, timeoutMs, /*requireStatusSuccess=*/false);
 }
 
-MKSServoE::ERROR MKSServoE::runPositionMode2Absolute(uint8_t dir, uint16_t speedRpm, uint8_t acc, int32_t absPulses, uint8_t &status, uint32_t timeoutMs) {
+MKSServoE::ERROR MKSServoE::runPositionMode2Absolute(uint8_t dir, uint16_t speedRpm, uint8_t acc, int32_t absPulses, uint8_t &status, uint32_t timeoutMs, bool waitForResponse) {
   uint8_t payload[6];
   packSpeedFields(dir, speedRpm, acc, payload);
-  putAxis(&payload[3], absPulses);
-  return sendStatusCommand(MKS::CMD_POS_MODE2_ABS_PULSES, payload, 6, status, timeoutMs, /*requireStatusSuccess=*/false);
+  if (!putAxis(&payload[3], absPulses)) {
+    return ERROR_INVALID_ARG;
+  }
+  return sendStatusCommand(MKS::CMD_POS_MODE2_ABS_PULSES, payload, 6, status, timeoutMs, /*requireStatusSuccess=*/false, waitForResponse);
 }
 
 MKSServoE::ERROR MKSServoE::runPositionMode3RelativeAxis(uint16_t speedRpm, uint8_t acc, int32_t relAxis, uint8_t &status, uint32_t timeoutMs) {
   uint8_t payload[6];
   packSpeedFields(0, speedRpm, acc, payload);
-  putAxis(&payload[3], relAxis);
+  if (!putAxis(&payload[3], relAxis)) {
+    return ERROR_INVALID_ARG;
+  }
   return sendStatusCommand(MKS::CMD_POS_MODE3_REL_AXIS, payload, 6, status, timeoutMs, /*requireStatusSuccess=*/false);
 }
 
-MKSServoE::ERROR MKSServoE::runPositionMode4AbsoluteAxis(uint16_t speedRpm, uint8_t acc, int32_t absAxis, uint8_t &status, uint32_t timeoutMs) {
+MKSServoE::ERROR MKSServoE::runPositionMode4AbsoluteAxis(uint16_t speedRpm, uint8_t acc, int32_t absAxis, uint8_t &status, uint32_t timeoutMs, bool waitForResponse) {
   uint8_t payload[6];
   packSpeedFields(0, speedRpm, acc, payload);
-  putAxis(&payload[3], absAxis);
-  return sendStatusCommand(MKS::CMD_POS_MODE4_ABS_AXIS, payload, 6, status, timeoutMs, /*requireStatusSuccess=*/false);
+  if (!putAxis(&payload[3], absAxis)) {
+    return ERROR_INVALID_ARG;
+  }
+  return sendStatusCommand(MKS::CMD_POS_MODE4_ABS_AXIS, payload, 6, status, timeoutMs, /*requireStatusSuccess=*/false, waitForResponse);
+}
+
+// Typed variants (MKSUnits.h). Values are range-checked before narrowing to the 24-bit field.
+static bool fitsAxisField(int64_t value) {
+  return value >= MKS::AXIS_FIELD_MIN && value <= MKS::AXIS_FIELD_MAX;
+}
+
+MKSServoE::ERROR MKSServoE::runSpeed(MKSUnits::Rpm speed, uint8_t acc, uint8_t &status, uint32_t timeoutMs, bool waitForResponse) {
+  return runSpeed(MKSUnits::directionOf(speed.value), MKSUnits::speedField(speed), acc, status, timeoutMs, waitForResponse);
+}
+
+MKSServoE::ERROR MKSServoE::runPositionMode1Relative(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Pulses pulses, uint8_t &status, uint32_t timeoutMs) {
+  const int64_t magnitude = pulses.value < 0 ? -pulses.value : pulses.value;
+  if (!fitsAxisField(magnitude)) {
+    return ERROR_INVALID_ARG;
+  }
+  return runPositionMode1Relative(MKSUnits::directionOf(pulses.value), MKSUnits::speedField(speed), acc, (int32_t)magnitude, status, timeoutMs);
+}
+
+MKSServoE::ERROR MKSServoE::runPositionMode2Absolute(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Pulses absPulses, uint8_t &status, uint32_t timeoutMs, bool waitForResponse) {
+  if (!fitsAxisField(absPulses.value)) {
+    return ERROR_INVALID_ARG;
+  }
+  return runPositionMode2Absolute(0, MKSUnits::speedField(speed), acc, (int32_t)absPulses.value, status, timeoutMs, waitForResponse);
+}
+
+MKSServoE::ERROR MKSServoE::runPositionMode3RelativeAxis(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Counts relAxis, uint8_t &status, uint32_t timeoutMs) {
+  if (!fitsAxisField(relAxis.value)) {
+    return ERROR_INVALID_ARG;
+  }
+  return runPositionMode3RelativeAxis(MKSUnits::speedField(speed), acc, (int32_t)relAxis.value, status, timeoutMs);
+}
+
+MKSServoE::ERROR MKSServoE::runPositionMode4AbsoluteAxis(MKSUnits::Rpm speed, uint8_t acc, MKSUnits::Counts absAxis, uint8_t &status, uint32_t timeoutMs, bool waitForResponse) {
+  if (!fitsAxisField(absAxis.value)) {
+    return ERROR_INVALID_ARG;
+  }
+  return runPositionMode4AbsoluteAxis(MKSUnits::speedField(speed), acc, (int32_t)absAxis.value, status, timeoutMs, waitForResponse);
+}
+
+MKSServoE::ERROR MKSServoE::readSpeedRpm(MKSUnits::Rpm &speed, uint32_t timeoutMs) {
+  int16_t rpm = 0;
+  MKSServoE::ERROR rc = readSpeedRpm(rpm, timeoutMs);
+  if (rc == ERROR_OK) {
+    speed = MKSUnits::Rpm(rpm);
+  }
+  return rc;
+}
+
+MKSServoE::ERROR MKSServoE::readEncoderAddition(MKSUnits::Counts &position, uint32_t timeoutMs) {
+  int64_t value = 0;
+  MKSServoE::ERROR rc = readEncoderAddition(value, timeoutMs);
+  if (rc == ERROR_OK) {
+    position = MKSUnits::Counts(value);
+  }
+  return rc;
+}
+
+MKSServoE::ERROR MKSServoE::readInputPulses(MKSUnits::Pulses &pulses, uint32_t timeoutMs) {
+  int32_t value = 0;
+  MKSServoE::ERROR rc = readInputPulses(value, timeoutMs);
+  if (rc == ERROR_OK) {
+    pulses = MKSUnits::Pulses(value);
+  }
+  return rc;
+}
+
+MKSServoE::ERROR MKSServoE::readPositionError(MKSUnits::ErrorUnits &error, uint32_t timeoutMs) {
+  int32_t value = 0;
+  MKSServoE::ERROR rc = readPositionError(value, timeoutMs);
+  if (rc == ERROR_OK) {
+    error = MKSUnits::ErrorUnits(value);
+  }
+  return rc;
 }
 
 MKSServoE::ERROR MKSServoE::emergencyStop(uint8_t &status, uint32_t timeoutMs) {
@@ -366,16 +453,23 @@ MKSServoE::ERROR MKSServoE::readVersionInfo(VersionInfo &info, uint32_t timeoutM
   if (rc != ERROR_OK) {
     return rc;
   }
-  if (rx.dlc < 6) {
+  if (!parseVersionInfo(rx, info)) {
     return ERROR_BAD_FRAME;
   }
+  return ERROR_OK;
+}
+
+bool MKSServoE::parseVersionInfo(const CanFrame &rx, VersionInfo &info) {
+  if (rx.dlc < 6) {
+    return false;
+  }
   info.series = rx.data[1];
   info.calibrationFlag = rx.data[2];
   info.hardwareVersion = rx.data[3];
   info.firmware[0] = rx.data[4];
   info.firmware[1] = rx.data[5];
   info.firmware[2] = (rx.dlc > 6) ? rx.data[6] : 0;
-  return ERROR_OK;
+  return true;
 }
 
 MKSServoE::ERROR MKSServoE::restart(uint8_t &status, uint32_t timeoutMs) {
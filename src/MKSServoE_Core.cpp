@@ -2,12 +2,41 @@
 #include "MKSServoE.h"
 #include "protocol/MksPacking.h"
 #include "protocol/MksCrc.h"
+#include "MKSServoGroup.h"
 
 MKSServoE::MKSServoE(ICanBus& bus)
-: _bus(bus), _targetId(0x01), _txId(0x01), _slots(), _reservedCount{0}, _deadlineQueues(), _nextSequence(0) {}
+: _bus(bus), _group(nullptr), _targetId(0x01), _txId(0x01), _slots(), _freeCount(0), _evictionRing(), _evictionHead(0), _evictionCount(0),
+  _droppedResponses(0), _reservedCount{0}, _deadlineQueues(), _pendingDeadlines(0), _nextSequence(0),
+  _idleHook(nullptr), _idleContext(nullptr), _inIdleHook(false), _sleepWhileWaiting(false), _readCache(), _readDedup(true),
+  _readCacheMaxAgeMs(0), _dedupedReads(0), _cachedReads(0),
+  _rxFrames(0), _requestedEnable(0xFF) {
+  for (uint16_t cmd = 0; cmd < 256; cmd++) {
+    _slotOf[cmd] = -1;
+    _responsePolicy[cmd] = defaultResponsePolicy((uint8_t)cmd);
+  }
+  for (uint8_t i = RESPONSE_QUEUE_SLOTS; i > 0; i--) {
+    _freeSlots[_freeCount++] = (uint8_t)(i - 1);
+  }
+}
 
-void MKSServoE::setTargetId(uint16_t id) { _targetId = id; }
-void MKSServoE::setTxId(uint16_t id) { _txId = id; }
+void MKSServoE::setTargetId(uint16_t id) {
+  if (id != _targetId) {
+    forgetReads();
+  }
+  _targetId = id;
+}
+
+void MKSServoE::setTxId(uint16_t id) {
+  if (id != _txId) {
+    forgetReads();
+  }
+  _txId = id;
+}
+
+void MKSServoE::setIdleHook(IdleHook hook, void *context) {
+  _idleHook = hook;
+  _idleContext = context;
+}
 
 uint8_t MKSServoE::checksum(const uint8_t* data, uint8_t len) const {
   return MKS::crc8_sum_plus1(data, len);
@@ -26,6 +55,10 @@ void MKSServoE::clearSlot(uint8_t slotIndex) {
     return;
   }
   ResponseSlot &slot = _slots[slotIndex];
+  if (slot.used) {
+    _slotOf[slot.cmd] = -1;
+    _freeSlots[_freeCount++] = slotIndex;
+  }
   slot.used = false;
   slot.cmd = 0;
   slot.head = 0;
@@ -36,12 +69,7 @@ void MKSServoE::clearSlot(uint8_t slotIndex) {
 }
 
 int8_t MKSServoE::findSlot(uint8_t cmd) const {
-  for (uint8_t i = 0; i < RESPONSE_QUEUE_SLOTS; i++) {
-    if (_slots[i].used && _slots[i].cmd == cmd) {
-      return (int8_t)i;
-    }
-  }
-  return -1;
+  return _slotOf[cmd];
 }
 
 bool MKSServoE::isReserved(uint8_t cmd) const {
@@ -65,11 +93,13 @@ void MKSServoE::pushDeadline(uint8_t cmd, uint32_t deadline) {
   if (queue.count == RESPONSE_QUEUE_DEPTH) {
     queue.head = (uint8_t)((queue.head + 1) % RESPONSE_QUEUE_DEPTH);
     queue.count--;
+    _pendingDeadlines--;
     unreserve(cmd);
   }
   uint8_t tail = (uint8_t)((queue.head + queue.count) % RESPONSE_QUEUE_DEPTH);
   queue.entries[tail] = deadline;
   queue.count++;
+  _pendingDeadlines++;
 }
 
 bool MKSServoE::popDeadline(uint8_t cmd) {
@@ -79,10 +109,14 @@ bool MKSServoE::popDeadline(uint8_t cmd) {
   }
   queue.head = (uint8_t)((queue.head + 1) % RESPONSE_QUEUE_DEPTH);
   queue.count--;
+  _pendingDeadlines--;
   return true;
 }
 
 void MKSServoE::expireDeadlines() {
+  if (_pendingDeadlines == 0) {
+    return;
+  }
   uint32_t now = millis();
   for (uint16_t cmd = 0; cmd < 256; cmd++) {
     DeadlineQueue &queue = _deadlineQueues[cmd];
@@ -91,6 +125,7 @@ void MKSServoE::expireDeadlines() {
       if ((uint32_t)(now - deadline) < 0x80000000u) {
         queue.head = (uint8_t)((queue.head + 1) % RESPONSE_QUEUE_DEPTH);
         queue.count--;
+        _pendingDeadlines--;
         unreserve((uint8_t)cmd);
       } else {
         break;
@@ -99,58 +134,276 @@ void MKSServoE::expireDeadlines() {
   }
 }
 
-int8_t MKSServoE::allocateSlot(uint8_t cmd) {
-  int8_t existing = findSlot(cmd);
-  if (existing >= 0) {
-    return existing;
+// Setpoints leave cached reads valid; max-age already bounds how far a moving axis drifts.
+static bool isMotionCommand(uint8_t cmd) {
+  return cmd == MKS::CMD_SPEED_MODE || cmd == MKS::CMD_POS_MODE1_REL_PULSES || cmd == MKS::CMD_POS_MODE2_ABS_PULSES ||
+         cmd == MKS::CMD_POS_MODE3_REL_AXIS || cmd == MKS::CMD_POS_MODE4_ABS_AXIS;
+}
+
+int8_t MKSServoE::readCacheIndex(uint8_t cmd) {
+  switch (cmd) {
+    case MKS::CMD_READ_ENCODER_CARRY:    return 0;
+    case MKS::CMD_READ_ENCODER_ADDITION: return 1;
+    case MKS::CMD_READ_SPEED_RPM:        return 2;
+    case MKS::CMD_READ_INPUT_PULSES:     return 3;
+    case MKS::CMD_READ_IO_STATUS:        return 4;
+    case MKS::CMD_READ_POS_ERROR:        return 5;
+    case MKS::CMD_READ_EN_STATUS:        return 6;
+    case MKS::CMD_READ_STALL_STATE:      return 7;
+    case MKS::CMD_READ_VERSION_INFO:     return 8;
+    case MKS::CMD_QUERY_STATUS:          return 9;
+    default:                             return -1;
   }
+}
 
-  for (uint8_t i = 0; i < RESPONSE_QUEUE_SLOTS; i++) {
-    if (!_slots[i].used) {
-      _slots[i].used = true;
-      _slots[i].cmd = cmd;
-      _slots[i].head = 0;
-      _slots[i].count = 0;
-      return (int8_t)i;
+void MKSServoE::clearReadCache() {
+  // Copies still owed to waiters stay; only max-age hits are stopped.
+  for (uint8_t i = 0; i < READ_CACHE_SIZE; i++) {
+    _readCache[i].valid = false;
+  }
+}
+
+void MKSServoE::forgetReads() {
+  // Cached frames and copies owed from them belong to the previous node.
+  for (uint8_t i = 0; i < READ_CACHE_SIZE; i++) {
+    _readCache[i].valid = false;
+    _readCache[i].shared = 0;
+  }
+}
+
+bool MKSServoE::sameNode(const ReadCacheEntry &entry) const {
+  return entry.targetId == _targetId && entry.txId == _txId;
+}
+
+bool MKSServoE::freshRead(uint8_t cmd) const {
+  const int8_t index = readCacheIndex(cmd);
+  if (index < 0 || _readCacheMaxAgeMs == 0 || !_readCache[index].valid || !sameNode(_readCache[index])) {
+    return false;
+  }
+  return (uint32_t)(millis() - _readCache[index].timeMs) <= _readCacheMaxAgeMs;
+}
+
+bool MKSServoE::readInFlight(uint8_t cmd) const {
+  const int8_t index = readCacheIndex(cmd);
+  // Pending requests for another node must not answer this one.
+  return index >= 0 && sameNode(_readCache[index]) &&
+         (_deadlineQueues[cmd].count > 0 || _readCache[index].waiting > 0);
+}
+
+void MKSServoE::recordRead(uint8_t cmd, const CanFrame &rx, bool blockingWaiter) {
+  const int8_t index = readCacheIndex(cmd);
+  if (index < 0) {
+    return;
+  }
+  ReadCacheEntry &entry = _readCache[index];
+  entry.frame = rx;
+  entry.targetId = _targetId;
+  entry.txId = _txId;
+  // Timestamps only matter with the cache on; frames recorded while it is off never hit.
+  entry.valid = _readCacheMaxAgeMs != 0;
+  if (entry.valid) {
+    entry.timeMs = millis();
+  }
+  if (_readDedup) {
+    // Every other pending request for this read was attached to the one just answered.
+    uint16_t owed = (uint16_t)(_deadlineQueues[cmd].count + entry.waiting - (blockingWaiter ? 1 : 0));
+    entry.shared = owed > 255 ? 255 : (uint8_t)owed;
+  }
+}
+
+bool MKSServoE::takeSharedRead(uint8_t cmd, CanFrame &rx) {
+  const int8_t index = readCacheIndex(cmd);
+  if (index < 0) {
+    return false;
+  }
+  ReadCacheEntry &entry = _readCache[index];
+  if (!sameNode(entry)) {
+    return false;
+  }
+  // Waiters whose deadline expired no longer need their copy.
+  const uint16_t owed = (uint16_t)(_deadlineQueues[cmd].count + entry.waiting);
+  if (entry.shared > owed) {
+    entry.shared = (uint8_t)owed;
+  }
+  if (entry.shared == 0) {
+    return false;
+  }
+  entry.shared--;
+  rx = entry.frame;
+  return true;
+}
+
+bool MKSServoE::isLive(const FrameRef &ref) const {
+  const ResponseSlot &slot = _slots[ref.slot];
+  if (!slot.used || slot.count == 0) {
+    return false;
+  }
+  // Frames leave a slot only from its head and sequences grow monotonically, so the frame is
+  // still queued exactly when the slot's head is not newer than it.
+  return (int32_t)(slot.sequence[slot.head] - ref.sequence) <= 0;
+}
+
+void MKSServoE::compactEvictionRing() {
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < _evictionCount; i++) {
+    const FrameRef &ref = _evictionRing[(uint8_t)((_evictionHead + i) % EVICTION_RING_SIZE)];
+    if (isLive(ref)) {
+      _evictionRing[(uint8_t)((_evictionHead + kept) % EVICTION_RING_SIZE)] = ref;
+      kept++;
     }
   }
+  _evictionCount = kept;
+}
 
-  int8_t candidate = -1;
-  uint32_t bestSeq = 0xFFFFFFFFu;
-  for (uint8_t i = 0; i < RESPONSE_QUEUE_SLOTS; i++) {
-    if (!_slots[i].used || _slots[i].count == 0) {
+void MKSServoE::pushFrameRef(uint8_t slotIndex, uint32_t sequence) {
+  while (_evictionCount > 0 && !isLive(_evictionRing[_evictionHead])) {
+    _evictionHead = (uint8_t)((_evictionHead + 1) % EVICTION_RING_SIZE);
+    _evictionCount--;
+  }
+  if (_evictionCount == EVICTION_RING_SIZE) {
+    // At most SLOTS * DEPTH entries are live, so compaction always frees room.
+    compactEvictionRing();
+  }
+  FrameRef &ref = _evictionRing[(uint8_t)((_evictionHead + _evictionCount) % EVICTION_RING_SIZE)];
+  ref.slot = slotIndex;
+  ref.sequence = sequence;
+  _evictionCount++;
+}
+
+int8_t MKSServoE::oldestSlot(bool skipReserved) {
+  while (_evictionCount > 0 && !isLive(_evictionRing[_evictionHead])) {
+    _evictionHead = (uint8_t)((_evictionHead + 1) % EVICTION_RING_SIZE);
+    _evictionCount--;
+  }
+  for (uint8_t i = 0; i < _evictionCount; i++) {
+    const FrameRef &ref = _evictionRing[(uint8_t)((_evictionHead + i) % EVICTION_RING_SIZE)];
+    if (!isLive(ref)) {
       continue;
     }
-    if (isReserved(_slots[i].cmd)) {
+    if (skipReserved && isReserved(_slots[ref.slot].cmd)) {
       continue;
     }
-    uint32_t seq = _slots[i].sequence[_slots[i].head];
-    if (seq < bestSeq) {
-      bestSeq = seq;
-      candidate = (int8_t)i;
+    return (int8_t)ref.slot;
+  }
+  return -1;
+}
+
+MKSServoE::ResponsePolicy MKSServoE::defaultResponsePolicy(uint8_t cmd) {
+  switch (cmd) {
+    case MKS::CMD_READ_ENCODER_CARRY:
+    case MKS::CMD_READ_ENCODER_ADDITION:
+    case MKS::CMD_READ_SPEED_RPM:
+    case MKS::CMD_READ_INPUT_PULSES:
+    case MKS::CMD_READ_POS_ERROR:
+    case MKS::CMD_QUERY_STATUS:
+      return RESPONSE_POLICY_LATEST;
+    case MKS::CMD_READ_PARAM:
+    case MKS::CMD_READ_IO_STATUS:
+    case MKS::CMD_READ_EN_STATUS:
+    case MKS::CMD_READ_STALL_STATE:
+    case MKS::CMD_READ_VERSION_INFO:
+      return RESPONSE_POLICY_DROP_NEWEST;
+    case MKS::CMD_USER_ID:
+      return RESPONSE_POLICY_FIFO;
+    default:
+      break;
+  }
+  // Everything else on the bus answers with a status byte: parameter writes (0x36..0x9F),
+  // restart/defaults, homing, calibration and the bus-control run commands (0xF3..0xFF).
+  if (cmd >= MKS::CMD_WRITE_IO_PORT) {
+    return RESPONSE_POLICY_KEEP;
+  }
+  return RESPONSE_POLICY_FIFO;
+}
+
+void MKSServoE::setResponsePolicy(uint8_t cmd, ResponsePolicy policy) {
+  if (policy > RESPONSE_POLICY_DROP_NEWEST) {
+    return;
+  }
+  _responsePolicy[cmd] = policy;
+  int8_t slotIndex = findSlot(cmd);
+  if (policy == RESPONSE_POLICY_LATEST && slotIndex >= 0) {
+    ResponseSlot &slot = _slots[slotIndex];
+    while (slot.count > 1) {
+      slot.head = (uint8_t)((slot.head + 1) % RESPONSE_QUEUE_DEPTH);
+      slot.count--;
+      _droppedResponses++;
     }
   }
+}
 
-  if (candidate == -1) {
-    for (uint8_t i = 0; i < RESPONSE_QUEUE_SLOTS; i++) {
-      if (!_slots[i].used || _slots[i].count == 0) {
-        continue;
+uint8_t MKSServoE::evictionRank(uint8_t cmd, bool mayEvictKeep) const {
+  uint8_t rank;
+  switch (_responsePolicy[cmd]) {
+    case RESPONSE_POLICY_DROP_NEWEST: rank = 0; break;
+    case RESPONSE_POLICY_LATEST:      rank = 1; break;
+    case RESPONSE_POLICY_FIFO:        rank = 2; break;
+    default:
+      if (!mayEvictKeep) {
+        return 0xFF;
       }
-      uint32_t seq = _slots[i].sequence[_slots[i].head];
-      if (seq < bestSeq) {
-        bestSeq = seq;
-        candidate = (int8_t)i;
+      rank = 6;
+      break;
+  }
+  if (isReserved(cmd)) {
+    rank = (uint8_t)(rank + 3);
+  }
+  return rank;
+}
+
+int8_t MKSServoE::evictionVictim(ResponsePolicy incoming) {
+  if (incoming == RESPONSE_POLICY_DROP_NEWEST) {
+    return -1;
+  }
+  // KEEP slots only make way for other KEEP/FIFO responses, and only once nothing else is left.
+  const bool mayEvictKeep = incoming == RESPONSE_POLICY_KEEP || incoming == RESPONSE_POLICY_FIFO;
+  uint8_t bestRank = 0xFF;
+  for (uint8_t i = 0; i < RESPONSE_QUEUE_SLOTS; i++) {
+    if (_slots[i].used && _slots[i].count > 0) {
+      uint8_t rank = evictionRank(_slots[i].cmd, mayEvictKeep);
+      if (rank < bestRank) {
+        bestRank = rank;
       }
     }
   }
+  if (bestRank == 0xFF) {
+    return -1;
+  }
+  // Refs are in arrival order, so the first live one with the best rank is the oldest of them.
+  for (uint8_t i = 0; i < _evictionCount; i++) {
+    const FrameRef &ref = _evictionRing[(uint8_t)((_evictionHead + i) % EVICTION_RING_SIZE)];
+    if (isLive(ref) && evictionRank(_slots[ref.slot].cmd, mayEvictKeep) == bestRank) {
+      return (int8_t)ref.slot;
+    }
+  }
+  return -1;
+}
+
+int8_t MKSServoE::allocateSlot(uint8_t cmd) {
+  int8_t existing = findSlot(cmd);
+  if (existing >= 0) {
+    return existing;
+  }
+
+  if (_freeCount == 0) {
+    // A response somebody is waiting for outranks whatever its policy says.
+    ResponsePolicy incoming = isReserved(cmd) ? RESPONSE_POLICY_KEEP : (ResponsePolicy)_responsePolicy[cmd];
+    int8_t victim = evictionVictim(incoming);
+    if (victim >= 0) {
+      _droppedResponses += _slots[victim].count;
+      clearSlot((uint8_t)victim);
+    }
+  }
 
-  if (candidate >= 0) {
-    clearSlot((uint8_t)candidate);
+  int8_t candidate = -1;
+  if (_freeCount > 0) {
+    candidate = (int8_t)_freeSlots[--_freeCount];
     ResponseSlot &slot = _slots[candidate];
     slot.used = true;
     slot.cmd = cmd;
     slot.head = 0;
     slot.count = 0;
+    _slotOf[cmd] = candidate;
   }
   return candidate;
 }
@@ -160,16 +413,38 @@ void MKSServoE::enqueueFrame(uint8_t slotIndex, const CanFrame &frame) {
     return;
   }
   ResponseSlot &slot = _slots[slotIndex];
-  if (slot.count == RESPONSE_QUEUE_DEPTH) {
-    slot.head = (uint8_t)((slot.head + 1) % RESPONSE_QUEUE_DEPTH);
-    slot.count--;
+  switch (_responsePolicy[slot.cmd]) {
+    case RESPONSE_POLICY_LATEST: {
+      // Keep one frame per reserved waiter, at least the new one; older extras are replaced.
+      const uint8_t owed = _reservedCount[slot.cmd];
+      const uint8_t keep = owed == 0 ? 1 : (owed > RESPONSE_QUEUE_DEPTH ? RESPONSE_QUEUE_DEPTH : owed);
+      while (slot.count >= keep) {
+        slot.head = (uint8_t)((slot.head + 1) % RESPONSE_QUEUE_DEPTH);
+        slot.count--;
+        _droppedResponses++;
+      }
+      break;
+    }
+    case RESPONSE_POLICY_KEEP:
+    case RESPONSE_POLICY_DROP_NEWEST:
+      if (slot.count == RESPONSE_QUEUE_DEPTH) {
+        _droppedResponses++;
+        return;
+      }
+      break;
+    default:
+      if (slot.count == RESPONSE_QUEUE_DEPTH) {
+        slot.head = (uint8_t)((slot.head + 1) % RESPONSE_QUEUE_DEPTH);
+        slot.count--;
+        _droppedResponses++;
+      }
+      break;
   }
   uint8_t tail = (uint8_t)((slot.head + slot.count) % RESPONSE_QUEUE_DEPTH);
   slot.frames[tail] = frame;
   slot.sequence[tail] = _nextSequence++;
   slot.count++;
-  slot.used = true;
-  slot.cmd = frame.data[0];
+  pushFrameRef(slotIndex, slot.sequence[tail]);
 }
 
 bool MKSServoE::popFrame(uint8_t slotIndex, CanFrame &outFrame) {
@@ -191,6 +466,11 @@ bool MKSServoE::popFrame(uint8_t slotIndex, CanFrame &outFrame) {
 
 void MKSServoE::poll(uint8_t maxFrames) {
   expireDeadlines();
+  if (_group) {
+    // Grouped axes share the bus; the group reads and routes frames to their owners.
+    _group->poll(maxFrames);
+    return;
+  }
   uint8_t handled = 0;
   while (handled < maxFrames && _bus.available()) {
     CanFrame rx{};
@@ -198,24 +478,40 @@ void MKSServoE::poll(uint8_t maxFrames) {
       break;
     }
     handled++;
-    if (rx.dlc < 2) {
-      continue;
-    }
-    if (rx.id != _targetId) {
-      continue;
-    }
-    if (!validateCrc(rx)) {
-      continue;
-    }
-    int8_t slotIndex = allocateSlot(rx.data[0]);
-    if (slotIndex >= 0) {
-      enqueueFrame((uint8_t)slotIndex, rx);
-    }
+    handleFrame(rx);
+  }
+}
+
+void MKSServoE::handleFrame(const CanFrame &rx) {
+  if (rx.dlc < 2) {
+    return;
+  }
+  if (rx.id != _targetId) {
+    return;
+  }
+  if (!validateCrc(rx)) {
+    return;
+  }
+  _rxFrames++;
+  int8_t slotIndex = allocateSlot(rx.data[0]);
+  if (slotIndex >= 0) {
+    enqueueFrame((uint8_t)slotIndex, rx);
+  } else {
+    _droppedResponses++;
   }
 }
 
 MKSServoE::ERROR MKSServoE::pollResponse(uint8_t expectedCmd, CanFrame &rx) {
   poll(DEFAULT_MAX_FRAMES);
+  return takeResponse(expectedCmd, rx);
+}
+
+MKSServoE::ERROR MKSServoE::takeResponse(uint8_t expectedCmd, CanFrame &rx) {
+  if (takeSharedRead(expectedCmd, rx)) {
+    popDeadline(expectedCmd);
+    unreserve(expectedCmd);
+    return ERROR_OK;
+  }
   int8_t slotIndex = findSlot(expectedCmd);
   if (slotIndex < 0) {
     return ERROR_NO_RESPONSE_AVAILABLE;
@@ -225,27 +521,26 @@ MKSServoE::ERROR MKSServoE::pollResponse(uint8_t expectedCmd, CanFrame &rx) {
   }
   popDeadline(expectedCmd);
   unreserve(expectedCmd);
+  recordRead(expectedCmd, rx, false);
+  return ERROR_OK;
+}
+
+MKSServoE::ERROR MKSServoE::pollStatusResponse(uint8_t expectedCmd, uint8_t &statusOut) {
+  CanFrame rx{};
+  MKSServoE::ERROR rc = pollResponse(expectedCmd, rx);
+  if (rc != ERROR_OK) {
+    return rc;
+  }
+  if (rx.dlc < 3) {
+    return ERROR_BAD_FRAME;
+  }
+  statusOut = rx.data[1];
   return ERROR_OK;
 }
 
 MKSServoE::ERROR MKSServoE::pollAnyResponse(uint8_t &cmdOut, CanFrame &rx, bool skipReserved) {
   poll(DEFAULT_MAX_FRAMES);
-  int8_t candidate = -1;
-  uint32_t bestSeq = 0xFFFFFFFFu;
-  for (uint8_t i = 0; i < RESPONSE_QUEUE_SLOTS; i++) {
-    if (!_slots[i].used || _slots[i].count == 0) {
-      continue;
-    }
-    uint8_t cmd = _slots[i].cmd;
-    if (skipReserved && isReserved(cmd)) {
-      continue;
-    }
-    uint32_t seq = _slots[i].sequence[_slots[i].head];
-    if (candidate == -1 || seq < bestSeq) {
-      bestSeq = seq;
-      candidate = (int8_t)i;
-    }
-  }
+  int8_t candidate = oldestSlot(skipReserved);
   if (candidate < 0) {
     return ERROR_NO_RESPONSE_AVAILABLE;
   }
@@ -255,28 +550,75 @@ MKSServoE::ERROR MKSServoE::pollAnyResponse(uint8_t &cmdOut, CanFrame &rx, bool
   }
   popDeadline(cmdOut);
   unreserve(cmdOut);
+  recordRead(cmdOut, rx, false);
   return ERROR_OK;
 }
 
 MKSServoE::ERROR MKSServoE::waitForResponse(uint8_t expectedCmd, CanFrame &rx, uint32_t timeoutMs) {
   reserve(expectedCmd);
+  const int8_t cacheIndex = readCacheIndex(expectedCmd);
+  if (cacheIndex >= 0) {
+    _readCache[cacheIndex].waiting++;
+  }
+  MKSServoE::ERROR rc = ERROR_TIMEOUT;
   const uint32_t start = millis();
-  while ((uint32_t)(millis() - start) <= timeoutMs) {
+  uint32_t elapsed = 0;
+  while (elapsed <= timeoutMs) {
     poll(DEFAULT_MAX_FRAMES);
+    if (takeSharedRead(expectedCmd, rx)) {
+      rc = ERROR_OK;
+      break;
+    }
     int8_t slotIndex = findSlot(expectedCmd);
     if (slotIndex >= 0 && popFrame((uint8_t)slotIndex, rx)) {
-      unreserve(expectedCmd);
-      return ERROR_OK;
+      recordRead(expectedCmd, rx, true);
+      rc = ERROR_OK;
+      break;
     }
+    elapsed = millis() - start;
+    if (elapsed <= timeoutMs) {
+      idle(timeoutMs - elapsed);
+      elapsed = millis() - start;
+    }
+  }
+  if (cacheIndex >= 0) {
+    _readCache[cacheIndex].waiting--;
   }
   unreserve(expectedCmd);
-  return ERROR_TIMEOUT;
+  return rc;
+}
+
+void MKSServoE::idle(uint32_t remainingMs) {
+  if (_idleHook && !_inIdleHook) {
+    _inIdleHook = true;
+    _idleHook(_idleContext, remainingMs);
+    _inIdleHook = false;
+  }
+  if (_sleepWhileWaiting && !_bus.available()) {
+    uint32_t maxUs = remainingMs < 0xFFFFFFFFu / 1000u ? remainingMs * 1000u : 0xFFFFFFFFu;
+    _bus.waitForRx(maxUs);
+  }
 }
 
 MKSServoE::ERROR MKSServoE::sendCommand(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t expectedRespCmd, CanFrame *response, uint32_t timeoutMs) {
   if (payloadLen > 6) {
     return ERROR_INVALID_ARG;
   }
+  const int8_t cacheIndex = payloadLen == 0 ? readCacheIndex(cmd) : -1;
+  if (cacheIndex >= 0 && response) {
+    if (freshRead(cmd)) {
+      *response = _readCache[cacheIndex].frame;
+      _cachedReads++;
+      return ERROR_OK;
+    }
+    if (_readDedup && readInFlight(cmd)) {
+      _dedupedReads++;
+      return waitForResponse(expectedRespCmd, *response, timeoutMs);
+    }
+  } else if (cacheIndex < 0 && !isMotionCommand(cmd)) {
+    // Writes, homing, zeroing and restarts may change what the cached reads return.
+    clearReadCache();
+  }
 
   uint8_t buf[8] = {0};
   buf[0] = cmd;
@@ -294,26 +636,62 @@ MKSServoE::ERROR MKSServoE::sendCommand(uint8_t cmd, const uint8_t *payload, uin
   }
 
   if (!_bus.send(tx)) {
+    // Full mailboxes clear up on their own; a bus-off controller needs recover() first.
+    CanErrorStatus status{};
+    if (_bus.errorStatus(status) && status.state == CanErrorState::BusOff) {
+      return ERROR_BUS_OFF;
+    }
     return ERROR_BUS_SEND;
   }
+  if (cacheIndex >= 0) {
+    // Later reads may attach to this request only while they go to the same node.
+    _readCache[cacheIndex].targetId = _targetId;
+    _readCache[cacheIndex].txId = _txId;
+  }
+  if (cmd == MKS::CMD_ENABLE_BUS && payloadLen > 0) {
+    _requestedEnable = payload[0] ? 1 : 0;
+  }
   if (response) {
     return waitForResponse(expectedRespCmd, *response, timeoutMs);
   }
   return ERROR_OK;
 }
 
+MKSServoE::ERROR MKSServoE::sendRequest(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint32_t timeoutMs) {
+  const int8_t cacheIndex = payloadLen == 0 ? readCacheIndex(cmd) : -1;
+  if (cacheIndex >= 0) {
+    const bool fresh = freshRead(cmd);
+    if (fresh || (_readDedup && readInFlight(cmd))) {
+      // Completed by takeResponse from the cached frame or the pending request's response.
+      if (fresh) {
+        ReadCacheEntry &entry = _readCache[cacheIndex];
+        if (entry.shared < 255) {
+          entry.shared++;
+        }
+        _cachedReads++;
+      } else {
+        _dedupedReads++;
+      }
+      reserve(cmd);
+      pushDeadline(cmd, millis() + timeoutMs);
+      return ERROR_OK;
+    }
+  }
+  reserve(cmd);
+  MKSServoE::ERROR rc = sendCommand(cmd, payload, payloadLen, cmd, nullptr, timeoutMs);
+  if (rc != ERROR_OK) {
+    unreserve(cmd);
+  } else {
+    uint32_t deadline = millis() + timeoutMs;
+    pushDeadline(cmd, deadline);
+  }
+  return rc;
+}
+
 MKSServoE::ERROR MKSServoE::sendStatusCommand(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint8_t &statusOut, uint32_t timeoutMs, bool requireStatusSuccess, bool waitForResponse) {
   if (!waitForResponse) {
     statusOut = 0;
-    reserve(cmd);
-    MKSServoE::ERROR asyncRc = sendCommand(cmd, payload, payloadLen, cmd, nullptr, timeoutMs);
-    if (asyncRc != ERROR_OK) {
-      unreserve(cmd);
-    } else {
-      uint32_t deadline = millis() + timeoutMs;
-      pushDeadline(cmd, deadline);
-    }
-    return asyncRc;
+    return sendRequest(cmd, payload, payloadLen, timeoutMs);
   }
 
   CanFrame rx{};
@@ -0,0 +1,48 @@
+#include "MKSServoGroup.h"
+
+MKSServoGroup::MKSServoGroup(ICanBus &bus)
+: _bus(bus), _axes{nullptr}, _count(0) {}
+
+bool MKSServoGroup::addAxis(MKSServoE &axis) {
+  if (_count >= MAX_AXES || &axis._bus != &_bus || axis._group) {
+    return false;
+  }
+  axis._group = this;
+  _axes[_count++] = &axis;
+  return true;
+}
+
+MKSServoE *MKSServoGroup::axis(uint8_t index) {
+  if (index >= _count) {
+    return nullptr;
+  }
+  return _axes[index];
+}
+
+int8_t MKSServoGroup::indexOf(uint16_t targetId) const {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_axes[i]->_targetId == targetId) {
+      return (int8_t)i;
+    }
+  }
+  return -1;
+}
+
+void MKSServoGroup::poll(uint8_t maxFrames) {
+  uint8_t handled = 0;
+  while (handled < maxFrames && _bus.available()) {
+    CanFrame rx{};
+    if (!_bus.read(rx)) {
+      break;
+    }
+    handled++;
+    route(rx);
+  }
+}
+
+void MKSServoGroup::route(const CanFrame &rx) {
+  int8_t index = indexOf(rx.id);
+  if (index >= 0) {
+    _axes[index]->handleFrame(rx);
+  }
+}
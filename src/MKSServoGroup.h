@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoE.h"
+
+// Several MKSServoE axes sharing one ICanBus.
+// A standalone MKSServoE drops every frame whose ID is not its own target, so two drivers
+// polling the same bus would steal each other's responses. Once an axis is added here its
+// poll() goes through the group, which reads the bus once and routes frames by CAN ID.
+class MKSServoGroup {
+public:
+  static const uint8_t MAX_AXES = 16;
+
+  explicit MKSServoGroup(ICanBus &bus);
+
+  // The axis must have been constructed on the same bus. Returns false if the group is full,
+  // the bus differs, or the axis already belongs to a group.
+  bool addAxis(MKSServoE &axis);
+
+  uint8_t axisCount() const { return _count; }
+  MKSServoE *axis(uint8_t index);
+  int8_t indexOf(uint16_t targetId) const;
+  ICanBus &bus() { return _bus; }
+
+  void poll(uint8_t maxFrames = MKSServoE::DEFAULT_MAX_FRAMES);
+
+private:
+  ICanBus &_bus;
+  MKSServoE *_axes[MAX_AXES];
+  uint8_t _count;
+
+  void route(const CanFrame &rx);
+};
@@ -0,0 +1,215 @@
+#include <Arduino.h>
+#include "MKSStartupSequencer.h"
+#include "protocol/MksPacking.h"
+
+MKSStartupSequencer::Step MKSStartupSequencer::rawStep(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, bool requireStatusSuccess, uint16_t timeoutMs) {
+  Step step{};
+  step.cmd = cmd;
+  step.payloadLen = payloadLen > 6 ? 6 : payloadLen;
+  for (uint8_t i = 0; i < step.payloadLen; i++) {
+    step.payload[i] = payload[i];
+  }
+  step.requireStatusSuccess = requireStatusSuccess;
+  step.timeoutMs = timeoutMs;
+  return step;
+}
+
+MKSStartupSequencer::Step MKSStartupSequencer::enableStep(bool enable) {
+  uint8_t payload[1] = { static_cast<uint8_t>(enable ? 1 : 0) };
+  return rawStep(MKS::CMD_ENABLE_BUS, payload, 1);
+}
+
+MKSStartupSequencer::Step MKSStartupSequencer::modeStep(uint8_t mode) {
+  uint8_t payload[1] = { mode };
+  return rawStep(MKS::CMD_SET_MODE, payload, 1);
+}
+
+MKSStartupSequencer::Step MKSStartupSequencer::currentStep(uint16_t ma) {
+  uint8_t payload[2];
+  MKS::put_u16_be(payload, ma);
+  return rawStep(MKS::CMD_SET_CURRENT_MA, payload, 2);
+}
+
+MKSStartupSequencer::Step MKSStartupSequencer::microstepStep(uint8_t microstep) {
+  uint8_t payload[1] = { microstep };
+  return rawStep(MKS::CMD_SET_MICROSTEP, payload, 1);
+}
+
+MKSStartupSequencer::Step MKSStartupSequencer::homeConfigStep(uint8_t trigLevel, uint8_t homeDir, uint16_t homeSpeedRpm, uint8_t endLimitEnable, uint8_t mode) {
+  uint16_t clamped = homeSpeedRpm;
+  if (clamped > 3000) {
+    clamped = 3000;
+  }
+  uint8_t payload[6];
+  payload[0] = trigLevel;
+  payload[1] = homeDir;
+  MKS::put_u16_be(&payload[2], clamped);
+  payload[4] = endLimitEnable;
+  payload[5] = mode;
+  return rawStep(MKS::CMD_SET_HOME_PARAM, payload, 6);
+}
+
+MKSStartupSequencer::MKSStartupSequencer(MKSServoGroup &group)
+: _group(group), _plans(), _startMs(0) {}
+
+bool MKSStartupSequencer::addStep(uint8_t axisIndex, const Step &step) {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return false;
+  }
+  AxisPlan &plan = _plans[axisIndex];
+  if (plan.count >= MAX_STEPS) {
+    return false;
+  }
+  plan.steps[plan.count++] = step;
+  return true;
+}
+
+bool MKSStartupSequencer::addStepAll(const Step &step) {
+  bool ok = true;
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    ok = addStep(i, step) && ok;
+  }
+  return ok;
+}
+
+void MKSStartupSequencer::clear() {
+  for (uint8_t i = 0; i < MKSServoGroup::MAX_AXES; i++) {
+    _plans[i].count = 0;
+  }
+  start();
+}
+
+void MKSStartupSequencer::start() {
+  _startMs = millis();
+  for (uint8_t i = 0; i < MKSServoGroup::MAX_AXES; i++) {
+    AxisPlan &plan = _plans[i];
+    plan.current = 0;
+    plan.waiting = false;
+    plan.failed = false;
+    plan.stepStartMs = _startMs;
+    plan.finishedMs = _startMs;
+    for (uint8_t s = 0; s < MAX_STEPS; s++) {
+      plan.results[s].rc = MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+      plan.results[s].status = 0;
+      plan.results[s].elapsedMs = 0;
+    }
+  }
+}
+
+void MKSStartupSequencer::finishStep(AxisPlan &plan, MKSServoE::ERROR rc, uint8_t status, uint32_t now) {
+  StepResult &res = plan.results[plan.current];
+  res.rc = rc;
+  res.status = status;
+  uint32_t elapsed = now - plan.stepStartMs;
+  res.elapsedMs = (uint16_t)(elapsed > 0xFFFF ? 0xFFFF : elapsed);
+  plan.waiting = false;
+  plan.stepStartMs = now;
+  plan.finishedMs = now;
+  if (rc != MKSServoE::ERROR_OK) {
+    plan.failed = true;
+    return;
+  }
+  plan.current++;
+}
+
+bool MKSStartupSequencer::update() {
+  bool allDone = true;
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    AxisPlan &plan = _plans[i];
+    if (plan.failed || plan.current >= plan.count) {
+      continue;
+    }
+    allDone = false;
+    MKSServoE *axis = _group.axis(i);
+    const Step &step = plan.steps[plan.current];
+    const uint32_t now = millis();
+
+    if (!plan.waiting) {
+      MKSServoE::ERROR rc = axis->sendRequest(step.cmd, step.payload, step.payloadLen, step.timeoutMs);
+      if (rc == MKSServoE::ERROR_OK) {
+        plan.waiting = true;
+        plan.stepStartMs = now;
+      } else if (rc != MKSServoE::ERROR_BUS_SEND || (uint32_t)(now - plan.stepStartMs) > step.timeoutMs) {
+        // A busy TX mailbox is retried on the next update until the step times out.
+        finishStep(plan, rc, 0, now);
+      }
+      continue;
+    }
+
+    uint8_t status = 0;
+    MKSServoE::ERROR rc = axis->pollStatusResponse(step.cmd, status);
+    if (rc == MKSServoE::ERROR_OK) {
+      if (step.requireStatusSuccess && status == 0) {
+        rc = MKSServoE::ERROR_DEVICE_STATUS_FAIL;
+      }
+      finishStep(plan, rc, status, now);
+    } else if (rc != MKSServoE::ERROR_NO_RESPONSE_AVAILABLE) {
+      finishStep(plan, rc, status, now);
+    } else if ((uint32_t)(now - plan.stepStartMs) > step.timeoutMs) {
+      finishStep(plan, MKSServoE::ERROR_TIMEOUT, 0, now);
+    }
+  }
+  return allDone;
+}
+
+MKSServoE::ERROR MKSStartupSequencer::run(uint32_t timeoutMs) {
+  start();
+  while (!update()) {
+    if ((uint32_t)(millis() - _startMs) > timeoutMs) {
+      return MKSServoE::ERROR_TIMEOUT;
+    }
+  }
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    MKSServoE::ERROR rc = axisResult(i);
+    if (rc != MKSServoE::ERROR_OK) {
+      return rc;
+    }
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+bool MKSStartupSequencer::done() const {
+  for (uint8_t i = 0; i < _group.axisCount(); i++) {
+    const AxisPlan &plan = _plans[i];
+    if (!plan.failed && plan.current < plan.count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint8_t MKSStartupSequencer::stepCount(uint8_t axisIndex) const {
+  return axisIndex < MKSServoGroup::MAX_AXES ? _plans[axisIndex].count : 0;
+}
+
+uint8_t MKSStartupSequencer::completedSteps(uint8_t axisIndex) const {
+  return axisIndex < MKSServoGroup::MAX_AXES ? _plans[axisIndex].current : 0;
+}
+
+const MKSStartupSequencer::StepResult *MKSStartupSequencer::result(uint8_t axisIndex, uint8_t stepIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES || stepIndex >= _plans[axisIndex].count) {
+    return nullptr;
+  }
+  return &_plans[axisIndex].results[stepIndex];
+}
+
+MKSServoE::ERROR MKSStartupSequencer::axisResult(uint8_t axisIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return MKSServoE::ERROR_INVALID_ARG;
+  }
+  const AxisPlan &plan = _plans[axisIndex];
+  if (plan.failed) {
+    return plan.results[plan.current].rc;
+  }
+  if (plan.current < plan.count) {
+    return MKSServoE::ERROR_NO_RESPONSE_AVAILABLE;
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+uint32_t MKSStartupSequencer::axisElapsedMs(uint8_t axisIndex) const {
+  if (axisIndex >= MKSServoGroup::MAX_AXES) {
+    return 0;
+  }
+  return _plans[axisIndex].finishedMs - _startMs;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include "MKSServoGroup.h"
+
+// Runs per-axis configuration sequences (enable, mode, current, microstep, home config, ...)
+// on all axes of a group at once. Each axis keeps its own step order and waits for the ack of
+// step N before sending step N+1, but axes never wait for each other, so startup takes as long
+// as the slowest axis instead of the sum of all round-trips.
+class MKSStartupSequencer {
+public:
+  static const uint8_t MAX_STEPS = 8;
+
+  struct Step {
+    uint8_t cmd;
+    uint8_t payload[6];
+    uint8_t payloadLen;
+    bool requireStatusSuccess;
+    uint16_t timeoutMs;
+  };
+
+  struct StepResult {
+    MKSServoE::ERROR rc;
+    uint8_t status;
+    uint16_t elapsedMs;
+  };
+
+  // Step builders, packed the same way as the matching MKSServoE setters.
+  static Step enableStep(bool enable = true);
+  static Step modeStep(uint8_t mode);
+  static Step currentStep(uint16_t ma);
+  static Step microstepStep(uint8_t microstep);
+  static Step homeConfigStep(uint8_t trigLevel, uint8_t homeDir, uint16_t homeSpeedRpm, uint8_t endLimitEnable, uint8_t mode);
+  static Step rawStep(uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, bool requireStatusSuccess = true, uint16_t timeoutMs = 50);
+
+  explicit MKSStartupSequencer(MKSServoGroup &group);
+
+  bool addStep(uint8_t axisIndex, const Step &step);
+  bool addStepAll(const Step &step);
+  void clear();
+
+  void start();
+  // Non-blocking: advances every axis as far as possible. Returns true once all axes are done.
+  bool update();
+  // Blocking helper around start()/update(). Returns the first axis error, ERROR_TIMEOUT if
+  // the sequence did not finish within timeoutMs.
+  MKSServoE::ERROR run(uint32_t timeoutMs = 2000);
+
+  bool done() const;
+  uint8_t stepCount(uint8_t axisIndex) const;
+  uint8_t completedSteps(uint8_t axisIndex) const;
+  const StepResult *result(uint8_t axisIndex, uint8_t stepIndex) const;
+  // ERROR_OK once every step of the axis succeeded, otherwise the error of the failed step.
+  MKSServoE::ERROR axisResult(uint8_t axisIndex) const;
+  uint32_t axisElapsedMs(uint8_t axisIndex) const;
+
+private:
+  struct AxisPlan {
+    Step steps[MAX_STEPS];
+    StepResult results[MAX_STEPS];
+    uint8_t count;
+    uint8_t current;
+    bool waiting;
+    bool failed;
+    uint32_t stepStartMs;
+    uint32_t finishedMs;
+  };
+
+  MKSServoGroup &_group;
+  AxisPlan _plans[MKSServoGroup::MAX_AXES];
+  uint32_t _startMs;
+
+  void finishStep(AxisPlan &plan, MKSServoE::ERROR rc, uint8_t status, uint32_t now);
+};
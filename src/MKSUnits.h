@@ -0,0 +1,171 @@
+#pragma once
+#include <stdint.h>
+
+// Unit conversions for one axis, without floating point. The drive uses four scales:
+//   axis counts  encoder addition, mode 3/4 targets: 0x4000 per motor turn
+//   pulses       mode 1/2 targets, CMD_READ_INPUT_PULSES: 200 * microstep per motor turn
+//   error units  CMD_READ_POS_ERROR: 51200 per motor turn (360 degrees)
+//   RPM          motor shaft speed, CCW positive
+// MKSUnits::Scale folds the microstep setting, a gear ratio (motorTurns motor turns per
+// outputTurns output turns) and an optional lead screw (leadUm of travel per output turn) into
+// reduced integer fractions. MKSUnits::Axis<...> does the same at compile time, so every
+// conversion is a multiply and a division by constants (a shift for power-of-two microsteps),
+// rounded to nearest. The quantities are distinct types with explicit constructors, so pulses
+// cannot be passed where axis counts are expected; MKSServoE and MKSLongMove take them directly.
+//
+//   typedef MKSUnits::Axis<16, 5, 1, 5000> ZAxis;   // 16 microsteps, 5:1 gearbox, 5 mm lead
+//   servo.runPositionMode4AbsoluteAxis(ZAxis::rpm(MKSUnits::MicrometresPerSecond(2000)), 100,
+//                                      ZAxis::counts(MKSUnits::Micrometres(12500)), status);
+//
+// Kept C++11-compatible (one return per constexpr function) for older Arduino cores.
+namespace MKSUnits {
+  static constexpr int32_t COUNTS_PER_TURN = 0x4000;
+  static constexpr int32_t ERROR_PER_TURN = 51200;
+  static constexpr int32_t FULL_STEPS_PER_TURN = 200;
+  // Largest speed field of the motion commands.
+  static constexpr uint16_t MAX_SPEED_RPM = 3000;
+
+  template <typename Tag, typename T>
+  struct Quantity {
+    typedef T Value;
+    T value;
+    constexpr Quantity() : value(0) {}
+    constexpr explicit Quantity(T v) : value(v) {}
+  };
+
+  template <typename Tag, typename T>
+  constexpr Quantity<Tag, T> operator+(Quantity<Tag, T> a, Quantity<Tag, T> b) { return Quantity<Tag, T>((T)(a.value + b.value)); }
+  template <typename Tag, typename T>
+  constexpr Quantity<Tag, T> operator-(Quantity<Tag, T> a, Quantity<Tag, T> b) { return Quantity<Tag, T>((T)(a.value - b.value)); }
+  template <typename Tag, typename T>
+  constexpr Quantity<Tag, T> operator-(Quantity<Tag, T> a) { return Quantity<Tag, T>((T)-a.value); }
+  template <typename Tag, typename T>
+  constexpr bool operator==(Quantity<Tag, T> a, Quantity<Tag, T> b) { return a.value == b.value; }
+  template <typename Tag, typename T>
+  constexpr bool operator!=(Quantity<Tag, T> a, Quantity<Tag, T> b) { return a.value != b.value; }
+  template <typename Tag, typename T>
+  constexpr bool operator<(Quantity<Tag, T> a, Quantity<Tag, T> b) { return a.value < b.value; }
+  template <typename Tag, typename T>
+  constexpr bool operator>(Quantity<Tag, T> a, Quantity<Tag, T> b) { return a.value > b.value; }
+  template <typename Tag, typename T>
+  constexpr bool operator<=(Quantity<Tag, T> a, Quantity<Tag, T> b) { return a.value <= b.value; }
+  template <typename Tag, typename T>
+  constexpr bool operator>=(Quantity<Tag, T> a, Quantity<Tag, T> b) { return a.value >= b.value; }
+
+  // Motor side, in the drive's own units. Positions are 64-bit so conversions never wrap; the
+  // commands range-check them against the 24-bit field.
+  typedef Quantity<struct CountsTag, int64_t> Counts;
+  typedef Quantity<struct PulsesTag, int64_t> Pulses;
+  typedef Quantity<struct ErrorUnitsTag, int64_t> ErrorUnits;
+  typedef Quantity<struct RpmTag, int32_t> Rpm;
+  // Output side, after the gearing (and lead screw).
+  typedef Quantity<struct MilliDegreesTag, int64_t> MilliDegrees;
+  typedef Quantity<struct MicrometresTag, int64_t> Micrometres;
+  typedef Quantity<struct MilliDegreesPerSecondTag, int32_t> MilliDegreesPerSecond;
+  typedef Quantity<struct MicrometresPerSecondTag, int32_t> MicrometresPerSecond;
+
+  struct Ratio {
+    int64_t num;
+    int64_t den;
+  };
+
+  constexpr int64_t gcd(int64_t a, int64_t b) { return b == 0 ? a : gcd(b, a % b); }
+  constexpr Ratio reduce(int64_t num, int64_t den) {
+    return gcd(num, den) == 0 ? Ratio{ 0, 0 } : Ratio{ num / gcd(num, den), den / gcd(num, den) };
+  }
+  constexpr Ratio invert(Ratio r) { return Ratio{ r.den, r.num }; }
+
+  // value * r rounded to nearest, halves away from zero; 0 for an undefined ratio (no lead
+  // screw, zero turns). value * r.num must fit in 64 bits.
+  constexpr int64_t apply(int64_t value, Ratio r) {
+    return r.den == 0 ? 0
+         : r.den == 1 ? value * r.num
+         : value < 0 ? -((-value * r.num + r.den / 2) / r.den)
+         : (value * r.num + r.den / 2) / r.den;
+  }
+
+  // Speeds are 32-bit; conversions that leave the range saturate.
+  constexpr int32_t saturate32(int64_t value) {
+    return value > 2147483647LL ? (int32_t)2147483647 : value < -2147483648LL ? (int32_t)(-2147483647 - 1) : (int32_t)value;
+  }
+
+  // Magnitude for the speed field of the motion commands, capped at MAX_SPEED_RPM.
+  constexpr uint16_t speedField(Rpm speed) {
+    return speed.value < 0 ? speedField(Rpm(-speed.value))
+         : speed.value > MAX_SPEED_RPM ? MAX_SPEED_RPM : (uint16_t)speed.value;
+  }
+  // Direction bit of runSpeed/mode 1 for a signed speed or distance (set = CW, negative).
+  constexpr uint8_t directionOf(int64_t signedValue) { return signedValue < 0 ? 1 : 0; }
+
+  class Scale {
+  public:
+    // microstep as passed to setMicrostep (0 = 256); leadUm 0 for rotary axes.
+    constexpr Scale(uint16_t microstep, uint32_t motorTurns = 1, uint32_t outputTurns = 1, uint32_t leadUm = 0)
+    : _pulsesPerCount(reduce((int64_t)FULL_STEPS_PER_TURN * (microstep ? microstep : 256), COUNTS_PER_TURN)),
+      _errorPerCount(reduce(ERROR_PER_TURN, COUNTS_PER_TURN)),
+      _mdegPerCount(reduce(360000LL * outputTurns, (int64_t)COUNTS_PER_TURN * motorTurns)),
+      _umPerCount(reduce((int64_t)leadUm * outputTurns, (int64_t)COUNTS_PER_TURN * motorTurns)),
+      _mdegPerSecondPerRpm(reduce(6000LL * outputTurns, motorTurns)),
+      _umPerSecondPerRpm(reduce((int64_t)leadUm * outputTurns, 60LL * motorTurns)) {}
+
+    constexpr Pulses pulses(Counts c) const { return Pulses(apply(c.value, _pulsesPerCount)); }
+    constexpr Counts counts(Pulses p) const { return Counts(apply(p.value, invert(_pulsesPerCount))); }
+    constexpr ErrorUnits error(Counts c) const { return ErrorUnits(apply(c.value, _errorPerCount)); }
+    constexpr Counts counts(ErrorUnits e) const { return Counts(apply(e.value, invert(_errorPerCount))); }
+    constexpr MilliDegrees milliDegrees(Counts c) const { return MilliDegrees(apply(c.value, _mdegPerCount)); }
+    constexpr Counts counts(MilliDegrees d) const { return Counts(apply(d.value, invert(_mdegPerCount))); }
+    constexpr Micrometres micrometres(Counts c) const { return Micrometres(apply(c.value, _umPerCount)); }
+    constexpr Counts counts(Micrometres d) const { return Counts(apply(d.value, invert(_umPerCount))); }
+
+    constexpr MilliDegreesPerSecond milliDegreesPerSecond(Rpm r) const {
+      return MilliDegreesPerSecond(saturate32(apply(r.value, _mdegPerSecondPerRpm)));
+    }
+    constexpr Rpm rpm(MilliDegreesPerSecond v) const { return Rpm(saturate32(apply(v.value, invert(_mdegPerSecondPerRpm)))); }
+    constexpr MicrometresPerSecond micrometresPerSecond(Rpm r) const {
+      return MicrometresPerSecond(saturate32(apply(r.value, _umPerSecondPerRpm)));
+    }
+    constexpr Rpm rpm(MicrometresPerSecond v) const { return Rpm(saturate32(apply(v.value, invert(_umPerSecondPerRpm)))); }
+
+  private:
+    Ratio _pulsesPerCount;
+    Ratio _errorPerCount;
+    Ratio _mdegPerCount;
+    Ratio _umPerCount;
+    Ratio _mdegPerSecondPerRpm;
+    Ratio _umPerSecondPerRpm;
+  };
+
+  // Scale fixed at compile time; MICROSTEP as for setMicrostep (0 = 256).
+  template <uint16_t MICROSTEP, uint32_t MOTOR_TURNS = 1, uint32_t OUTPUT_TURNS = 1, uint32_t LEAD_UM = 0>
+  struct Axis {
+    static_assert(MOTOR_TURNS > 0 && OUTPUT_TURNS > 0, "gear ratio needs non-zero turns");
+
+    static constexpr Scale scale() { return Scale(MICROSTEP, MOTOR_TURNS, OUTPUT_TURNS, LEAD_UM); }
+
+    static constexpr Pulses pulses(Counts c) { return scale().pulses(c); }
+    static constexpr Counts counts(Pulses p) { return scale().counts(p); }
+    static constexpr ErrorUnits error(Counts c) { return scale().error(c); }
+    static constexpr Counts counts(ErrorUnits e) { return scale().counts(e); }
+    static constexpr MilliDegrees milliDegrees(Counts c) { return scale().milliDegrees(c); }
+    static constexpr Counts counts(MilliDegrees d) { return scale().counts(d); }
+    static constexpr MilliDegreesPerSecond milliDegreesPerSecond(Rpm r) { return scale().milliDegreesPerSecond(r); }
+    static constexpr Rpm rpm(MilliDegreesPerSecond v) { return scale().rpm(v); }
+
+    static constexpr Micrometres micrometres(Counts c) {
+      static_assert(LEAD_UM > 0, "linear units need LEAD_UM");
+      return scale().micrometres(c);
+    }
+    static constexpr Counts counts(Micrometres d) {
+      static_assert(LEAD_UM > 0, "linear units need LEAD_UM");
+      return scale().counts(d);
+    }
+    static constexpr MicrometresPerSecond micrometresPerSecond(Rpm r) {
+      static_assert(LEAD_UM > 0, "linear units need LEAD_UM");
+      return scale().micrometresPerSecond(r);
+    }
+    static constexpr Rpm rpm(MicrometresPerSecond v) {
+      static_assert(LEAD_UM > 0, "linear units need LEAD_UM");
+      return scale().rpm(v);
+    }
+  };
+}
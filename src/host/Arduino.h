@@ -0,0 +1,19 @@
+#pragma once
+// Minimal Arduino.h stand-in for host (Linux/macOS) builds of the library.
+// Add src/host to the include path so the driver's #include <Arduino.h> resolves here;
+// only the timing functions the library uses are provided.
+#include <stdint.h>
+
+namespace HostClock {
+  // Real (steady) time by default. In virtual mode time only moves through advanceUs(),
+  // which lets simulations run faster than real time and stay reproducible.
+  void setVirtual(bool enabled);
+  bool isVirtual();
+  void advanceUs(uint64_t us);
+  uint64_t nowUs();
+}
+
+inline uint32_t millis() { return (uint32_t)(HostClock::nowUs() / 1000); }
+inline uint32_t micros() { return (uint32_t)HostClock::nowUs(); }
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
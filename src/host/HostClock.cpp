@@ -0,0 +1,53 @@
+#if !defined(ARDUINO)
+
+#include "Arduino.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+std::atomic<bool> virtualMode(false);
+std::atomic<uint64_t> virtualUs(0);
+
+uint64_t steadyUs() {
+  static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+} // namespace
+
+namespace HostClock {
+void setVirtual(bool enabled) {
+  if (enabled && !virtualMode) {
+    virtualUs = steadyUs();
+  }
+  virtualMode = enabled;
+}
+
+bool isVirtual() {
+  return virtualMode;
+}
+
+void advanceUs(uint64_t us) {
+  if (virtualMode) {
+    virtualUs += us;
+  }
+}
+
+uint64_t nowUs() {
+  return virtualMode ? virtualUs.load() : steadyUs();
+}
+} // namespace HostClock
+
+void delay(uint32_t ms) {
+  delayMicroseconds(ms * 1000u);
+}
+
+void delayMicroseconds(uint32_t us) {
+  if (HostClock::isVirtual()) {
+    HostClock::advanceUs(us);
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+#endif // !defined(ARDUINO)
@@ -0,0 +1,337 @@
+#if !defined(ARDUINO)
+
+#include "MKSBusMonitor.h"
+#include "Arduino.h"
+#include <string.h>
+#include "../protocol/MksCommands.h"
+#include "../protocol/MksCrc.h"
+#include "../protocol/MksPacking.h"
+
+namespace {
+const uint16_t D2 = 1u << 2;
+const uint16_t D3 = 1u << 3;
+const uint16_t D4 = 1u << 4;
+const uint16_t D5 = 1u << 5;
+const uint16_t D6 = 1u << 6;
+const uint16_t D7 = 1u << 7;
+const uint16_t D8 = 1u << 8;
+const uint16_t D3_TO_8 = D3 | D4 | D5 | D6 | D7 | D8;
+
+typedef MKSBusMonitor M;
+
+// Request and reply shapes from the manual as sent and parsed by MKSServoE. Every command
+// answers with a 3-byte status ack unless its reply layout says otherwise.
+const M::CommandInfo COMMANDS[] = {
+  { MKS::CMD_READ_PARAM,               "READ_PARAM",             M::LAYOUT_PARAM,      D3,      M::LAYOUT_PARAM,   D3_TO_8 },
+  { MKS::CMD_READ_ENCODER_CARRY,       "READ_ENCODER_CARRY",     M::LAYOUT_NONE,       D2,      M::LAYOUT_CARRY,   D8 },
+  { MKS::CMD_READ_ENCODER_ADDITION,    "READ_ENCODER_ADDITION",  M::LAYOUT_NONE,       D2,      M::LAYOUT_I48,     D8 },
+  { MKS::CMD_READ_SPEED_RPM,           "READ_SPEED_RPM",         M::LAYOUT_NONE,       D2,      M::LAYOUT_I16,     D4 },
+  { MKS::CMD_READ_INPUT_PULSES,        "READ_INPUT_PULSES",      M::LAYOUT_NONE,       D2,      M::LAYOUT_I32,     D6 },
+  { MKS::CMD_READ_IO_STATUS,           "READ_IO_STATUS",         M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_WRITE_IO_PORT,            "WRITE_IO_PORT",          M::LAYOUT_U16,        D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_READ_POS_ERROR,           "READ_POS_ERROR",         M::LAYOUT_NONE,       D2,      M::LAYOUT_I32,     D6 },
+  { MKS::CMD_READ_EN_STATUS,           "READ_EN_STATUS",         M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_RELEASE_STALL_PROTECT,    "RELEASE_STALL_PROTECT",  M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_READ_STALL_STATE,         "READ_STALL_STATE",       M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_RESTORE_DEFAULTS,         "RESTORE_DEFAULTS",       M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_READ_VERSION_INFO,        "READ_VERSION_INFO",      M::LAYOUT_NONE,       D2,      M::LAYOUT_VERSION, D7 | D8 },
+  { MKS::CMD_RESTART,                  "RESTART",                M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_USER_ID,                  "USER_ID",                M::LAYOUT_U32,        D2 | D6, M::LAYOUT_U32,     D3 | D6 },
+  { MKS::CMD_CALIBRATE_ENCODER,        "CALIBRATE_ENCODER",      M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_MODE,                 "SET_MODE",               M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_CURRENT_MA,           "SET_CURRENT_MA",         M::LAYOUT_U16,        D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_MICROSTEP,            "SET_MICROSTEP",          M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_EN_ACTIVE,            "SET_EN_ACTIVE",          M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_DIR,                  "SET_DIR",                M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_PULSE_DELAY,          "SET_PULSE_DELAY",        M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_STALL_PROTECT_ENABLE, "SET_STALL_PROTECT",      M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_STALL_TOLERANCE,      "SET_STALL_TOLERANCE",    M::LAYOUT_U16,        D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_CAN_BITRATE,          "SET_CAN_BITRATE",        M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_CAN_ID,               "SET_CAN_ID",             M::LAYOUT_U16,        D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_RESPOND_ACTIVE,       "SET_RESPOND_ACTIVE",     M::LAYOUT_U16,        D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_GROUP_ID,             "SET_GROUP_ID",           M::LAYOUT_U16,        D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_LOCK_AXIS,                "LOCK_AXIS",              M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_HOME_PARAM,           "SET_HOME_PARAM",         M::LAYOUT_RAW,        D8,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_GO_HOME,                  "GO_HOME",                M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_AXIS_ZERO,            "SET_AXIS_ZERO",          M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_NOLIMIT_HOME_CURRENT, "SET_NOLIMIT_HOME_CURRENT", M::LAYOUT_U16,      D4,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_NOLIMIT_HOME_PARAM,   "SET_NOLIMIT_HOME_PARAM", M::LAYOUT_RAW,        D3_TO_8, M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_REMAP_LIMIT_PORT,         "REMAP_LIMIT_PORT",       M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SET_PULSE_DIV_OUTPUT,     "SET_PULSE_DIV_OUTPUT",   M::LAYOUT_RAW,        D3_TO_8, M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_QUERY_STATUS,             "QUERY_STATUS",           M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_ENABLE_BUS,               "ENABLE_BUS",             M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_POS_MODE3_REL_AXIS,       "POS_MODE3_REL_AXIS",     M::LAYOUT_SPEED_AXIS, D8,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_POS_MODE4_ABS_AXIS,       "POS_MODE4_ABS_AXIS",     M::LAYOUT_SPEED_AXIS, D8,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SPEED_MODE,               "SPEED_MODE",             M::LAYOUT_SPEED,      D5,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_EMERGENCY_STOP,           "EMERGENCY_STOP",         M::LAYOUT_NONE,       D2,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_POS_MODE1_REL_PULSES,     "POS_MODE1_REL_PULSES",   M::LAYOUT_SPEED_AXIS, D8,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_POS_MODE2_ABS_PULSES,     "POS_MODE2_ABS_PULSES",   M::LAYOUT_SPEED_AXIS, D8,      M::LAYOUT_STATUS,  D3 },
+  { MKS::CMD_SAVE_CLEAN_SPEEDMODE,     "SAVE_CLEAN_SPEEDMODE",   M::LAYOUT_U8,         D3,      M::LAYOUT_STATUS,  D3 },
+};
+const uint8_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+const uint8_t NO_ENTRY = 0xFF;
+
+// Command byte to COMMANDS index.
+struct CommandIndex {
+  uint8_t entry[256];
+  CommandIndex() {
+    memset(entry, NO_ENTRY, sizeof(entry));
+    for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+      entry[COMMANDS[i].cmd] = i;
+    }
+  }
+};
+const CommandIndex INDEX;
+
+// Payload bytes (without command byte and CRC) each layout needs.
+const uint8_t LAYOUT_BYTES[] = { 0, 1, 1, 2, 2, 4, 4, 6, 6, 3, 6, 5, 1, 0 };
+}
+
+MKSBusMonitor::MKSBusMonitor() : _handler(nullptr), _context(nullptr), _timeoutUs(100000) {
+  reset();
+}
+
+void MKSBusMonitor::setEventHandler(EventHandler handler, void *context) {
+  _handler = handler;
+  _context = context;
+}
+
+void MKSBusMonitor::reset() {
+  memset(_nodes, 0, sizeof(_nodes));
+  memset(&_event, 0, sizeof(_event));
+  resetStats();
+}
+
+void MKSBusMonitor::resetStats() {
+  for (uint16_t i = 0; i <= MAX_NODE_ID; i++) {
+    memset(&_nodes[i].stats, 0, sizeof(NodeStats));
+    _nodes[i].stats.latencyMinUs = UINT32_MAX;
+  }
+  _frames = 0;
+  _unknownFrames = 0;
+}
+
+const MKSBusMonitor::CommandInfo *MKSBusMonitor::lookup(uint8_t cmd) {
+  const uint8_t i = INDEX.entry[cmd];
+  return i == NO_ENTRY ? nullptr : &COMMANDS[i];
+}
+
+MKSBusMonitor::Direction MKSBusMonitor::directionFromFlags(uint8_t captureFlags) {
+  if (!(captureFlags & MKSCapture::FLAG_DIR_KNOWN)) {
+    return DIR_UNKNOWN;
+  }
+  return (captureFlags & MKSCapture::FLAG_TO_DRIVE) ? DIR_TO_DRIVE : DIR_FROM_DRIVE;
+}
+
+void MKSBusMonitor::expire(NodeState &node, uint64_t nowUs) {
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < node.pendingCount; i++) {
+    if (nowUs > node.pendingUs[i] && nowUs - node.pendingUs[i] > _timeoutUs) {
+      node.stats.unanswered++;
+      continue;
+    }
+    node.pendingCmd[kept] = node.pendingCmd[i];
+    node.pendingUs[kept] = node.pendingUs[i];
+    kept++;
+  }
+  node.pendingCount = kept;
+}
+
+bool MKSBusMonitor::hasPending(const NodeState &node, uint8_t cmd) const {
+  for (uint8_t i = 0; i < node.pendingCount; i++) {
+    if (node.pendingCmd[i] == cmd) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MKSBusMonitor::addPending(NodeState &node, uint8_t cmd, uint64_t nowUs) {
+  if (node.pendingCount == PENDING_PER_NODE) {
+    // Oldest command is given up on.
+    node.stats.unanswered++;
+    for (uint8_t i = 1; i < PENDING_PER_NODE; i++) {
+      node.pendingCmd[i - 1] = node.pendingCmd[i];
+      node.pendingUs[i - 1] = node.pendingUs[i];
+    }
+    node.pendingCount--;
+  }
+  node.pendingCmd[node.pendingCount] = cmd;
+  node.pendingUs[node.pendingCount] = nowUs;
+  node.pendingCount++;
+}
+
+bool MKSBusMonitor::takePending(NodeState &node, uint8_t cmd, uint64_t nowUs, uint32_t &latencyUs) {
+  for (uint8_t i = 0; i < node.pendingCount; i++) {
+    if (node.pendingCmd[i] != cmd) {
+      continue;
+    }
+    latencyUs = nowUs > node.pendingUs[i] ? (uint32_t)(nowUs - node.pendingUs[i]) : 0;
+    for (uint8_t j = i + 1; j < node.pendingCount; j++) {
+      node.pendingCmd[j - 1] = node.pendingCmd[j];
+      node.pendingUs[j - 1] = node.pendingUs[j];
+    }
+    node.pendingCount--;
+    return true;
+  }
+  return false;
+}
+
+void MKSBusMonitor::decodePayload(Layout layout, const CanFrame &f, Event &ev) {
+  const uint8_t *p = &f.data[1];
+  const uint8_t len = f.dlc >= 2 ? (uint8_t)(f.dlc - 2) : 0;
+  if (len < LAYOUT_BYTES[layout]) {
+    ev.layout = LAYOUT_RAW;
+    return;
+  }
+  ev.layout = layout;
+  switch (layout) {
+    case LAYOUT_STATUS:
+    case LAYOUT_U8:     ev.value = p[0]; break;
+    case LAYOUT_U16:    ev.value = MKS::get_u16_be(p); break;
+    case LAYOUT_I16:    ev.value = (int16_t)MKS::get_u16_be(p); break;
+    case LAYOUT_I32:    ev.value = (int32_t)MKS::get_u32_be(p); break;
+    case LAYOUT_U32:    ev.value = MKS::get_u32_be(p); break;
+    case LAYOUT_I48:    ev.value = MKS::get_i48_be(p); break;
+    case LAYOUT_CARRY: {
+      ev.value = (int32_t)MKS::get_u32_be(p);
+      ev.aux = MKS::get_u16_be(&p[4]);
+      break;
+    }
+    case LAYOUT_SPEED_AXIS:
+      ev.value = MKS::get_i24_be(&p[3]);
+      // fall through
+    case LAYOUT_SPEED: {
+      ev.dir = (uint8_t)(p[0] >> 7);
+      ev.speedRpm = (uint16_t)(((p[0] & 0x7F) << 8) | p[1]);
+      ev.acc = p[2];
+      break;
+    }
+    case LAYOUT_VERSION: {
+      ev.code = p[0];
+      ev.aux = (uint16_t)((p[1] << 8) | p[2]);
+      ev.value = ((int64_t)p[3] << 16) | ((int64_t)p[4] << 8) | (len > 5 ? p[5] : 0);
+      break;
+    }
+    case LAYOUT_PARAM:  ev.code = p[0]; break;
+    default: break;
+  }
+}
+
+const MKSBusMonitor::Event &MKSBusMonitor::feed(const CanFrame &f, uint64_t timestampUs, Direction dir) {
+  Event &ev = _event;
+  memset(&ev, 0, sizeof(ev));
+  ev.frame = f;
+  if (ev.frame.dlc > 8) {
+    ev.frame.dlc = 8;
+  }
+  const uint8_t dlc = ev.frame.dlc;
+  ev.timestampUs = timestampUs;
+  ev.nodeId = f.id & MAX_NODE_ID;
+  ev.cmd = dlc > 0 ? f.data[0] : 0;
+  ev.crcOk = dlc >= 2 && MKS::crc8_sum_plus1(f.data, dlc - 1) == f.data[dlc - 1];
+  ev.directionKnown = dir != DIR_UNKNOWN;
+  ev.info = dlc > 0 ? lookup(ev.cmd) : nullptr;
+  _frames++;
+
+  NodeState &node = _nodes[ev.nodeId];
+  expire(node, timestampUs);
+  if (!ev.crcOk) {
+    node.stats.crcErrors++;
+  }
+
+  if (dir != DIR_UNKNOWN) {
+    ev.kind = dir == DIR_TO_DRIVE ? KIND_COMMAND : KIND_RESPONSE;
+  } else if (!ev.info || dlc < 2) {
+    ev.kind = KIND_UNKNOWN;
+  } else {
+    const uint16_t bit = (uint16_t)(1u << dlc);
+    const bool asRequest = (ev.info->requestDlcs & bit) != 0;
+    const bool asResponse = (ev.info->responseDlcs & bit) != 0;
+    if (asRequest && asResponse) {
+      ev.kind = hasPending(node, ev.cmd) ? KIND_RESPONSE : KIND_COMMAND;
+    } else if (asRequest) {
+      ev.kind = KIND_COMMAND;
+    } else if (asResponse) {
+      ev.kind = KIND_RESPONSE;
+    } else {
+      ev.kind = KIND_UNKNOWN;
+    }
+  }
+
+  switch (ev.kind) {
+    case KIND_COMMAND: {
+      node.stats.commands++;
+      // Broadcast frames are never answered; a corrupted command is ignored by the drive.
+      if (ev.crcOk && ev.nodeId != 0) {
+        addPending(node, ev.cmd, timestampUs);
+      }
+      if (ev.info) {
+        decodePayload(dlc == 2 ? LAYOUT_NONE : ev.info->request, ev.frame, ev);
+      } else {
+        ev.layout = LAYOUT_RAW;
+      }
+      break;
+    }
+    case KIND_RESPONSE: {
+      node.stats.responses++;
+      // A reply with a bad CRC still answers its command (the host discards it and may retry);
+      // leaving the command outstanding would pair every later reply with an older command.
+      if (takePending(node, ev.cmd, timestampUs, ev.latencyUs)) {
+        ev.matched = true;
+        NodeStats &st = node.stats;
+        st.latencyCount++;
+        st.latencySumUs += ev.latencyUs;
+        if (ev.latencyUs < st.latencyMinUs) {
+          st.latencyMinUs = ev.latencyUs;
+        }
+        if (ev.latencyUs > st.latencyMaxUs) {
+          st.latencyMaxUs = ev.latencyUs;
+        }
+      } else if (ev.crcOk) {
+        node.stats.unsolicited++;
+      }
+      if (ev.info) {
+        const Layout layout = (dlc == 3 && ev.info->response != LAYOUT_PARAM) ? LAYOUT_STATUS : ev.info->response;
+        decodePayload(layout, ev.frame, ev);
+      } else {
+        ev.layout = LAYOUT_RAW;
+      }
+      break;
+    }
+    default: {
+      _unknownFrames++;
+      ev.layout = LAYOUT_RAW;
+      break;
+    }
+  }
+
+  if (_handler) {
+    _handler(_context, ev);
+  }
+  return ev;
+}
+
+uint32_t MKSBusMonitor::poll(ICanBus &bus) {
+  uint32_t count = 0;
+  CanFrame f;
+  while (bus.available() && bus.read(f)) {
+    feed(f, HostClock::nowUs());
+    count++;
+  }
+  return count;
+}
+
+uint32_t MKSBusMonitor::replay(MKSCaptureReader &reader) {
+  uint32_t count = 0;
+  CanFrame f;
+  uint64_t timestampUs = 0;
+  uint8_t flags = 0;
+  while (reader.next(f, timestampUs, flags)) {
+    feed(f, timestampUs, directionFromFlags(flags));
+    count++;
+  }
+  return count;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+#include <stdint.h>
+#include "../transport/ICanBus.h"
+#include "MKSCapture.h"
+
+// Listen-only decoder for MKS SERVO42E/57E traffic. Every frame, host command or drive reply,
+// is decoded through a per-command table (request and reply layout and valid DLCs) into an
+// Event carrying the typed fields, and each reply is matched to the oldest outstanding command
+// with the same node and command byte to give the command-to-ack latency.
+//
+// Host and drive use the same CAN ID, so the direction of a frame is taken from the capture
+// flags when the recorder knew it and inferred otherwise: from the DLC where request and reply
+// lengths differ, and for equal lengths (e.g. a 1-byte setter and its status ack) a frame is a
+// reply only while a command with that byte is outstanding for the node.
+//
+// Decoding does not allocate; per-node state lives in a fixed table indexed by the 11-bit ID,
+// so instances are large (a few hundred KB): make them static or allocate once.
+class MKSBusMonitor {
+public:
+  static const uint16_t MAX_NODE_ID = 0x7FF;
+  static const uint8_t PENDING_PER_NODE = 4;
+
+  enum Direction : uint8_t {
+    DIR_UNKNOWN = 0,
+    DIR_TO_DRIVE,
+    DIR_FROM_DRIVE
+  };
+
+  enum Kind : uint8_t {
+    KIND_COMMAND = 0,   // host to drive
+    KIND_RESPONSE,      // drive to host: ack, read reply or active report
+    KIND_UNKNOWN        // command byte not in the table and direction unknown
+  };
+
+  // Payload layouts; the Event fields each one fills are listed.
+  enum Layout : uint8_t {
+    LAYOUT_NONE = 0,    // command byte only
+    LAYOUT_STATUS,      // value = status / state byte
+    LAYOUT_U8,          // value
+    LAYOUT_U16,         // value (big-endian)
+    LAYOUT_I16,         // value (big-endian, signed; RPM for CMD_READ_SPEED_RPM)
+    LAYOUT_I32,         // value
+    LAYOUT_U32,         // value
+    LAYOUT_I48,         // value
+    LAYOUT_CARRY,       // value = carry, aux = angle value
+    LAYOUT_SPEED,       // dir, speedRpm, acc
+    LAYOUT_SPEED_AXIS,  // dir, speedRpm, acc, value = 24-bit signed pulses / axis
+    LAYOUT_VERSION,     // code = series, aux = calibration flag << 8 | hardware, value = firmware bytes
+    LAYOUT_PARAM,       // code = parameter code, payload after it in frame
+    LAYOUT_RAW          // nothing decoded, see frame
+  };
+
+  struct CommandInfo {
+    uint8_t cmd;
+    const char *name;
+    Layout request;
+    uint16_t requestDlcs;   // bit n set: DLC n is a valid request
+    Layout response;
+    uint16_t responseDlcs;
+  };
+
+  struct Event {
+    Kind kind;
+    Layout layout;
+    bool crcOk;
+    bool directionKnown;  // from the caller, not inferred
+    bool matched;         // reply matched an outstanding command; latencyUs is valid
+    uint8_t cmd;
+    uint16_t nodeId;
+    const CommandInfo *info;  // nullptr for unknown command bytes
+    uint64_t timestampUs;
+    uint32_t latencyUs;
+    int64_t value;
+    uint16_t aux;
+    uint16_t speedRpm;
+    uint8_t acc;
+    uint8_t dir;
+    uint8_t code;
+    CanFrame frame;
+  };
+
+  struct NodeStats {
+    uint32_t commands;
+    uint32_t responses;
+    uint32_t unsolicited;   // replies with no outstanding command (active reports, missed commands)
+    uint32_t unanswered;    // commands that timed out or were pushed out of the pending table
+    uint32_t crcErrors;
+    uint32_t latencyCount;
+    uint64_t latencySumUs;
+    uint32_t latencyMinUs;
+    uint32_t latencyMaxUs;
+  };
+
+  typedef void (*EventHandler)(void *context, const Event &event);
+
+  MKSBusMonitor();
+
+  void setEventHandler(EventHandler handler, void *context = nullptr);
+  // Outstanding commands older than this no longer match a reply; default 100 ms.
+  void setResponseTimeoutUs(uint32_t timeoutUs) { _timeoutUs = timeoutUs; }
+
+  // Decodes one frame and raises the handler. The returned event is valid until the next call.
+  const Event &feed(const CanFrame &f, uint64_t timestampUs, Direction dir = DIR_UNKNOWN);
+  // Decodes every frame the adapter has ready, timestamped with the host clock. The adapter
+  // should be in listen-only mode or otherwise not used by a driver. Returns frames decoded.
+  uint32_t poll(ICanBus &bus);
+  // Decodes a whole capture file. Returns frames decoded.
+  uint32_t replay(MKSCaptureReader &reader);
+
+  static const CommandInfo *lookup(uint8_t cmd);
+  static Direction directionFromFlags(uint8_t captureFlags);
+
+  const NodeStats &nodeStats(uint16_t nodeId) const { return _nodes[nodeId & MAX_NODE_ID].stats; }
+  uint64_t frames() const { return _frames; }
+  uint64_t unknownFrames() const { return _unknownFrames; }
+  void reset();
+  // Clears statistics and counters but keeps outstanding commands, e.g. after feeding the frames
+  // just before a chunk of a longer capture.
+  void resetStats();
+
+private:
+  struct NodeState {
+    uint8_t pendingCount;
+    uint8_t pendingCmd[PENDING_PER_NODE];
+    uint64_t pendingUs[PENDING_PER_NODE];
+    NodeStats stats;
+  };
+
+  NodeState _nodes[MAX_NODE_ID + 1];
+  Event _event;
+  EventHandler _handler;
+  void *_context;
+  uint32_t _timeoutUs;
+  uint64_t _frames;
+  uint64_t _unknownFrames;
+
+  void expire(NodeState &node, uint64_t nowUs);
+  bool hasPending(const NodeState &node, uint8_t cmd) const;
+  void addPending(NodeState &node, uint8_t cmd, uint64_t nowUs);
+  bool takePending(NodeState &node, uint8_t cmd, uint64_t nowUs, uint32_t &latencyUs);
+  static void decodePayload(Layout layout, const CanFrame &f, Event &ev);
+};
@@ -0,0 +1,142 @@
+#if !defined(ARDUINO)
+
+#include "MKSCapture.h"
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MKSCaptureWriter::open(const char *path, uint32_t bitrate) {
+  close();
+  _file = fopen(path, "wb");
+  if (!_file) {
+    return false;
+  }
+  MKSCapture::Header header;
+  memcpy(header.magic, MKSCapture::MAGIC, sizeof(header.magic));
+  header.bitrate = bitrate;
+  header.reserved = 0;
+  if (fwrite(&header, sizeof(header), 1, _file) != 1) {
+    close();
+    return false;
+  }
+  _records = 0;
+  return true;
+}
+
+bool MKSCaptureWriter::write(const CanFrame &f, uint64_t timestampUs, uint8_t flags) {
+  if (!_file) {
+    return false;
+  }
+  MKSCapture::Record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.timestampUs = timestampUs;
+  rec.id = f.id;
+  rec.dlc = f.dlc > 8 ? 8 : f.dlc;
+  rec.flags = flags;
+  memcpy(rec.data, f.data, rec.dlc);
+  if (fwrite(&rec, sizeof(rec), 1, _file) != 1) {
+    return false;
+  }
+  _records++;
+  return true;
+}
+
+void MKSCaptureWriter::close() {
+  if (_file) {
+    fclose(_file);
+    _file = nullptr;
+  }
+}
+
+bool MKSCaptureReader::open(const char *path) {
+  close();
+  _file = fopen(path, "rb");
+  if (!_file) {
+    return false;
+  }
+  MKSCapture::Header header;
+  if (fread(&header, sizeof(header), 1, _file) != 1 ||
+      memcmp(header.magic, MKSCapture::MAGIC, sizeof(header.magic)) != 0) {
+    close();
+    return false;
+  }
+  _bitrate = header.bitrate;
+  _count = 0;
+  _next = 0;
+  return true;
+}
+
+bool MKSCaptureReader::next(CanFrame &f, uint64_t &timestampUs, uint8_t &flags) {
+  if (!_file) {
+    return false;
+  }
+  if (_next == _count) {
+    _count = fread(_buffer, sizeof(MKSCapture::Record), BUFFER_RECORDS, _file);
+    _next = 0;
+    if (_count == 0) {
+      return false;
+    }
+  }
+  const MKSCapture::Record &rec = _buffer[_next++];
+  f.id = rec.id;
+  f.dlc = rec.dlc > 8 ? 8 : rec.dlc;
+  memcpy(f.data, rec.data, sizeof(f.data));
+  timestampUs = rec.timestampUs;
+  flags = rec.flags;
+  return true;
+}
+
+void MKSCaptureReader::close() {
+  if (_file) {
+    fclose(_file);
+    _file = nullptr;
+  }
+  _count = 0;
+  _next = 0;
+}
+
+bool MKSCaptureMap::open(const char *path) {
+  close();
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MKSCapture::Header)) {
+    ::close(fd);
+    return false;
+  }
+  void *base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+  const MKSCapture::Header *header = (const MKSCapture::Header *)base;
+  if (memcmp(header->magic, MKSCapture::MAGIC, sizeof(header->magic)) != 0) {
+    munmap(base, (size_t)st.st_size);
+    return false;
+  }
+  // Records are read front to back by each worker.
+  madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+  _base = base;
+  _size = (size_t)st.st_size;
+  _bitrate = header->bitrate;
+  _records = (const MKSCapture::Record *)((const uint8_t *)base + sizeof(MKSCapture::Header));
+  _count = (_size - sizeof(MKSCapture::Header)) / sizeof(MKSCapture::Record);
+  return true;
+}
+
+void MKSCaptureMap::close() {
+  if (_base) {
+    munmap(_base, _size);
+    _base = nullptr;
+  }
+  _size = 0;
+  _records = nullptr;
+  _count = 0;
+  _bitrate = 0;
+}
+
+#endif
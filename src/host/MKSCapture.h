@@ -0,0 +1,101 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include "../transport/ICanBus.h"
+
+// Binary CAN capture file: a 16-byte header followed by fixed 24-byte records, both in host
+// (little-endian) byte order. Records are naturally aligned, so a mapped file can be read
+// as an array of MKSCapture::Record starting at offset sizeof(Header).
+namespace MKSCapture {
+  static const char MAGIC[8] = { 'M', 'K', 'S', 'C', 'A', 'P', '0', '1' };
+
+  enum Flags : uint8_t {
+    FLAG_DIR_KNOWN = 0x01,  // the recorder knew which side sent the frame
+    FLAG_TO_DRIVE  = 0x02   // host to drive; only meaningful with FLAG_DIR_KNOWN
+  };
+
+  struct Header {
+    char magic[8];
+    uint32_t bitrate;   // bus bitrate in bit/s, 0 if unknown
+    uint32_t reserved;
+  };
+
+  struct Record {
+    uint64_t timestampUs;
+    uint16_t id;
+    uint8_t dlc;
+    uint8_t flags;
+    uint8_t data[8];
+    uint32_t reserved;
+  };
+
+  static_assert(sizeof(Header) == 16, "capture header layout");
+  static_assert(sizeof(Record) == 24, "capture record layout");
+}
+
+class MKSCaptureWriter {
+public:
+  MKSCaptureWriter() : _file(nullptr), _records(0) {}
+  ~MKSCaptureWriter() { close(); }
+
+  bool open(const char *path, uint32_t bitrate);
+  bool write(const CanFrame &f, uint64_t timestampUs, uint8_t flags);
+  void close();
+
+  bool isOpen() const { return _file != nullptr; }
+  uint64_t records() const { return _records; }
+
+private:
+  FILE *_file;
+  uint64_t _records;
+};
+
+// Sequential reader with a fixed read-ahead buffer.
+class MKSCaptureReader {
+public:
+  static const uint16_t BUFFER_RECORDS = 512;
+
+  MKSCaptureReader() : _file(nullptr), _bitrate(0), _count(0), _next(0) {}
+  ~MKSCaptureReader() { close(); }
+
+  // Fails if the file is missing or does not start with the capture header.
+  bool open(const char *path);
+  // Returns false at the end of the file (a truncated last record is ignored).
+  bool next(CanFrame &f, uint64_t &timestampUs, uint8_t &flags);
+  void close();
+
+  bool isOpen() const { return _file != nullptr; }
+  uint32_t bitrate() const { return _bitrate; }
+
+private:
+  FILE *_file;
+  uint32_t _bitrate;
+  size_t _count;
+  size_t _next;
+  MKSCapture::Record _buffer[BUFFER_RECORDS];
+};
+
+// Read-only memory mapping of a whole capture file (POSIX mmap), for random access and for
+// splitting a capture into chunks processed in parallel.
+class MKSCaptureMap {
+public:
+  MKSCaptureMap() : _base(nullptr), _size(0), _records(nullptr), _count(0), _bitrate(0) {}
+  ~MKSCaptureMap() { close(); }
+
+  // Fails if the file is missing, cannot be mapped or does not start with the capture header.
+  bool open(const char *path);
+  void close();
+
+  bool isOpen() const { return _base != nullptr; }
+  const MKSCapture::Record *records() const { return _records; }
+  // Complete records in the file; a truncated last record is ignored.
+  size_t count() const { return _count; }
+  uint32_t bitrate() const { return _bitrate; }
+
+private:
+  void *_base;
+  size_t _size;
+  const MKSCapture::Record *_records;
+  size_t _count;
+  uint32_t _bitrate;
+};
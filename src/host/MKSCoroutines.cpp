@@ -0,0 +1,228 @@
+#if !defined(ARDUINO) && defined(__cpp_impl_coroutine)
+
+#include "MKSCoroutines.h"
+#include <Arduino.h>
+#include <exception>
+#include "../MKSServoGroup.h"
+
+MKSTask MKSTask::promise_type::get_return_object() {
+  return MKSTask(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+void MKSTask::promise_type::unhandled_exception() {
+  // The library does not use exceptions; anything escaping a sequence is a bug.
+  std::terminate();
+}
+
+std::coroutine_handle<> MKSTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+  std::coroutine_handle<> next = h.promise().continuation;
+  return next ? next : std::noop_coroutine();
+}
+
+MKSTask::MKSTask(MKSTask &&other) noexcept : _handle(other._handle) {
+  other._handle = nullptr;
+}
+
+MKSTask &MKSTask::operator=(MKSTask &&other) noexcept {
+  if (this != &other) {
+    if (_handle) {
+      _handle.destroy();
+    }
+    _handle = other._handle;
+    other._handle = nullptr;
+  }
+  return *this;
+}
+
+MKSTask::~MKSTask() {
+  if (_handle) {
+    _handle.destroy();
+  }
+}
+
+std::coroutine_handle<> MKSTask::await_suspend(std::coroutine_handle<> caller) noexcept {
+  _handle.promise().continuation = caller;
+  return _handle;
+}
+
+MKSScheduler::Wait::Wait(MKSScheduler &scheduler, MKSServoE *axis, uint8_t cmd, uint32_t timeoutMs)
+: _scheduler(scheduler), _axis(axis), _cmd(cmd), _payload{0}, _payloadLen(0), _needsSend(false), _requireStatusSuccess(false),
+  _startMs(0), _timeoutMs(timeoutMs), _result(), _handle(nullptr) {
+  _result.rc = MKSServoE::ERROR_TIMEOUT;
+}
+
+bool MKSScheduler::Wait::await_suspend(std::coroutine_handle<> handle) {
+  _handle = handle;
+  _startMs = millis();
+  if (update(_startMs)) {
+    // Failed to send for good (or already answered): continue without suspending.
+    return false;
+  }
+  _scheduler.enqueue(this);
+  return true;
+}
+
+void MKSScheduler::Wait::finish(MKSServoE::ERROR rc) {
+  _result.rc = rc;
+}
+
+bool MKSScheduler::Wait::update(uint32_t now) {
+  const uint32_t elapsed = now - _startMs;
+  if (_needsSend) {
+    const uint32_t remaining = elapsed < _timeoutMs ? _timeoutMs - elapsed : 0;
+    MKSServoE::ERROR rc = _axis->sendRequest(_cmd, _payload, _payloadLen, remaining);
+    if (rc == MKSServoE::ERROR_OK) {
+      _needsSend = false;
+    } else if (rc != MKSServoE::ERROR_BUS_SEND) {
+      finish(rc);
+      return true;
+    }
+  }
+  if (_axis && !_needsSend) {
+    if (_axis->takeResponse(_cmd, _result.frame) == MKSServoE::ERROR_OK) {
+      if (_requireStatusSuccess && _result.frame.dlc < 3) {
+        finish(MKSServoE::ERROR_BAD_FRAME);
+      } else if (_requireStatusSuccess && _result.frame.data[1] == 0) {
+        finish(MKSServoE::ERROR_DEVICE_STATUS_FAIL);
+      } else {
+        finish(MKSServoE::ERROR_OK);
+      }
+      return true;
+    }
+  }
+  if (elapsed >= _timeoutMs) {
+    finish(_axis ? MKSServoE::ERROR_TIMEOUT : MKSServoE::ERROR_OK);
+    return true;
+  }
+  return false;
+}
+
+MKSScheduler::MKSScheduler() : _finished(0), _failed(0), _progressed(false) {}
+
+MKSScheduler::~MKSScheduler() {
+  // Tasks still suspended are destroyed with _tasks; their Wait objects live in the frames.
+  _waiting.clear();
+}
+
+MKSScheduler::Wait MKSScheduler::request(MKSServoE &axis, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint32_t timeoutMs, bool requireStatusSuccess) {
+  Wait wait(*this, &axis, cmd, timeoutMs);
+  // An oversized payloadLen is kept as is so sendRequest reports ERROR_INVALID_ARG.
+  for (uint8_t i = 0; i < payloadLen && i < sizeof(wait._payload); i++) {
+    wait._payload[i] = payload[i];
+  }
+  wait._payloadLen = payloadLen;
+  wait._needsSend = true;
+  wait._requireStatusSuccess = requireStatusSuccess;
+  return wait;
+}
+
+MKSScheduler::Wait MKSScheduler::request(MKSServoE &axis, const MKSStartupSequencer::Step &step) {
+  return request(axis, step.cmd, step.payload, step.payloadLen, step.timeoutMs, step.requireStatusSuccess);
+}
+
+MKSScheduler::Wait MKSScheduler::response(MKSServoE &axis, uint8_t cmd, uint32_t timeoutMs) {
+  return Wait(*this, &axis, cmd, timeoutMs);
+}
+
+MKSScheduler::Wait MKSScheduler::sleep(uint32_t ms) {
+  return Wait(*this, nullptr, 0, ms);
+}
+
+void MKSScheduler::spawn(MKSTask task) {
+  if (!task.valid() || task.done()) {
+    return;
+  }
+  _starting.push_back(task._handle);
+  _tasks.push_back(static_cast<MKSTask &&>(task));
+}
+
+void MKSScheduler::pollBuses() {
+  // Grouped axes share one read of their bus; polling each of them would only repeat it.
+  _polled.clear();
+  for (Wait *wait : _waiting) {
+    if (!wait->_axis) {
+      continue;
+    }
+    MKSServoGroup *group = wait->_axis->group();
+    const void *key = group ? (const void *)group : (const void *)wait->_axis;
+    bool seen = false;
+    for (const void *p : _polled) {
+      if (p == key) {
+        seen = true;
+        break;
+      }
+    }
+    if (!seen) {
+      _polled.push_back(key);
+      wait->_axis->poll();
+    }
+  }
+}
+
+bool MKSScheduler::step() {
+  _progressed = false;
+  for (size_t i = 0; i < _starting.size(); i++) {
+    _starting[i].resume();
+    _progressed = true;
+  }
+  _starting.clear();
+
+  pollBuses();
+  const uint32_t now = millis();
+  _scratch.clear();
+  _scratch.swap(_waiting);
+  size_t ready = 0;
+  for (size_t i = 0; i < _scratch.size(); i++) {
+    if (_scratch[i]->update(now)) {
+      _scratch[ready++] = _scratch[i];
+    } else {
+      _waiting.push_back(_scratch[i]);
+    }
+  }
+  // Resume after sorting so tasks that await again land behind the ones still waiting.
+  for (size_t i = 0; i < ready; i++) {
+    _scratch[i]->_handle.resume();
+    _progressed = true;
+  }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < _tasks.size(); i++) {
+    if (_tasks[i].done()) {
+      _finished++;
+      if (_tasks[i].result() != MKSServoE::ERROR_OK) {
+        _failed++;
+      }
+      _tasks[i] = MKSTask();
+    } else {
+      if (kept != i) {
+        _tasks[kept] = static_cast<MKSTask &&>(_tasks[i]);
+      }
+      kept++;
+    }
+  }
+  _tasks.resize(kept);
+  return !_tasks.empty();
+}
+
+MKSServoE::ERROR MKSScheduler::run(uint32_t timeoutMs) {
+  const uint32_t start = millis();
+  while (step()) {
+    if ((uint32_t)(millis() - start) > timeoutMs) {
+      return MKSServoE::ERROR_TIMEOUT;
+    }
+    bool busWaiters = false;
+    for (Wait *wait : _waiting) {
+      if (wait->_axis) {
+        busWaiters = true;
+        break;
+      }
+    }
+    if (!_progressed && !busWaiters) {
+      // Only sleeps pending: let (virtual) time pass instead of spinning.
+      delay(1);
+    }
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+#endif // !defined(ARDUINO) && defined(__cpp_impl_coroutine)
@@ -0,0 +1,143 @@
+#pragma once
+// C++20 coroutine front end for MKSServoE on host builds (needs -std=c++20).
+//
+// A command sequence is written as a coroutine returning MKSTask that co_awaits one response
+// at a time:
+//
+//   MKSTask homeAxis(MKSScheduler &sched, MKSServoE &axis) {
+//     MKSScheduler::Response r = co_await sched.request(axis, MKSStartupSequencer::enableStep());
+//     if (r.rc != MKSServoE::ERROR_OK) co_return r.rc;
+//     r = co_await sched.request(axis, MKS::CMD_GO_HOME, nullptr, 0, 50, false);
+//     r = co_await sched.response(axis, MKS::CMD_GO_HOME, 20000);  // active report: homed
+//     co_return r.rc;
+//   }
+//
+// MKSScheduler runs any number of such tasks on one thread. Each step polls every bus that
+// has a waiter once, then resumes the tasks whose response arrived or whose timeout expired,
+// so nothing blocks and no thread is needed per sequence. Responses are matched by command
+// per axis, as in the driver: two tasks awaiting the same command on the same axis receive
+// the frames in the order they started waiting.
+#if !defined(__cpp_impl_coroutine)
+#error "MKSCoroutines.h requires C++20 coroutines (-std=c++20)"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coroutine>
+#include <vector>
+#include "../MKSServoE.h"
+#include "../MKSStartupSequencer.h"
+
+class MKSTask {
+public:
+  struct promise_type {
+    MKSServoE::ERROR result = MKSServoE::ERROR_OK;
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter {
+      bool await_ready() const noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+      void await_resume() const noexcept {}
+    };
+
+    MKSTask get_return_object();
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void return_value(MKSServoE::ERROR rc) { result = rc; }
+    void unhandled_exception();
+  };
+
+  MKSTask() : _handle(nullptr) {}
+  MKSTask(MKSTask &&other) noexcept;
+  MKSTask &operator=(MKSTask &&other) noexcept;
+  MKSTask(const MKSTask &) = delete;
+  MKSTask &operator=(const MKSTask &) = delete;
+  ~MKSTask();
+
+  bool valid() const { return (bool)_handle; }
+  bool done() const { return !_handle || _handle.done(); }
+  MKSServoE::ERROR result() const { return _handle ? _handle.promise().result : MKSServoE::ERROR_OK; }
+
+  // co_await on a sub-task runs it in place and resumes the caller when it returns.
+  bool await_ready() const noexcept { return done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept;
+  MKSServoE::ERROR await_resume() const { return result(); }
+
+private:
+  friend class MKSScheduler;
+  explicit MKSTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+  std::coroutine_handle<promise_type> _handle;
+};
+
+class MKSScheduler {
+public:
+  struct Response {
+    MKSServoE::ERROR rc;
+    CanFrame frame;
+    uint8_t status() const { return frame.dlc >= 3 ? frame.data[1] : 0; }
+  };
+
+  // Awaitable returned by request()/response()/sleep().
+  class Wait {
+  public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle);
+    Response await_resume() const { return _result; }
+
+  private:
+    friend class MKSScheduler;
+    Wait(MKSScheduler &scheduler, MKSServoE *axis, uint8_t cmd, uint32_t timeoutMs);
+    // Returns true once the wait is over and _result is final.
+    bool update(uint32_t now);
+    void finish(MKSServoE::ERROR rc);
+
+    MKSScheduler &_scheduler;
+    MKSServoE *_axis;
+    uint8_t _cmd;
+    uint8_t _payload[6];
+    uint8_t _payloadLen;
+    bool _needsSend;
+    bool _requireStatusSuccess;
+    uint32_t _startMs;
+    uint32_t _timeoutMs;
+    Response _result;
+    std::coroutine_handle<> _handle;
+  };
+
+  MKSScheduler();
+  ~MKSScheduler();
+
+  // Sends cmd and waits for its response. Sending is retried while the adapter reports
+  // ERROR_BUS_SEND. With requireStatusSuccess a status byte of 0 yields ERROR_DEVICE_STATUS_FAIL.
+  Wait request(MKSServoE &axis, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen, uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+  Wait request(MKSServoE &axis, const MKSStartupSequencer::Step &step);
+  // Waits for a frame that was not requested, e.g. the active "move complete" report.
+  Wait response(MKSServoE &axis, uint8_t cmd, uint32_t timeoutMs);
+  // Resumes after ms; result rc is always ERROR_OK.
+  Wait sleep(uint32_t ms);
+
+  // Takes ownership of a task; it starts running on the next step().
+  void spawn(MKSTask task);
+  // Runs one scheduling round. Returns false once no task is left.
+  bool step();
+  // Steps until every task finished (ERROR_OK) or timeoutMs passed (ERROR_TIMEOUT).
+  MKSServoE::ERROR run(uint32_t timeoutMs = 0xFFFFFFFFu);
+
+  size_t activeTasks() const { return _tasks.size(); }
+  uint32_t finishedTasks() const { return _finished; }
+  // Finished tasks whose co_return value was not ERROR_OK.
+  uint32_t failedTasks() const { return _failed; }
+
+private:
+  void enqueue(Wait *wait) { _waiting.push_back(wait); }
+  void pollBuses();
+
+  std::vector<MKSTask> _tasks;
+  std::vector<std::coroutine_handle<>> _starting;
+  std::vector<Wait *> _waiting;
+  std::vector<Wait *> _scratch;
+  std::vector<const void *> _polled;
+  uint32_t _finished;
+  uint32_t _failed;
+  bool _progressed;
+};
@@ -0,0 +1,239 @@
+#if !defined(ARDUINO)
+
+#include "MKSIoThread.h"
+#include "Arduino.h"
+#include <chrono>
+
+namespace {
+// Frames read per group poll; enough to drain a burst of replies in one pass.
+const uint8_t POLL_FRAMES = 32;
+const uint32_t POLL_WAIT_US = 100;
+const uint32_t IDLE_SLEEP_MS = 10;
+}
+
+MKSIoThread::MKSIoThread(MKSServoGroup &group)
+: _group(group), _axisCount(group.axisCount()), _inFlight(), _inFlightCount(0), _running(false), _sleeping(false),
+  _submitting(0), _completed(0), _failed(0), _rejected(0) {}
+
+MKSIoThread::~MKSIoThread() {
+  stop();
+}
+
+bool MKSIoThread::start() {
+  if (running() || _thread.joinable()) {
+    return false;
+  }
+  _running.store(true, std::memory_order_release);
+  _thread = std::thread(&MKSIoThread::run, this);
+  return true;
+}
+
+void MKSIoThread::stop() {
+  _running.store(false, std::memory_order_seq_cst);
+  if (_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(_wakeMutex);
+      _wake.notify_one();
+    }
+    _thread.join();
+  }
+}
+
+MKSServoE::ERROR MKSIoThread::submit(const Request &request) {
+  if (request.axisIndex >= _axisCount || request.payloadLen > sizeof(request.payload)) {
+    return MKSServoE::ERROR_INVALID_ARG;
+  }
+  // Pairs with stop(): either stop() waits for this push or this thread sees it stopped.
+  _submitting.fetch_add(1, std::memory_order_seq_cst);
+  if (!_running.load(std::memory_order_seq_cst)) {
+    _submitting.fetch_sub(1, std::memory_order_release);
+    return MKSServoE::ERROR_BUS_SEND;
+  }
+  const bool pushed = _queue.push(request);
+  _submitting.fetch_sub(1, std::memory_order_release);
+  if (!pushed) {
+    _rejected.fetch_add(1, std::memory_order_relaxed);
+    return MKSServoE::ERROR_BUS_SEND;
+  }
+  // Pairs with the fence in idle(): either the I/O thread sees the request before it sleeps
+  // or this thread sees it sleeping and wakes it.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(_wakeMutex);
+    _wake.notify_one();
+  }
+  return MKSServoE::ERROR_OK;
+}
+
+MKSIoThread::Request MKSIoThread::makeRequest(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                              uint32_t timeoutMs, bool requireStatusSuccess) {
+  Request req{};
+  req.axisIndex = axisIndex;
+  req.callbackIndex = axisIndex;
+  req.cmd = cmd;
+  for (uint8_t i = 0; i < payloadLen && i < sizeof(req.payload); i++) {
+    req.payload[i] = payload[i];
+  }
+  req.payloadLen = payloadLen;
+  req.requireStatusSuccess = requireStatusSuccess;
+  req.timeoutMs = timeoutMs;
+  return req;
+}
+
+std::future<MKSIoThread::Response> MKSIoThread::submitWithFuture(Request &req) {
+  req.promise = new std::promise<Response>();
+  std::future<Response> future = req.promise->get_future();
+  const MKSServoE::ERROR rc = submit(req);
+  if (rc != MKSServoE::ERROR_OK) {
+    Response response{};
+    response.rc = rc;
+    req.promise->set_value(response);
+    delete req.promise;
+  }
+  return future;
+}
+
+std::future<MKSIoThread::Response> MKSIoThread::request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                                        uint32_t timeoutMs, bool requireStatusSuccess) {
+  Request req = makeRequest(axisIndex, cmd, payload, payloadLen, timeoutMs, requireStatusSuccess);
+  return submitWithFuture(req);
+}
+
+std::future<MKSIoThread::Response> MKSIoThread::request(uint8_t axisIndex, const MKSStartupSequencer::Step &step) {
+  return request(axisIndex, step.cmd, step.payload, step.payloadLen, step.timeoutMs, step.requireStatusSuccess);
+}
+
+MKSServoE::ERROR MKSIoThread::request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                      Callback callback, void *context, uint32_t timeoutMs, bool requireStatusSuccess) {
+  Request req = makeRequest(axisIndex, cmd, payload, payloadLen, timeoutMs, requireStatusSuccess);
+  req.callback = callback;
+  req.context = context;
+  return submit(req);
+}
+
+MKSIoThread::Response MKSIoThread::call(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                        uint32_t timeoutMs, bool requireStatusSuccess) {
+  return request(axisIndex, cmd, payload, payloadLen, timeoutMs, requireStatusSuccess).get();
+}
+
+void MKSIoThread::complete(const Request &request, const Response &response) {
+  _completed.fetch_add(1, std::memory_order_relaxed);
+  if (response.rc != MKSServoE::ERROR_OK) {
+    _failed.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (request.promise) {
+    request.promise->set_value(response);
+    delete request.promise;
+  } else if (request.callback) {
+    request.callback(request.context, request.callbackIndex, request.cmd, response);
+  }
+}
+
+bool MKSIoThread::update(InFlight &entry, uint32_t now, bool &busFull, Response &response) {
+  const Request &req = entry.request;
+  MKSServoE *axis = _group.axis(req.axisIndex);
+  const uint32_t elapsed = now - entry.startMs;
+  if (entry.needsSend && !busFull) {
+    const uint32_t remaining = elapsed < req.timeoutMs ? req.timeoutMs - elapsed : 0;
+    const MKSServoE::ERROR rc = axis->sendRequest(req.cmd, req.payload, req.payloadLen, remaining);
+    if (rc == MKSServoE::ERROR_OK) {
+      entry.needsSend = false;
+    } else if (rc == MKSServoE::ERROR_BUS_SEND) {
+      // Later requests wait too, so replies to one command still come back in request order.
+      busFull = true;
+    } else {
+      response.rc = rc;
+      return true;
+    }
+  }
+  if (!entry.needsSend && axis->takeResponse(req.cmd, response.frame) == MKSServoE::ERROR_OK) {
+    if (req.requireStatusSuccess && response.frame.dlc < 3) {
+      response.rc = MKSServoE::ERROR_BAD_FRAME;
+    } else if (req.requireStatusSuccess && response.frame.data[1] == 0) {
+      response.rc = MKSServoE::ERROR_DEVICE_STATUS_FAIL;
+    } else {
+      response.rc = MKSServoE::ERROR_OK;
+    }
+    return true;
+  }
+  if (elapsed >= req.timeoutMs) {
+    response.rc = entry.needsSend ? MKSServoE::ERROR_BUS_SEND : MKSServoE::ERROR_TIMEOUT;
+    return true;
+  }
+  return false;
+}
+
+void MKSIoThread::idle() {
+  if (_inFlightCount > 0) {
+    _group.bus().waitForRx(POLL_WAIT_US);
+    std::this_thread::yield();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(_wakeMutex);
+  _sleeping.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_queue.size() == 0 && running()) {
+    _wake.wait_for(lock, std::chrono::milliseconds(IDLE_SLEEP_MS));
+  }
+  _sleeping.store(false, std::memory_order_relaxed);
+}
+
+void MKSIoThread::run() {
+  while (running()) {
+    bool progressed = false;
+    const uint32_t start = millis();
+    Request req;
+    while (_inFlightCount < MAX_IN_FLIGHT && _queue.pop(req)) {
+      InFlight &entry = _inFlight[_inFlightCount++];
+      entry.request = req;
+      entry.startMs = start;
+      entry.needsSend = true;
+      progressed = true;
+    }
+
+    _group.poll(POLL_FRAMES);
+    const uint32_t now = millis();
+    bool busFull = false;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < _inFlightCount; i++) {
+      Response response{};
+      if (update(_inFlight[i], now, busFull, response)) {
+        // Copied out first: the callback may submit, but never touches _inFlight.
+        const Request done = _inFlight[i].request;
+        complete(done, response);
+        progressed = true;
+        continue;
+      }
+      if (kept != i) {
+        _inFlight[kept] = _inFlight[i];
+      }
+      kept++;
+    }
+    _inFlightCount = kept;
+
+    if (!progressed) {
+      idle();
+    }
+  }
+  // A submit that saw the thread running may still be pushing; wait for it so its request is
+  // completed here too. Later submits see the thread stopped and are refused.
+  while (_submitting.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+  abortAll();
+}
+
+void MKSIoThread::abortAll() {
+  Response aborted{};
+  aborted.rc = MKSServoE::ERROR_TIMEOUT;
+  for (uint8_t i = 0; i < _inFlightCount; i++) {
+    complete(_inFlight[i].request, aborted);
+  }
+  _inFlightCount = 0;
+  Request req;
+  while (_queue.pop(req)) {
+    complete(req, aborted);
+  }
+}
+
+#endif
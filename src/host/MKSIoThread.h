@@ -0,0 +1,123 @@
+#pragma once
+// Thread-safe front end for a group of axes on Linux/macOS hosts.
+//
+// One I/O thread owns the group's ICanBus, the axes and their response queues. Any number of
+// other threads submit requests through a bounded lock-free MPSC queue and get the reply
+// through a std::future or a callback run on the I/O thread:
+//
+//   MKSIoThread io(group);
+//   io.start();
+//   std::future<MKSIoThread::Response> f = io.request(0, MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0);
+//   MKSIoThread::Response r = f.get();
+//
+// Requests are sent in submission order and several may be in flight at once, across axes
+// and on one axis; replies are matched per axis and command in order, as in the driver.
+// While requests are in flight the I/O thread polls the bus continuously (ICanBus::waitForRx
+// between polls, then a yield); with nothing to do it sleeps until the next submission.
+//
+// Once start() was called, the group, its axes and the bus must only be used through this
+// class until stop() returns. HostClock must run in real (not virtual) time.
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "../MKSServoGroup.h"
+#include "../MKSStartupSequencer.h"
+#include "MKSMpscQueue.h"
+
+class MKSIoThread {
+public:
+  static const size_t QUEUE_CAPACITY = 256;
+  static const uint8_t MAX_IN_FLIGHT = 64;
+
+  struct Response {
+    MKSServoE::ERROR rc;
+    CanFrame frame;
+    uint8_t status() const { return frame.dlc >= 3 ? frame.data[1] : 0; }
+  };
+
+  // Runs on the I/O thread and must not block; it may submit further requests.
+  typedef void (*Callback)(void *context, uint8_t axisIndex, uint8_t cmd, const Response &response);
+
+  explicit MKSIoThread(MKSServoGroup &group);
+  ~MKSIoThread();
+
+  bool start();
+  // Finishes the thread; requests still queued or in flight complete with ERROR_TIMEOUT on the
+  // I/O thread before it exits. Later submissions are refused.
+  void stop();
+  bool running() const { return _running.load(std::memory_order_acquire); }
+
+  // Any thread. The future is ready at once with ERROR_BUS_SEND when the queue is full or the
+  // thread is not running, and with ERROR_INVALID_ARG for a bad axis index or payload. With
+  // requireStatusSuccess a status byte of 0 yields ERROR_DEVICE_STATUS_FAIL.
+  std::future<Response> request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+  std::future<Response> request(uint8_t axisIndex, const MKSStartupSequencer::Step &step);
+  // Any thread, allocation-free. Returns ERROR_BUS_SEND when the queue is full or the thread is
+  // not running, without calling the callback.
+  MKSServoE::ERROR request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                           Callback callback, void *context, uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+  // Blocks the calling thread until the reply arrived; not from a callback.
+  Response call(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+
+  uint8_t axisCount() const { return _axisCount; }
+  uint32_t completed() const { return _completed.load(std::memory_order_relaxed); }
+  // Completed with an rc other than ERROR_OK.
+  uint32_t failed() const { return _failed.load(std::memory_order_relaxed); }
+  // Submissions refused because the queue was full.
+  uint32_t rejected() const { return _rejected.load(std::memory_order_relaxed); }
+
+private:
+  friend class MKSMultiBusIo;
+
+  struct Request {
+    uint8_t axisIndex;
+    uint8_t callbackIndex;  // axis index reported to the callback
+    uint8_t cmd;
+    uint8_t payload[6];
+    uint8_t payloadLen;
+    bool requireStatusSuccess;
+    uint32_t timeoutMs;
+    Callback callback;
+    void *context;
+    std::promise<Response> *promise;
+  };
+
+  struct InFlight {
+    Request request;
+    uint32_t startMs;
+    bool needsSend;
+  };
+
+  MKSServoGroup &_group;
+  const uint8_t _axisCount;
+  MKSMpscQueue<Request, QUEUE_CAPACITY> _queue;
+  InFlight _inFlight[MAX_IN_FLIGHT];
+  uint8_t _inFlightCount;
+  std::thread _thread;
+  std::atomic<bool> _running;
+  std::atomic<bool> _sleeping;
+  std::atomic<uint32_t> _submitting;  // submit() calls between the running check and the push
+  std::mutex _wakeMutex;
+  std::condition_variable _wake;
+  std::atomic<uint32_t> _completed;
+  std::atomic<uint32_t> _failed;
+  std::atomic<uint32_t> _rejected;
+
+  static Request makeRequest(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                             uint32_t timeoutMs, bool requireStatusSuccess);
+  MKSServoE::ERROR submit(const Request &request);
+  std::future<Response> submitWithFuture(Request &request);
+  void run();
+  // Returns true once the request is finished and response is final.
+  bool update(InFlight &entry, uint32_t now, bool &busFull, Response &response);
+  void complete(const Request &request, const Response &response);
+  void idle();
+  // Completes everything in flight and queued with ERROR_TIMEOUT; last thing run() does.
+  void abortAll();
+};
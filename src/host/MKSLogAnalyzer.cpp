@@ -0,0 +1,391 @@
+#if !defined(ARDUINO)
+
+#include "MKSLogAnalyzer.h"
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include "../protocol/MksCommands.h"
+#include "../transport/CanTiming.h"
+
+namespace {
+// Below this many records per thread the thread start-up costs more than it saves.
+const size_t MIN_CHUNK_RECORDS = 1u << 16;
+
+typedef MKSLogAnalyzer::AxisSeries AxisSeries;
+
+// Table-driven equivalent of CanTiming::frameBits(): the CRC-15 is computed a byte at a time and
+// stuff bits are counted a byte at a time from the (last bit, run length) state. The bit-serial
+// version costs more than the whole decode.
+class FrameBitCounter {
+public:
+  FrameBitCounter() {
+    for (uint16_t b = 0; b < 256; b++) {
+      uint16_t crc = (uint16_t)(b << 7);
+      for (uint8_t i = 0; i < 8; i++) {
+        crc = (uint16_t)((crc & 0x4000) ? ((crc << 1) ^ 0x4599) : (crc << 1));
+      }
+      _crc[b] = (uint16_t)(crc & 0x7FFF);
+      for (uint8_t state = 0; state < STATES; state++) {
+        uint8_t next = state;
+        uint8_t stuffed = 0;
+        for (int8_t i = 7; i >= 0; i--) {
+          next = step(next, (uint8_t)((b >> i) & 1u), stuffed);
+        }
+        _next[state][b] = next;
+        _stuffed[state][b] = stuffed;
+      }
+    }
+  }
+
+  uint16_t bits(const CanFrame &f) const {
+    const uint8_t dlc = f.dlc > 8 ? 8 : f.dlc;
+    // Leading zeros do not change a zero-initialised CRC, so the 19 header bits are fed as 3 bytes.
+    const uint32_t header = ((uint32_t)(f.id & 0x7FF) << 7) | dlc;
+    uint16_t crc = 0;
+    crc = update(crc, (uint8_t)(header >> 16));
+    crc = update(crc, (uint8_t)(header >> 8));
+    crc = update(crc, (uint8_t)header);
+    for (uint8_t i = 0; i < dlc; i++) {
+      crc = update(crc, f.data[i]);
+    }
+
+    // After SOF (a 0 bit): 18 header bits, the data and 15 CRC bits.
+    uint8_t state = 0;  // last bit 0, run of 1
+    uint16_t stuffed = 0;
+    uint64_t acc = header & 0x3FFFF;
+    uint8_t accBits = 18;
+    for (uint8_t i = 0; i <= dlc; i++) {
+      if (i < dlc) {
+        acc = (acc << 8) | f.data[i];
+        accBits += 8;
+      } else {
+        acc = (acc << 15) | crc;
+        accBits += 15;
+      }
+      while (accBits >= 8) {
+        accBits -= 8;
+        const uint8_t byte = (uint8_t)(acc >> accBits);
+        stuffed += _stuffed[state][byte];
+        state = _next[state][byte];
+      }
+    }
+    uint8_t tail = 0;
+    while (accBits > 0) {
+      accBits--;
+      state = step(state, (uint8_t)((acc >> accBits) & 1u), tail);
+    }
+    stuffed += tail;
+    return (uint16_t)(CanTiming::stuffableBits(dlc) + stuffed + CanTiming::TAIL_BITS);
+  }
+
+private:
+  // State = last bit * 4 + (run length - 1); a run of 5 inserts a stuff bit of the opposite level.
+  static const uint8_t STATES = 8;
+
+  static uint8_t step(uint8_t state, uint8_t bit, uint8_t &stuffed) {
+    const uint8_t last = state >> 2;
+    uint8_t run = (uint8_t)((state & 3u) + 1u);
+    if (bit == last) {
+      run++;
+    } else {
+      run = 1;
+    }
+    if (run == 5) {
+      stuffed++;
+      return (uint8_t)((bit ^ 1u) << 2);
+    }
+    return (uint8_t)((bit << 2) | (run - 1u));
+  }
+
+  uint16_t update(uint16_t crc, uint8_t byte) const {
+    return (uint16_t)(((crc << 8) & 0x7FFF) ^ _crc[((crc >> 7) ^ byte) & 0xFF]);
+  }
+
+  uint16_t _crc[256];
+  uint8_t _next[STATES][256];
+  uint8_t _stuffed[STATES][256];
+};
+const FrameBitCounter FRAME_BITS;
+
+// Commands without arguments and status acks repeat byte for byte, so the wire length of
+// recently seen frames is remembered (direct-mapped, per worker).
+class FrameBitCache {
+public:
+  FrameBitCache() { memset(_entries, 0, sizeof(_entries)); }
+
+  uint16_t bits(const CanFrame &f) {
+    uint64_t data;
+    memcpy(&data, f.data, sizeof(data));
+    const uint8_t dlc = f.dlc > 8 ? 8 : f.dlc;
+    if (dlc < 8) {
+      data &= (1ull << (8 * dlc)) - 1;
+    }
+    const uint32_t key = ((uint32_t)(f.id & 0x7FF) << 4) | dlc;
+    Entry &e = _entries[((data ^ key) * 0x9E3779B97F4A7C15ull) >> (64 - INDEX_BITS)];
+    if (e.bits != 0 && e.key == key && e.data == data) {
+      return e.bits;
+    }
+    e.data = data;
+    e.key = key;
+    e.bits = FRAME_BITS.bits(f);
+    return e.bits;
+  }
+
+private:
+  static const uint8_t INDEX_BITS = 10;
+
+  struct Entry {
+    uint64_t data;
+    uint32_t key;
+    uint16_t bits;
+  };
+
+  Entry _entries[1u << INDEX_BITS];
+};
+
+struct Worker {
+  MKSBusMonitor monitor;
+  std::vector<AxisSeries> series;
+  FrameBitCache frameBits;
+  std::vector<uint32_t> latency;
+  std::vector<uint64_t> windowBits;
+  uint64_t firstWindow;
+  uint64_t busyBits;
+};
+
+inline void toFrame(const MKSCapture::Record &rec, CanFrame &f) {
+  f.id = rec.id;
+  f.dlc = rec.dlc > 8 ? 8 : rec.dlc;
+  memcpy(f.data, rec.data, sizeof(f.data));
+}
+
+void onEvent(void *context, const MKSBusMonitor::Event &ev) {
+  Worker &w = *(Worker *)context;
+  if (ev.kind != MKSBusMonitor::KIND_RESPONSE) {
+    return;
+  }
+  if (ev.matched) {
+    const uint32_t bucket = ev.latencyUs / MKSLogAnalyzer::LATENCY_BUCKET_US;
+    w.latency[bucket < MKSLogAnalyzer::LATENCY_BUCKETS ? bucket : MKSLogAnalyzer::LATENCY_BUCKETS - 1]++;
+  }
+  if (!ev.crcOk || w.series.empty()) {
+    return;
+  }
+  AxisSeries &s = w.series[ev.nodeId];
+  switch (ev.layout) {
+    case MKSBusMonitor::LAYOUT_I16: {
+      if (ev.cmd == MKS::CMD_READ_SPEED_RPM) {
+        s.speedUs.push_back(ev.timestampUs);
+        s.speedRpm.push_back((int16_t)ev.value);
+      }
+      break;
+    }
+    case MKSBusMonitor::LAYOUT_I48: {
+      if (ev.cmd == MKS::CMD_READ_ENCODER_ADDITION) {
+        s.encoderUs.push_back(ev.timestampUs);
+        s.encoder.push_back(ev.value);
+      }
+      break;
+    }
+    case MKSBusMonitor::LAYOUT_I32: {
+      if (ev.cmd == MKS::CMD_READ_POS_ERROR) {
+        s.posErrorUs.push_back(ev.timestampUs);
+        s.posError.push_back((int32_t)ev.value);
+      }
+      break;
+    }
+    case MKSBusMonitor::LAYOUT_STATUS: {
+      s.statusUs.push_back(ev.timestampUs);
+      s.statusCmd.push_back(ev.cmd);
+      s.status.push_back((uint8_t)ev.value);
+      break;
+    }
+    default: break;
+  }
+}
+
+void runChunk(Worker &w, const MKSCapture::Record *records, size_t warmBegin, size_t begin, size_t end,
+              uint64_t firstUs, const MKSLogAnalyzer::Options &options) {
+  CanFrame f;
+  w.monitor.reset();
+  w.monitor.setResponseTimeoutUs(options.responseTimeoutUs);
+  w.monitor.setEventHandler(nullptr);
+  for (size_t i = warmBegin; i < begin; i++) {
+    toFrame(records[i], f);
+    w.monitor.feed(f, records[i].timestampUs, MKSBusMonitor::directionFromFlags(records[i].flags));
+  }
+  w.monitor.resetStats();
+  w.monitor.setEventHandler(onEvent, &w);
+
+  w.latency.assign(MKSLogAnalyzer::LATENCY_BUCKETS, 0);
+  w.firstWindow = (records[begin].timestampUs - firstUs) / options.loadWindowUs;
+  const uint64_t lastWindow = (records[end - 1].timestampUs - firstUs) / options.loadWindowUs;
+  w.windowBits.assign((size_t)(lastWindow - w.firstWindow + 1), 0);
+  w.busyBits = 0;
+  for (size_t i = begin; i < end; i++) {
+    const MKSCapture::Record &rec = records[i];
+    toFrame(rec, f);
+    w.monitor.feed(f, rec.timestampUs, MKSBusMonitor::directionFromFlags(rec.flags));
+    const uint16_t bits = w.frameBits.bits(f);
+    w.busyBits += bits;
+    const uint64_t window = (rec.timestampUs - firstUs) / options.loadWindowUs;
+    if (window >= w.firstWindow && window - w.firstWindow < w.windowBits.size()) {
+      w.windowBits[(size_t)(window - w.firstWindow)] += bits;
+    }
+  }
+}
+
+void mergeStats(MKSBusMonitor::NodeStats &into, const MKSBusMonitor::NodeStats &from) {
+  into.commands += from.commands;
+  into.responses += from.responses;
+  into.unsolicited += from.unsolicited;
+  into.unanswered += from.unanswered;
+  into.crcErrors += from.crcErrors;
+  into.latencyCount += from.latencyCount;
+  into.latencySumUs += from.latencySumUs;
+  into.latencyMinUs = std::min(into.latencyMinUs, from.latencyMinUs);
+  into.latencyMaxUs = std::max(into.latencyMaxUs, from.latencyMaxUs);
+}
+
+template <typename T>
+void append(std::vector<T> &into, const std::vector<T> &from) {
+  into.insert(into.end(), from.begin(), from.end());
+}
+
+void appendSeries(AxisSeries &into, const AxisSeries &from) {
+  append(into.speedUs, from.speedUs);
+  append(into.speedRpm, from.speedRpm);
+  append(into.encoderUs, from.encoderUs);
+  append(into.encoder, from.encoder);
+  append(into.posErrorUs, from.posErrorUs);
+  append(into.posError, from.posError);
+  append(into.statusUs, from.statusUs);
+  append(into.statusCmd, from.statusCmd);
+  append(into.status, from.status);
+}
+
+uint32_t percentile(const std::vector<uint32_t> &histogram, uint64_t total, uint32_t permille) {
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t rank = (total * permille + 999) / 1000;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < histogram.size(); i++) {
+    seen += histogram[i];
+    if (seen >= rank) {
+      return (uint32_t)((i + 1) * MKSLogAnalyzer::LATENCY_BUCKET_US);
+    }
+  }
+  return (uint32_t)(histogram.size() * MKSLogAnalyzer::LATENCY_BUCKET_US);
+}
+}
+
+MKSLogAnalyzer::Options MKSLogAnalyzer::defaultOptions() {
+  Options options;
+  options.threads = 0;
+  options.responseTimeoutUs = 100000;
+  options.loadWindowUs = 100000;
+  options.bitrate = 0;
+  options.series = true;
+  return options;
+}
+
+bool MKSLogAnalyzer::analyze(const MKSCaptureMap &capture, const Options &options, Result &out) {
+  const MKSCapture::Record *records = capture.records();
+  const size_t count = capture.count();
+  if (!records || count == 0 || options.loadWindowUs == 0) {
+    return false;
+  }
+
+  size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, count / MIN_CHUNK_RECORDS + 1);
+
+  const uint64_t firstUs = records[0].timestampUs;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back(new Worker());
+    if (options.series) {
+      workers[t]->series.resize(MKSBusMonitor::MAX_NODE_ID + 1);
+    }
+  }
+  for (size_t t = 0; t < threads; t++) {
+    const size_t begin = count * t / threads;
+    const size_t end = count * (t + 1) / threads;
+    // Replay the preceding response timeout so replies near the boundary find their commands.
+    const uint64_t startUs = records[begin].timestampUs;
+    const uint64_t warmUs = startUs > options.responseTimeoutUs ? startUs - options.responseTimeoutUs : 0;
+    const size_t warmBegin = (size_t)(std::lower_bound(records, records + begin, warmUs,
+        [](const MKSCapture::Record &rec, uint64_t us) { return rec.timestampUs < us; }) - records);
+    Worker *w = workers[t].get();
+    if (t + 1 == threads) {
+      runChunk(*w, records, warmBegin, begin, end, firstUs, options);
+    } else {
+      pool.emplace_back([=, &options]() { runChunk(*w, records, warmBegin, begin, end, firstUs, options); });
+    }
+  }
+  for (std::thread &th : pool) {
+    th.join();
+  }
+
+  out = Result();
+  out.threads = (uint8_t)threads;
+  out.bitrate = options.bitrate ? options.bitrate : capture.bitrate();
+  out.firstUs = firstUs;
+  out.lastUs = records[count - 1].timestampUs;
+  out.latencyHistogram.assign(LATENCY_BUCKETS, 0);
+  std::vector<uint64_t> windowBits((size_t)((out.lastUs - firstUs) / options.loadWindowUs + 1), 0);
+  uint64_t busyBits = 0;
+  for (const std::unique_ptr<Worker> &w : workers) {
+    out.frames += w->monitor.frames();
+    out.unknownFrames += w->monitor.unknownFrames();
+    busyBits += w->busyBits;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+      out.latencyHistogram[i] += w->latency[i];
+    }
+    for (size_t i = 0; i < w->windowBits.size(); i++) {
+      windowBits[(size_t)w->firstWindow + i] += w->windowBits[i];
+    }
+  }
+
+  uint64_t matched = 0;
+  for (uint16_t id = 0; id <= MKSBusMonitor::MAX_NODE_ID; id++) {
+    Axis axis;
+    axis.id = id;
+    memset(&axis.stats, 0, sizeof(axis.stats));
+    axis.stats.latencyMinUs = UINT32_MAX;
+    for (const std::unique_ptr<Worker> &w : workers) {
+      mergeStats(axis.stats, w->monitor.nodeStats(id));
+    }
+    if (axis.stats.commands == 0 && axis.stats.responses == 0) {
+      continue;
+    }
+    if (options.series) {
+      for (const std::unique_ptr<Worker> &w : workers) {
+        appendSeries(axis.series, w->series[id]);
+      }
+    }
+    out.crcErrors += axis.stats.crcErrors;
+    matched += axis.stats.latencyCount;
+    out.latencyMaxUs = std::max(out.latencyMaxUs, axis.stats.latencyMaxUs);
+    out.axes.push_back(std::move(axis));
+  }
+  out.latencyP50Us = percentile(out.latencyHistogram, matched, 500);
+  out.latencyP99Us = percentile(out.latencyHistogram, matched, 990);
+
+  if (out.bitrate) {
+    out.busyUs = busyBits * 1000000u / out.bitrate;
+    const uint64_t spanUs = out.lastUs - out.firstUs;
+    out.averageLoad = spanUs ? (double)out.busyUs / (double)spanUs : 0;
+    const double windowBitsCapacity = (double)out.bitrate * options.loadWindowUs / 1000000.0;
+    out.windowLoad.resize(windowBits.size());
+    for (size_t i = 0; i < windowBits.size(); i++) {
+      out.windowLoad[i] = (float)(windowBits[i] / windowBitsCapacity);
+      out.peakLoad = std::max(out.peakLoad, (double)out.windowLoad[i]);
+    }
+  }
+  return true;
+}
+
+#endif
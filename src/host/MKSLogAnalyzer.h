@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "MKSBusMonitor.h"
+#include "MKSCapture.h"
+
+// Offline analysis of a memory-mapped capture (MKSCaptureMap). The records are split into one
+// contiguous chunk per worker thread and each worker decodes its chunk with its own
+// MKSBusMonitor. Before its chunk a worker replays the frames of the preceding response
+// timeout without counting them, so commands sent just before the chunk boundary still match
+// their replies. Per-worker results are merged in chunk order, so the output does not depend on
+// the thread count.
+//
+// Output per axis: CRC-checked statistics from the monitor, and columnar time series of the
+// drive's replies (speed, encoder addition, position error, status bytes). Bus-wide: frame
+// counts, command-to-ack latency percentiles and bus load per window.
+class MKSLogAnalyzer {
+public:
+  static const uint32_t LATENCY_BUCKET_US = 10;
+  static const uint32_t LATENCY_BUCKETS = 10000;  // 0..100 ms; the last bucket collects the rest
+
+  struct Options {
+    uint8_t threads;             // 0: one per hardware thread
+    uint32_t responseTimeoutUs;  // see MKSBusMonitor::setResponseTimeoutUs
+    uint32_t loadWindowUs;       // bus load is reported per window of this length
+    uint32_t bitrate;            // 0: from the capture header
+    bool series;                 // false: statistics only
+  };
+
+  // One column pair (timestamp, value) per quantity.
+  struct AxisSeries {
+    std::vector<uint64_t> speedUs;
+    std::vector<int16_t> speedRpm;
+    std::vector<uint64_t> encoderUs;
+    std::vector<int64_t> encoder;
+    std::vector<uint64_t> posErrorUs;
+    std::vector<int32_t> posError;
+    std::vector<uint64_t> statusUs;
+    std::vector<uint8_t> statusCmd;
+    std::vector<uint8_t> status;
+  };
+
+  struct Axis {
+    uint16_t id;
+    MKSBusMonitor::NodeStats stats;
+    AxisSeries series;
+  };
+
+  struct Result {
+    uint64_t frames;
+    uint64_t crcErrors;
+    uint64_t unknownFrames;
+    uint64_t firstUs;
+    uint64_t lastUs;
+    uint64_t busyUs;             // wire time of all frames at the bitrate
+    uint32_t bitrate;
+    uint8_t threads;
+    double averageLoad;          // busyUs over the capture span
+    double peakLoad;             // busiest load window
+    uint32_t latencyP50Us;
+    uint32_t latencyP99Us;
+    uint32_t latencyMaxUs;
+    std::vector<uint32_t> latencyHistogram;  // LATENCY_BUCKET_US wide buckets
+    std::vector<float> windowLoad;           // one entry per load window from firstUs
+    std::vector<Axis> axes;                  // axes that sent or received frames, by ID
+  };
+
+  static Options defaultOptions();
+
+  // Returns false for an empty or unmapped capture.
+  static bool analyze(const MKSCaptureMap &capture, const Options &options, Result &out);
+};
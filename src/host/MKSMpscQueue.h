@@ -0,0 +1,76 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Bounded lock-free queue for many producer threads and one consumer thread (sequence-numbered
+// ring after D. Vyukov). A producer claims a cell with one compare-and-swap on the tail and
+// publishes it by bumping the cell's sequence; the consumer never writes shared counters other
+// than the cells it frees. push() fails instead of blocking when the ring is full.
+template <typename T, size_t Capacity>
+class MKSMpscQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  MKSMpscQueue() : _tail(0), _head(0) {
+    for (size_t i = 0; i < Capacity; i++) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Any thread. Returns false if the queue is full.
+  bool push(const T &value) {
+    size_t pos = _tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &_cells[pos & (Capacity - 1)];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer thread only. Returns false if nothing is published yet.
+  bool pop(T &out) {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    Cell &cell = _cells[head & (Capacity - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+      return false;
+    }
+    out = cell.value;
+    cell.sequence.store(head + Capacity, std::memory_order_release);
+    _head.store(head + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Approximate when producers are active.
+  size_t size() const {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t head = _head.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // Producers and the consumer write different cache lines.
+  alignas(64) std::atomic<size_t> _tail;
+  alignas(64) std::atomic<size_t> _head;
+  alignas(64) Cell _cells[Capacity];
+};
@@ -0,0 +1,137 @@
+#if !defined(ARDUINO)
+
+#include "MKSMultiBusIo.h"
+
+MKSMultiBusIo::MKSMultiBusIo(MKSMultiBus &buses)
+: _buses(buses), _busCount(buses.busCount()), _order() {
+  for (uint8_t b = 0; b < _busCount; b++) {
+    _threads[b].reset(new MKSIoThread(*buses.group(b)));
+  }
+  uint8_t n = 0;
+  for (uint8_t local = 0; local < MKSServoGroup::MAX_AXES; local++) {
+    for (uint8_t b = 0; b < _busCount; b++) {
+      const int8_t index = buses.globalIndex(b, local);
+      if (index >= 0) {
+        _order[n++] = (uint8_t)index;
+      }
+    }
+  }
+}
+
+MKSMultiBusIo::~MKSMultiBusIo() {
+  stop();
+}
+
+bool MKSMultiBusIo::start() {
+  bool ok = _busCount > 0;
+  for (uint8_t b = 0; b < _busCount; b++) {
+    ok = _threads[b]->start() && ok;
+  }
+  return ok;
+}
+
+void MKSMultiBusIo::stop() {
+  for (uint8_t b = 0; b < _busCount; b++) {
+    _threads[b]->stop();
+  }
+}
+
+bool MKSMultiBusIo::running() const {
+  for (uint8_t b = 0; b < _busCount; b++) {
+    if (!_threads[b]->running()) {
+      return false;
+    }
+  }
+  return _busCount > 0;
+}
+
+MKSIoThread *MKSMultiBusIo::route(uint8_t axisIndex, uint8_t &localOut) {
+  const int8_t bus = _buses.busOf(axisIndex);
+  if (bus < 0) {
+    return nullptr;
+  }
+  localOut = (uint8_t)_buses.localIndex(axisIndex);
+  return _threads[bus].get();
+}
+
+std::future<MKSMultiBusIo::Response> MKSMultiBusIo::request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload,
+                                                            uint8_t payloadLen, uint32_t timeoutMs, bool requireStatusSuccess) {
+  uint8_t local = 0;
+  MKSIoThread *io = route(axisIndex, local);
+  if (!io) {
+    std::promise<Response> invalid;
+    Response response{};
+    response.rc = MKSServoE::ERROR_INVALID_ARG;
+    invalid.set_value(response);
+    return invalid.get_future();
+  }
+  return io->request(local, cmd, payload, payloadLen, timeoutMs, requireStatusSuccess);
+}
+
+MKSServoE::ERROR MKSMultiBusIo::request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                        Callback callback, void *context, uint32_t timeoutMs, bool requireStatusSuccess) {
+  uint8_t local = 0;
+  MKSIoThread *io = route(axisIndex, local);
+  if (!io) {
+    return MKSServoE::ERROR_INVALID_ARG;
+  }
+  MKSIoThread::Request req = MKSIoThread::makeRequest(local, cmd, payload, payloadLen, timeoutMs, requireStatusSuccess);
+  req.callbackIndex = axisIndex;
+  req.callback = callback;
+  req.context = context;
+  return io->submit(req);
+}
+
+MKSMultiBusIo::Response MKSMultiBusIo::call(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                            uint32_t timeoutMs, bool requireStatusSuccess) {
+  return request(axisIndex, cmd, payload, payloadLen, timeoutMs, requireStatusSuccess).get();
+}
+
+void MKSMultiBusIo::requestAll(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride,
+                               std::future<Response> *out, uint32_t timeoutMs, bool requireStatusSuccess) {
+  for (uint8_t n = 0; n < _buses.axisCount(); n++) {
+    const uint8_t index = _order[n];
+    out[index] = request(index, cmd, payloads ? payloads + (uint16_t)index * stride : nullptr, payloadLen, timeoutMs,
+                         requireStatusSuccess);
+  }
+}
+
+MKSServoE::ERROR MKSMultiBusIo::callAll(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride,
+                                        Response *out, uint32_t timeoutMs, bool requireStatusSuccess) {
+  std::future<Response> futures[MKSMultiBus::MAX_AXES];
+  requestAll(cmd, payloads, payloadLen, stride, futures, timeoutMs, requireStatusSuccess);
+  MKSServoE::ERROR rc = MKSServoE::ERROR_OK;
+  for (uint8_t i = 0; i < _buses.axisCount(); i++) {
+    out[i] = futures[i].get();
+    if (rc == MKSServoE::ERROR_OK) {
+      rc = out[i].rc;
+    }
+  }
+  return rc;
+}
+
+uint32_t MKSMultiBusIo::completed() const {
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < _busCount; b++) {
+    total += _threads[b]->completed();
+  }
+  return total;
+}
+
+uint32_t MKSMultiBusIo::failed() const {
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < _busCount; b++) {
+    total += _threads[b]->failed();
+  }
+  return total;
+}
+
+uint32_t MKSMultiBusIo::rejected() const {
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < _busCount; b++) {
+    total += _threads[b]->rejected();
+  }
+  return total;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+// Linux/macOS front end for MKSMultiBus: one MKSIoThread per CAN interface, addressed with the
+// global axis index. Each bus has its own I/O thread, submission queue and in-flight table,
+// so buses never contend with each other and throughput grows with the number of buses.
+//
+//   MKSMultiBusIo io(axes);   // after every bus and axis was added to axes
+//   io.start();
+//   MKSMultiBusIo::Response replies[MKSMultiBus::MAX_AXES];
+//   io.callAll(MKS::CMD_READ_ENCODER_ADDITION, nullptr, 0, 0, replies, 50, false);
+//
+// While started, the MKSMultiBus, its groups, axes and buses must only be used through this
+// class (its begin()/update()/poll() are the MCU-side I/O loop and must not run as well).
+#include <stdint.h>
+#include <future>
+#include <memory>
+#include "../MKSMultiBus.h"
+#include "MKSIoThread.h"
+
+class MKSMultiBusIo {
+public:
+  typedef MKSIoThread::Response Response;
+  // axisIndex is the global index.
+  typedef MKSIoThread::Callback Callback;
+
+  explicit MKSMultiBusIo(MKSMultiBus &buses);
+  ~MKSMultiBusIo();
+
+  bool start();
+  void stop();
+  bool running() const;
+
+  // Same contracts as the MKSIoThread calls, with a global axis index.
+  std::future<Response> request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                                uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+  MKSServoE::ERROR request(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                           Callback callback, void *context, uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+  Response call(uint8_t axisIndex, uint8_t cmd, const uint8_t *payload, uint8_t payloadLen,
+                uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+
+  // Group operations over every axis on every bus; axis i gets payloads + i * stride as in
+  // MKSMultiBus::begin(). Submission alternates between buses so all of them start at once.
+  // out must hold axisCount() entries.
+  void requestAll(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride, std::future<Response> *out,
+                  uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+  // Blocks until every axis answered; returns the first axis error.
+  MKSServoE::ERROR callAll(uint8_t cmd, const uint8_t *payloads, uint8_t payloadLen, uint8_t stride, Response *out,
+                           uint32_t timeoutMs = 50, bool requireStatusSuccess = true);
+
+  uint8_t busCount() const { return _busCount; }
+  uint8_t axisCount() const { return _buses.axisCount(); }
+  MKSIoThread *thread(uint8_t busIndex) { return busIndex < _busCount ? _threads[busIndex].get() : nullptr; }
+  // Sums over all bus threads.
+  uint32_t completed() const;
+  uint32_t failed() const;
+  uint32_t rejected() const;
+
+private:
+  MKSMultiBus &_buses;
+  const uint8_t _busCount;
+  std::unique_ptr<MKSIoThread> _threads[MKSMultiBus::MAX_BUSES];
+  // Global indices with buses interleaved: local 0 of every bus, then local 1, ...
+  uint8_t _order[MKSMultiBus::MAX_AXES];
+
+  // Nullptr for an unknown global index; localOut receives the index within the bus.
+  MKSIoThread *route(uint8_t axisIndex, uint8_t &localOut);
+};
@@ -0,0 +1,315 @@
+#if !defined(ARDUINO)
+
+#include "MKSTelemetryShm.h"
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+#include "../protocol/MksCommands.h"
+#include "../protocol/MksCrc.h"
+#include "../protocol/MksPacking.h"
+
+using MKSTelemetryShm::AxisSlot;
+using MKSTelemetryShm::Header;
+using MKSTelemetryShm::Sample;
+
+size_t MKSTelemetryShm::segmentSize(uint16_t axisCount) {
+  return sizeof(Header) + (size_t)axisCount * sizeof(AxisSlot);
+}
+
+uint64_t MKSTelemetryShm::nowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+MKSTelemetryPublisher::MKSTelemetryPublisher()
+: _header(nullptr), _slots(nullptr), _size(0), _axisCount(0), _name(), _slotByNode() {}
+
+MKSTelemetryPublisher::~MKSTelemetryPublisher() {
+  close(true);
+}
+
+bool MKSTelemetryPublisher::open(const char *name, uint16_t axisCount) {
+  close(false);
+  if (axisCount == 0 || axisCount > MKSTelemetryShm::MAX_AXES || strlen(name) >= sizeof(_name)) {
+    return false;
+  }
+  const int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  const size_t size = MKSTelemetryShm::segmentSize(axisCount);
+  if (ftruncate(fd, (off_t)size) != 0) {
+    ::close(fd);
+    return false;
+  }
+  void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+  // The magic goes in last, so a reader attaching meanwhile rejects the segment.
+  memset(base, 0, size);
+  Header *header = (Header *)base;
+  header->version = MKSTelemetryShm::VERSION;
+  header->axisCount = axisCount;
+  header->slotSize = sizeof(AxisSlot);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(header->magic, MKSTelemetryShm::MAGIC, sizeof(header->magic));
+
+  _header = header;
+  _slots = (AxisSlot *)((uint8_t *)base + sizeof(Header));
+  _size = size;
+  _axisCount = axisCount;
+  strcpy(_name, name);
+  memset(_slotByNode, 0, sizeof(_slotByNode));
+  return true;
+}
+
+void MKSTelemetryPublisher::close(bool unlink) {
+  if (_header) {
+    munmap(_header, _size);
+    if (unlink) {
+      shm_unlink(_name);
+    }
+  }
+  _header = nullptr;
+  _slots = nullptr;
+  _size = 0;
+  _axisCount = 0;
+  _name[0] = '\0';
+}
+
+bool MKSTelemetryPublisher::setNodeId(uint16_t slot, uint16_t nodeId) {
+  if (slot >= _axisCount || nodeId >= sizeof(_slotByNode)) {
+    return false;
+  }
+  AxisSlot &s = _slots[slot];
+  if (_slotByNode[s.sample.nodeId] == slot + 1) {
+    _slotByNode[s.sample.nodeId] = 0;
+  }
+  _slotByNode[nodeId] = (uint8_t)(slot + 1);
+  beginWrite(s);
+  s.sample.nodeId = nodeId;
+  endWrite(s, MKSTelemetryShm::nowUs());
+  return true;
+}
+
+int16_t MKSTelemetryPublisher::slotOf(uint16_t nodeId) const {
+  if (nodeId >= sizeof(_slotByNode)) {
+    return -1;
+  }
+  return (int16_t)_slotByNode[nodeId] - 1;
+}
+
+void MKSTelemetryPublisher::beginWrite(AxisSlot &slot) {
+  const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void MKSTelemetryPublisher::endWrite(AxisSlot &slot, uint64_t nowUs) {
+  slot.sample.updates++;
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  _header->publishes.fetch_add(1, std::memory_order_relaxed);
+  _header->lastPublishUs.store(nowUs, std::memory_order_relaxed);
+}
+
+bool MKSTelemetryPublisher::publishFrame(const CanFrame &reply, uint64_t nowUs) {
+  if (!_header || reply.dlc < 3 || reply.dlc > 8) {
+    return false;
+  }
+  const int16_t slotIndex = slotOf(reply.id);
+  if (slotIndex < 0) {
+    return false;
+  }
+  if (MKS::crc8_sum_plus1(reply.data, reply.dlc - 1) != reply.data[reply.dlc - 1]) {
+    return false;
+  }
+  const uint8_t *p = &reply.data[1];
+  AxisSlot &slot = _slots[slotIndex];
+  Sample &s = slot.sample;
+  switch (reply.data[0]) {
+    case MKS::CMD_READ_ENCODER_ADDITION:
+      if (reply.dlc < 8) {
+        return false;
+      }
+      beginWrite(slot);
+      s.encoderAddition = MKS::get_i48_be(p);
+      s.encoderUs = nowUs;
+      s.valid |= MKSTelemetryShm::FIELD_ENCODER;
+      break;
+    case MKS::CMD_READ_SPEED_RPM:
+      if (reply.dlc < 4) {
+        return false;
+      }
+      beginWrite(slot);
+      s.speedRpm = (int16_t)MKS::get_u16_be(p);
+      s.speedUs = nowUs;
+      s.valid |= MKSTelemetryShm::FIELD_SPEED;
+      break;
+    case MKS::CMD_READ_POS_ERROR:
+      if (reply.dlc < 6) {
+        return false;
+      }
+      beginWrite(slot);
+      s.positionError = (int32_t)MKS::get_u32_be(p);
+      s.posErrorUs = nowUs;
+      s.valid |= MKSTelemetryShm::FIELD_POS_ERROR;
+      break;
+    case MKS::CMD_READ_IO_STATUS:
+      beginWrite(slot);
+      s.ioStatus = p[0];
+      s.ioUs = nowUs;
+      s.valid |= MKSTelemetryShm::FIELD_IO;
+      break;
+    case MKS::CMD_READ_STALL_STATE:
+      beginWrite(slot);
+      s.stallState = p[0];
+      s.stallUs = nowUs;
+      s.valid |= MKSTelemetryShm::FIELD_STALL;
+      break;
+    case MKS::CMD_READ_EN_STATUS:
+      beginWrite(slot);
+      s.enabled = p[0];
+      s.enableUs = nowUs;
+      s.valid |= MKSTelemetryShm::FIELD_ENABLE;
+      break;
+    default:
+      return false;
+  }
+  endWrite(slot, nowUs);
+  return true;
+}
+
+bool MKSTelemetryPublisher::publish(uint16_t slot, const Sample &sample) {
+  if (!_header || slot >= _axisCount) {
+    return false;
+  }
+  AxisSlot &target = _slots[slot];
+  Sample &s = target.sample;
+  const uint8_t valid = sample.valid;
+  beginWrite(target);
+  if (valid & MKSTelemetryShm::FIELD_ENCODER) {
+    s.encoderAddition = sample.encoderAddition;
+    s.encoderUs = sample.encoderUs;
+  }
+  if (valid & MKSTelemetryShm::FIELD_SPEED) {
+    s.speedRpm = sample.speedRpm;
+    s.speedUs = sample.speedUs;
+  }
+  if (valid & MKSTelemetryShm::FIELD_POS_ERROR) {
+    s.positionError = sample.positionError;
+    s.posErrorUs = sample.posErrorUs;
+  }
+  if (valid & MKSTelemetryShm::FIELD_IO) {
+    s.ioStatus = sample.ioStatus;
+    s.ioUs = sample.ioUs;
+  }
+  if (valid & MKSTelemetryShm::FIELD_STALL) {
+    s.stallState = sample.stallState;
+    s.stallUs = sample.stallUs;
+  }
+  if (valid & MKSTelemetryShm::FIELD_ENABLE) {
+    s.enabled = sample.enabled;
+    s.enableUs = sample.enableUs;
+  }
+  s.valid |= valid;
+  endWrite(target, MKSTelemetryShm::nowUs());
+  return true;
+}
+
+MKSTelemetryReader::MKSTelemetryReader()
+: _header(nullptr), _slots(nullptr), _size(0), _axisCount(0) {}
+
+MKSTelemetryReader::~MKSTelemetryReader() {
+  close();
+}
+
+bool MKSTelemetryReader::open(const char *name) {
+  close();
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+    ::close(fd);
+    return false;
+  }
+  void *base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+  const Header *header = (const Header *)base;
+  if (memcmp(header->magic, MKSTelemetryShm::MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != MKSTelemetryShm::VERSION || header->slotSize != sizeof(AxisSlot) ||
+      header->axisCount > MKSTelemetryShm::MAX_AXES ||
+      (size_t)st.st_size < MKSTelemetryShm::segmentSize((uint16_t)header->axisCount)) {
+    munmap(base, (size_t)st.st_size);
+    return false;
+  }
+  _header = header;
+  _slots = (const AxisSlot *)((const uint8_t *)base + sizeof(Header));
+  _size = (size_t)st.st_size;
+  _axisCount = (uint16_t)header->axisCount;
+  return true;
+}
+
+void MKSTelemetryReader::close() {
+  if (_header) {
+    munmap((void *)_header, _size);
+  }
+  _header = nullptr;
+  _slots = nullptr;
+  _size = 0;
+  _axisCount = 0;
+}
+
+bool MKSTelemetryReader::read(uint16_t slot, Sample &out) const {
+  if (!_header || slot >= _axisCount) {
+    return false;
+  }
+  const AxisSlot &s = _slots[slot];
+  for (uint16_t attempt = 0; attempt < MAX_RETRIES; attempt++) {
+    if (attempt >= SPIN_RETRIES) {
+      // The publisher may have been preempted mid-write; let it run.
+      std::this_thread::yield();
+    }
+    const uint32_t before = s.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+    memcpy(&out, (const void *)&s.sample, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.sequence.load(std::memory_order_relaxed) == before) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int16_t MKSTelemetryReader::slotOf(uint16_t nodeId) const {
+  Sample sample;
+  for (uint16_t i = 0; i < _axisCount; i++) {
+    if (read(i, sample) && sample.nodeId == nodeId) {
+      return (int16_t)i;
+    }
+  }
+  return -1;
+}
+
+uint64_t MKSTelemetryReader::publishes() const {
+  return _header ? _header->publishes.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t MKSTelemetryReader::lastPublishUs() const {
+  return _header ? _header->lastPublishUs.load(std::memory_order_relaxed) : 0;
+}
+
+#endif
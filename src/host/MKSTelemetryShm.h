@@ -0,0 +1,176 @@
+#pragma once
+// Latest per-axis telemetry in POSIX shared memory, for other processes on the same host
+// (HMI, loggers). The controller process publishes the replies it already receives; readers
+// map the segment read-only and copy one axis at a time, so they add no CAN frames and never
+// block the publisher.
+//
+// Layout (host endianness, MKSTelemetryShm::VERSION):
+//   Header    magic "MKSTEL01", version, axisCount, slot size, publish counter and time
+//   AxisSlot  one per axis, 128 B, each guarded by its own sequence lock: the publisher makes
+//             the sequence odd, writes, then makes it even again; a reader retries when the
+//             sequence was odd or changed while it copied.
+// Timestamps are CLOCK_MONOTONIC microseconds (MKSTelemetryShm::nowUs()), which all
+// processes on the host share, unlike HostClock.
+//
+// Publishing without touching the application's request code:
+//   MKSTelemetryPublisher telemetry;
+//   telemetry.open("/mks-telemetry", 2);
+//   telemetry.setNodeId(0, 0x01);
+//   telemetry.setNodeId(1, 0x02);
+//   MKSTelemetryTapBus bus(can, telemetry);   // use bus wherever can was used
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "../transport/ICanBus.h"
+
+namespace MKSTelemetryShm {
+  static const char MAGIC[8] = { 'M', 'K', 'S', 'T', 'E', 'L', '0', '1' };
+  static const uint32_t VERSION = 1;
+  static const uint16_t MAX_AXES = 64;
+
+  // Bits of Sample::valid, set once the field was published.
+  enum Field : uint8_t {
+    FIELD_ENCODER = 1 << 0,
+    FIELD_SPEED = 1 << 1,
+    FIELD_POS_ERROR = 1 << 2,
+    FIELD_IO = 1 << 3,
+    FIELD_STALL = 1 << 4,
+    FIELD_ENABLE = 1 << 5,
+  };
+
+  struct Sample {
+    int64_t encoderAddition;  // CMD_READ_ENCODER_ADDITION, 0x4000 per turn
+    int32_t positionError;    // CMD_READ_POS_ERROR, 51200 per 360 degrees
+    int16_t speedRpm;         // CMD_READ_SPEED_RPM
+    uint8_t ioStatus;         // CMD_READ_IO_STATUS bits
+    uint8_t stallState;       // CMD_READ_STALL_STATE, 1 = protected
+    uint8_t enabled;          // CMD_READ_EN_STATUS
+    uint8_t valid;            // Field bits
+    uint16_t nodeId;
+    uint32_t updates;         // publishes to this axis
+    uint64_t encoderUs;
+    uint64_t speedUs;
+    uint64_t posErrorUs;
+    uint64_t ioUs;
+    uint64_t stallUs;
+    uint64_t enableUs;
+  };
+
+  struct alignas(64) AxisSlot {
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    Sample sample;
+  };
+
+  struct alignas(64) Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t axisCount;
+    uint32_t slotSize;
+    uint32_t reserved;
+    std::atomic<uint64_t> publishes;
+    std::atomic<uint64_t> lastPublishUs;
+  };
+
+  static_assert(sizeof(AxisSlot) == 128, "AxisSlot layout changed");
+  static_assert(sizeof(Header) == 64, "Header layout changed");
+  static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+                "shared-memory atomics must be lock-free");
+
+  size_t segmentSize(uint16_t axisCount);
+  uint64_t nowUs();
+}
+
+class MKSTelemetryPublisher {
+public:
+  MKSTelemetryPublisher();
+  ~MKSTelemetryPublisher();
+
+  // Creates (or resizes and clears) the segment; name as for shm_open, e.g. "/mks-telemetry".
+  bool open(const char *name, uint16_t axisCount);
+  // Unmaps; unlink also removes the name so new readers cannot attach.
+  void close(bool unlink = true);
+  bool isOpen() const { return _header != nullptr; }
+
+  uint16_t axisCount() const { return _axisCount; }
+  // CAN ID of the drive behind a slot, for publishFrame() and the tap bus. Node IDs are per
+  // bus, so with several CAN interfaces use one segment per interface.
+  bool setNodeId(uint16_t slot, uint16_t nodeId);
+  // Slot of a node, -1 if none.
+  int16_t slotOf(uint16_t nodeId) const;
+
+  // Decodes a drive reply (CRC checked) of a telemetry read and publishes it to the node's
+  // slot. Returns false for other commands, bad frames and unknown nodes. One writer per slot.
+  bool publishFrame(const CanFrame &reply, uint64_t nowUs = MKSTelemetryShm::nowUs());
+  // Publishes a whole sample; sample.valid says which fields are meant (nodeId is kept).
+  bool publish(uint16_t slot, const MKSTelemetryShm::Sample &sample);
+
+private:
+  MKSTelemetryShm::Header *_header;
+  MKSTelemetryShm::AxisSlot *_slots;
+  size_t _size;
+  uint16_t _axisCount;
+  char _name[64];
+  // nodeId -> slot + 1, 0 = none.
+  uint8_t _slotByNode[0x800];
+
+  void beginWrite(MKSTelemetryShm::AxisSlot &slot);
+  void endWrite(MKSTelemetryShm::AxisSlot &slot, uint64_t nowUs);
+};
+
+class MKSTelemetryReader {
+public:
+  static const uint16_t MAX_RETRIES = 1000;
+  // Attempts before read() starts yielding the CPU between retries.
+  static const uint16_t SPIN_RETRIES = 16;
+
+  MKSTelemetryReader();
+  ~MKSTelemetryReader();
+
+  // Maps an existing segment read-only and checks magic, version and size.
+  bool open(const char *name);
+  void close();
+  bool isOpen() const { return _header != nullptr; }
+
+  uint16_t axisCount() const { return _axisCount; }
+  int16_t slotOf(uint16_t nodeId) const;
+  // Consistent copy of one axis. False for a bad slot or if the publisher kept writing to it
+  // for MAX_RETRIES attempts.
+  bool read(uint16_t slot, MKSTelemetryShm::Sample &out) const;
+  uint64_t publishes() const;
+  uint64_t lastPublishUs() const;
+
+private:
+  const MKSTelemetryShm::Header *_header;
+  const MKSTelemetryShm::AxisSlot *_slots;
+  size_t _size;
+  uint16_t _axisCount;
+};
+
+// ICanBus decorator that publishes every telemetry reply read through it, so the driver's
+// own reads (or an MKSIoThread) feed the publisher with no extra frames.
+class MKSTelemetryTapBus : public ICanBus {
+public:
+  MKSTelemetryTapBus(ICanBus &bus, MKSTelemetryPublisher &publisher) : _bus(bus), _publisher(publisher) {}
+
+  bool begin(uint32_t bitrate) override { return _bus.begin(bitrate); }
+  bool send(const CanFrame &f) override { return _bus.send(f); }
+  bool available() override { return _bus.available(); }
+  void setFilter(uint16_t id, uint16_t mask) override { _bus.setFilter(id, mask); }
+  void waitForRx(uint32_t maxUs) override { _bus.waitForRx(maxUs); }
+  uint8_t abortPendingTx() override { return _bus.abortPendingTx(); }
+  bool errorStatus(CanErrorStatus &out) override { return _bus.errorStatus(out); }
+  bool recover() override { return _bus.recover(); }
+
+  bool read(CanFrame &out) override {
+    if (!_bus.read(out)) {
+      return false;
+    }
+    _publisher.publishFrame(out);
+    return true;
+  }
+
+private:
+  ICanBus &_bus;
+  MKSTelemetryPublisher &_publisher;
+};
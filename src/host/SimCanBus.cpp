@@ -0,0 +1,361 @@
+#if !defined(ARDUINO)
+
+#include "SimCanBus.h"
+#include "Arduino.h"
+#include "../transport/CanTiming.h"
+
+namespace {
+const uint64_t IDLE_STEP_US = 500;
+
+bool toBitrateCode(uint32_t bps, uint8_t &code) {
+  switch (bps) {
+    case 125000:  { code = (uint8_t)MKS::CanBitrate::Kbps125; return true; }
+    case 250000:  { code = (uint8_t)MKS::CanBitrate::Kbps250; return true; }
+    case 500000:  { code = (uint8_t)MKS::CanBitrate::Kbps500; return true; }
+    case 1000000: { code = (uint8_t)MKS::CanBitrate::Mbps1;   return true; }
+    default: {
+      return false;
+    }
+  }
+}
+} // namespace
+
+SimCanBus::Config SimCanBus::defaultConfig() {
+  Config config{};
+  config.responseLatencyUs = 300;
+  config.jitterUs = 100;
+  config.dropRate = 0.0f;
+  config.crcCorruptRate = 0.0f;
+  config.txMailboxes = 3;
+  config.rxFifoDepth = 64;
+  config.seed = 1;
+  config.autoBusOffRecovery = false;
+  return config;
+}
+
+SimCanBus::SimCanBus() : SimCanBus(defaultConfig()) {}
+
+SimCanBus::SimCanBus(const Config &config)
+: _config(config), _stats(), _bitrate(0), _bitrateCode(0xFF), _onWire(), _wireBusy(false), _rng(config.seed), _wireFreeUs(0), _statsSinceUs(0), _order(0), _pendingTx(0), _drained(false),
+  _tec(0), _rec(0), _busOff(false), _busOffEndUs(0) {}
+
+void SimCanBus::setConfig(const Config &config) {
+  _config = config;
+  _rng.seed(config.seed);
+}
+
+void SimCanBus::attach(SimServoNode &node) {
+  _nodes.push_back(&node);
+}
+
+void SimCanBus::resetStats() {
+  _stats = Stats();
+  _statsSinceUs = HostClock::nowUs();
+}
+
+bool SimCanBus::begin(uint32_t bitrate) {
+  uint8_t code = 0;
+  if (!toBitrateCode(bitrate, code)) {
+    return false;
+  }
+  // Re-initializing the controller drops everything in flight.
+  _waiting.clear();
+  _wireBusy = false;
+  _rx.clear();
+  _pendingTx = 0;
+  clearErrors();
+  _bitrate = bitrate;
+  _bitrateCode = code;
+  _wireFreeUs = HostClock::nowUs();
+  advanceNodes(_wireFreeUs);
+  return true;
+}
+
+void SimCanBus::setFilter(uint16_t id, uint16_t mask) {
+  (void)id;
+  (void)mask;
+}
+
+uint32_t SimCanBus::frameTimeUs(const CanFrame &f) const {
+  return CanTiming::frameTimeUs(f, _bitrate);
+}
+
+bool SimCanBus::chance(float rate) {
+  if (rate <= 0.0f) {
+    return false;
+  }
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  return dist(_rng) < rate;
+}
+
+bool SimCanBus::nextStartUs(uint64_t &startUs) const {
+  if (_wireBusy || _waiting.empty()) {
+    return false;
+  }
+  uint64_t ready = _waiting[0].readyUs;
+  for (const Event &ev : _waiting) {
+    if (ev.readyUs < ready) {
+      ready = ev.readyUs;
+    }
+  }
+  startUs = ready > _wireFreeUs ? ready : _wireFreeUs;
+  return true;
+}
+
+int SimCanBus::pickFrame(uint64_t atUs) const {
+  // Lowest ID wins arbitration; equal IDs go in the order they became pending.
+  int best = -1;
+  for (size_t i = 0; i < _waiting.size(); i++) {
+    const Event &ev = _waiting[i];
+    if (ev.readyUs > atUs) {
+      continue;
+    }
+    if (best < 0 || ev.frame.id < _waiting[best].frame.id ||
+        (ev.frame.id == _waiting[best].frame.id && ev.order < _waiting[best].order)) {
+      best = (int)i;
+    }
+  }
+  return best;
+}
+
+bool SimCanBus::send(const CanFrame &f) {
+  if (_bitrate == 0 || f.dlc > 8) {
+    return false;
+  }
+  service();
+  if (_busOff || _pendingTx >= _config.txMailboxes) {
+    _stats.txRejected++;
+    return false;
+  }
+  Event ev{};
+  ev.readyUs = HostClock::nowUs();
+  ev.order = _order++;
+  ev.toHost = false;
+  ev.frame = f;
+  ev.frame.id = (uint16_t)(f.id & 0x7FF);
+  _waiting.push_back(ev);
+  _pendingTx++;
+  _stats.hostFrames++;
+  service();
+  return true;
+}
+
+uint8_t SimCanBus::abortPendingTx() {
+  service();
+  uint8_t dropped = 0;
+  size_t kept = 0;
+  for (size_t i = 0; i < _waiting.size(); i++) {
+    if (!_waiting[i].toHost) {
+      _pendingTx--;
+      dropped++;
+    } else {
+      _waiting[kept++] = _waiting[i];
+    }
+  }
+  _waiting.resize(kept);
+  return dropped;
+}
+
+void SimCanBus::clearErrors() {
+  _tec = 0;
+  _rec = 0;
+  _busOff = false;
+  _busOffEndUs = 0;
+}
+
+bool SimCanBus::errorStatus(CanErrorStatus &out) {
+  service();
+  out.tec = _tec > 255 ? 255 : (uint8_t)_tec;
+  out.rec = _rec > 255 ? 255 : (uint8_t)_rec;
+  if (_busOff) {
+    out.state = CanErrorState::BusOff;
+  } else if (_tec >= 128 || _rec >= 128) {
+    out.state = CanErrorState::Passive;
+  } else if (_tec >= 96 || _rec >= 96) {
+    out.state = CanErrorState::Warning;
+  } else {
+    out.state = CanErrorState::Active;
+  }
+  return true;
+}
+
+bool SimCanBus::recover() {
+  if (_bitrate == 0) {
+    return false;
+  }
+  clearErrors();
+  return true;
+}
+
+void SimCanBus::injectBusErrors(uint16_t txErrors, uint16_t rxErrors) {
+  if (_busOff) {
+    return;
+  }
+  const uint32_t tec = _tec + 8u * txErrors;
+  const uint32_t rec = _rec + rxErrors;
+  _tec = tec > 256 ? 256 : (uint16_t)tec;
+  _rec = rec > 255 ? 255 : (uint16_t)rec;
+  if (_tec > 255) {
+    // Leaving the bus loses whatever was waiting in the mailboxes.
+    abortPendingTx();
+    _busOff = true;
+    _stats.busOffs++;
+    const uint64_t recoveryBits = 128u * 11u;
+    _busOffEndUs = HostClock::nowUs() + (recoveryBits * 1000000u + _bitrate - 1) / _bitrate;
+  }
+}
+
+void SimCanBus::checkBusOff(uint64_t nowUs) {
+  if (_busOff && _config.autoBusOffRecovery && nowUs >= _busOffEndUs) {
+    clearErrors();
+  }
+}
+
+void SimCanBus::scheduleToHost(uint64_t readyUs, const CanFrame &f) {
+  Event ev{};
+  ev.readyUs = readyUs;
+  ev.order = _order++;
+  ev.toHost = true;
+  ev.frame = f;
+  _waiting.push_back(ev);
+  _stats.nodeFrames++;
+}
+
+void SimCanBus::deliverToNodes(const CanFrame &f, uint64_t nowUs) {
+  for (SimServoNode *node : _nodes) {
+    if (!node->accepts(f.id) || node->bitrateCode() != _bitrateCode) {
+      continue;
+    }
+    CanFrame replies[SimServoNode::MAX_REPLIES];
+    const uint8_t n = node->handle(f, nowUs, replies);
+    for (uint8_t i = 0; i < n; i++) {
+      uint32_t latency = _config.responseLatencyUs;
+      if (_config.jitterUs > 0) {
+        std::uniform_int_distribution<uint32_t> jitter(0, _config.jitterUs);
+        latency += jitter(_rng);
+      }
+      scheduleToHost(nowUs + latency, replies[i]);
+    }
+  }
+}
+
+void SimCanBus::advanceNodes(uint64_t nowUs) {
+  for (SimServoNode *node : _nodes) {
+    CanFrame reports[SimServoNode::MAX_REPLIES];
+    const uint8_t n = node->advance(nowUs, reports);
+    if (node->bitrateCode() != _bitrateCode) {
+      continue;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+      scheduleToHost(nowUs, reports[i]);
+    }
+  }
+}
+
+void SimCanBus::complete(Event &ev) {
+  // Only the part of the frame after the last stats reset counts.
+  _stats.busyUs += ev.dueUs - (ev.startUs > _statsSinceUs ? ev.startUs : _statsSinceUs);
+  if (!ev.toHost) {
+    _pendingTx--;
+    if (chance(_config.dropRate)) {
+      _stats.dropped++;
+      return;
+    }
+    if (_tec > 0) {
+      _tec--;
+    }
+    deliverToNodes(ev.frame, ev.dueUs);
+    return;
+  }
+  if (_busOff) {
+    return;
+  }
+  if (chance(_config.dropRate)) {
+    _stats.dropped++;
+    return;
+  }
+  if (chance(_config.crcCorruptRate) && ev.frame.dlc > 0) {
+    ev.frame.data[ev.frame.dlc - 1] ^= 0x5A;
+    _stats.corrupted++;
+  }
+  if (_rx.size() >= _config.rxFifoDepth) {
+    _stats.rxOverflow++;
+    return;
+  }
+  if (_rec > 0) {
+    _rec--;
+  }
+  _rx.push_back(ev.frame);
+}
+
+void SimCanBus::service() {
+  const uint64_t now = HostClock::nowUs();
+  // Bus events in time order: a frame leaves the wire, then the next one is arbitrated among
+  // the frames ready when the wire is free.
+  for (;;) {
+    if (_wireBusy) {
+      if (_onWire.dueUs > now) {
+        break;
+      }
+      _wireBusy = false;
+      Event ev = _onWire;
+      advanceNodes(ev.dueUs);
+      checkBusOff(ev.dueUs);
+      complete(ev);
+      continue;
+    }
+    uint64_t start = 0;
+    if (!nextStartUs(start) || start > now) {
+      break;
+    }
+    // Reports the nodes produce up to the start take part in the arbitration too.
+    advanceNodes(start);
+    const int winner = pickFrame(start);
+    _onWire = _waiting[winner];
+    _waiting.erase(_waiting.begin() + winner);
+    _onWire.startUs = start;
+    _onWire.dueUs = start + frameTimeUs(_onWire.frame);
+    _wireFreeUs = _onWire.dueUs;
+    _wireBusy = true;
+  }
+  checkBusOff(now);
+  advanceNodes(now);
+}
+
+bool SimCanBus::available() {
+  service();
+  if (!_rx.empty() || !HostClock::isVirtual()) {
+    return !_rx.empty();
+  }
+  if (_drained) {
+    // The empty check that ends a drain loop must not cost simulated time.
+    _drained = false;
+    return false;
+  }
+  // Nothing ready: jump virtual time to the next event, in bounded steps so motion
+  // keeps being simulated and timeouts still expire.
+  const uint64_t now = HostClock::nowUs();
+  uint64_t next = now + IDLE_STEP_US;
+  uint64_t start = 0;
+  if (_wireBusy && _onWire.dueUs < next) {
+    next = _onWire.dueUs;
+  } else if (nextStartUs(start) && start < next) {
+    next = start;
+  }
+  HostClock::advanceUs(next - now);
+  service();
+  return !_rx.empty();
+}
+
+bool SimCanBus::read(CanFrame &out) {
+  service();
+  if (_rx.empty()) {
+    return false;
+  }
+  out = _rx.front();
+  _rx.pop_front();
+  _drained = true;
+  return true;
+}
+
+#endif // !defined(ARDUINO)
@@ -0,0 +1,110 @@
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include "../transport/ICanBus.h"
+#include "SimServoNode.h"
+
+// Virtual CAN bus carrying simulated SERVO42E/57E nodes, for host tests and benchmarks.
+// Frames are serialized on a shared wire at the configured bitrate: whenever the wire is free,
+// the lowest ID among the frames ready at that moment wins arbitration. Replies become ready
+// after a configurable processing latency plus jitter, and frames can be dropped or
+// CRC-corrupted at random. With HostClock in virtual mode, available() advances the clock to the next bus event
+// whenever nothing is ready, so a blocking driver call costs no real time.
+class SimCanBus : public ICanBus {
+public:
+  struct Config {
+    uint32_t responseLatencyUs;
+    uint32_t jitterUs;
+    float dropRate;        // per frame, either direction
+    float crcCorruptRate;  // per node-to-host frame
+    uint8_t txMailboxes;   // host frames that may wait for the wire before send() fails
+    uint16_t rxFifoDepth;  // host-side RX FIFO; frames beyond it are lost
+    uint32_t seed;
+    bool autoBusOffRecovery;  // ISO recovery after 128 x 11 recessive bits; off = stay bus-off
+                              // until recover() or begin(), like the UNO R4 core
+  };
+
+  struct Stats {
+    uint64_t hostFrames;
+    uint64_t nodeFrames;
+    uint64_t dropped;
+    uint64_t corrupted;
+    uint64_t txRejected;
+    uint64_t rxOverflow;
+    uint64_t busyUs;  // wire time of the frames completed since the last reset
+    uint64_t busOffs;
+  };
+
+  static Config defaultConfig();
+
+  SimCanBus();
+  explicit SimCanBus(const Config &config);
+
+  void setConfig(const Config &config);
+  const Config &config() const { return _config; }
+  void attach(SimServoNode &node);
+
+  bool begin(uint32_t bitrate) override;
+  bool send(const CanFrame &f) override;
+  bool available() override;
+  bool read(CanFrame &out) override;
+  void setFilter(uint16_t id, uint16_t mask) override;
+  // Host frames that have not started on the wire are dropped; the frame in progress completes.
+  uint8_t abortPendingTx() override;
+  // Error counters follow ISO 11898-1: +8 per transmit error, +1 per receive error, -1 per
+  // successful frame. In bus-off the host neither sends nor receives.
+  bool errorStatus(CanErrorStatus &out) override;
+  bool recover() override;
+  // Fault injection: transmit and receive errors seen by the host controller.
+  void injectBusErrors(uint16_t txErrors, uint16_t rxErrors);
+
+  // Runs nodes and delivers every bus event due at the current HostClock time.
+  void service();
+
+  uint32_t bitrate() const { return _bitrate; }
+  uint32_t frameTimeUs(const CanFrame &f) const;
+  const Stats &stats() const { return _stats; }
+  void resetStats();
+
+private:
+  struct Event {
+    uint64_t readyUs;  // when the sender has the frame ready to arbitrate
+    uint64_t startUs;
+    uint64_t dueUs;    // end of transmission, set when the frame wins the wire
+    uint64_t order;
+    bool toHost;
+    CanFrame frame;
+  };
+
+  Config _config;
+  Stats _stats;
+  uint32_t _bitrate;
+  uint8_t _bitrateCode;
+  std::vector<SimServoNode *> _nodes;
+  std::vector<Event> _waiting;  // ready or about to be, not yet on the wire
+  Event _onWire;
+  bool _wireBusy;
+  std::deque<CanFrame> _rx;
+  std::mt19937 _rng;
+  uint64_t _wireFreeUs;
+  uint64_t _statsSinceUs;
+  uint64_t _order;
+  uint8_t _pendingTx;
+  bool _drained;
+  uint16_t _tec;
+  uint16_t _rec;
+  bool _busOff;
+  uint64_t _busOffEndUs;
+
+  bool chance(float rate);
+  bool nextStartUs(uint64_t &startUs) const;
+  int pickFrame(uint64_t atUs) const;
+  void scheduleToHost(uint64_t readyUs, const CanFrame &f);
+  void complete(Event &ev);
+  void deliverToNodes(const CanFrame &f, uint64_t nowUs);
+  void advanceNodes(uint64_t nowUs);
+  void checkBusOff(uint64_t nowUs);
+  void clearErrors();
+};
@@ -0,0 +1,502 @@
+#if !defined(ARDUINO)
+
+#include "SimServoNode.h"
+#include <math.h>
+#include "../protocol/MksCrc.h"
+#include "../protocol/MksPacking.h"
+
+namespace {
+const double COUNTS_PER_TURN = 16384.0;     // encoder addition changes by 0x4000 per turn
+const double POS_ERROR_PER_TURN = 51200.0;  // CMD_READ_POS_ERROR units per 360 degrees
+const uint64_t REBOOT_US = 100000;
+const uint64_t CALIBRATE_US = 200000;
+const double MAX_STEP_S = 0.001;
+
+double approach(double value, double target, double maxDelta) {
+  if (value < target) {
+    return (target - value) < maxDelta ? target : value + maxDelta;
+  }
+  return (value - target) < maxDelta ? target : value - maxDelta;
+}
+} // namespace
+
+SimServoNode::SimServoNode(uint16_t canId)
+: _canId(canId), _lastUs(0), _offlineUntilUs(0), _calibrateDoneUs(0), _restarts(0), _framesHandled(0) {
+  resetConfig();
+  _pos = 0.0;
+  _inputPulses = 0;
+  resetRuntime();
+}
+
+void SimServoNode::resetConfig() {
+  _groupId = 0;
+  _bitrateCode = (uint8_t)MKS::CanBitrate::Kbps500;
+  _mode = (uint8_t)MKS::WorkMode::Can_ClosedLoop;
+  _currentMa = 1600;
+  _microstep = 16;
+  _dir = 0;
+  _enActive = 0;
+  _respond = 1;
+  _active = 1;
+  _lock = 1;
+  _stallProtect = 0;
+  _stallTolerance = 0;
+  _ioStatus = MKS::IO_STATUS_BIT_ALM; // ALM=1 means no alarm
+  _userId = 0;
+  _homeTrig = 0;
+  _homeDir = 0;
+  _homeRpm = 60;
+  _homeEndLimit = 0;
+  _homeMode = 0;
+  _homeDistance = 2 * 16384;
+}
+
+void SimServoNode::resetRuntime() {
+  _enabled = false;
+  _stall = 0;
+  _motion = Motion::Idle;
+  _motionCmd = 0;
+  _vel = 0.0;
+  _targetVel = 0.0;
+  _maxVel = 0.0;
+  _accel = 1e12;
+  _target = _pos;
+  _rampState = 0;
+  _homeTravelled = 0.0;
+  _calibrateDoneUs = 0;
+}
+
+bool SimServoNode::accepts(uint16_t frameId) const {
+  return frameId == _canId || frameId == 0 || (_groupId != 0 && frameId == _groupId);
+}
+
+bool SimServoNode::online(uint64_t nowUs) const {
+  return nowUs >= _offlineUntilUs;
+}
+
+void SimServoNode::injectStall() {
+  _stall = 1;
+  _motion = Motion::Idle;
+  _vel = 0.0;
+  _targetVel = 0.0;
+  _rampState = 0;
+}
+
+void SimServoNode::powerCycle(uint64_t nowUs) {
+  _offlineUntilUs = nowUs + REBOOT_US;
+  _restarts++;
+  // The multi-turn count is lost on reboot; only the single-turn angle survives.
+  _pos = fmod(_pos, COUNTS_PER_TURN);
+  resetRuntime();
+}
+
+int16_t SimServoNode::speedRpm() const {
+  return (int16_t)lround(_vel * 60.0 / COUNTS_PER_TURN);
+}
+
+MKS::MotorRunState SimServoNode::runState() const {
+  if (_calibrateDoneUs != 0) {
+    return MKS::MotorRunState::Calibrating;
+  }
+  if (_motion == Motion::Homing) {
+    return MKS::MotorRunState::Homing;
+  }
+  if (_motion == Motion::Idle && _vel == 0.0) {
+    return MKS::MotorRunState::Stop;
+  }
+  if (_rampState > 0) {
+    return MKS::MotorRunState::SpeedUp;
+  }
+  if (_rampState < 0) {
+    return MKS::MotorRunState::SpeedDown;
+  }
+  return _vel == 0.0 ? MKS::MotorRunState::Stop : MKS::MotorRunState::FullSpeed;
+}
+
+double SimServoNode::rpmToCps(double rpm) {
+  return rpm * COUNTS_PER_TURN / 60.0;
+}
+
+double SimServoNode::accToCps2(uint8_t acc) {
+  if (acc == 0) {
+    return 1e12; // acc=0: no ramp
+  }
+  // Manual: speed changes by 1 RPM every (256 - acc) * 50 us.
+  const double rpmPerSecond = 1e6 / ((256.0 - acc) * 50.0);
+  return rpmToCps(rpmPerSecond);
+}
+
+double SimServoNode::countsPerPulse() const {
+  const double microstep = _microstep == 0 ? 256.0 : (double)_microstep;
+  return COUNTS_PER_TURN / (200.0 * microstep);
+}
+
+uint8_t SimServoNode::reply(CanFrame &f, uint16_t id, uint8_t len) {
+  f.id = id;
+  f.dlc = len;
+  f.data[len - 1] = MKS::crc8_sum_plus1(f.data, len - 1);
+  for (uint8_t i = len; i < 8; i++) {
+    f.data[i] = 0;
+  }
+  return 1;
+}
+
+uint8_t SimServoNode::statusReply(CanFrame *out, uint8_t cmd, uint8_t status) const {
+  out[0].data[0] = cmd;
+  out[0].data[1] = status;
+  return reply(out[0], _canId, 3);
+}
+
+bool SimServoNode::startMove(uint8_t cmd, const uint8_t *p) {
+  if (!_enabled || _stall) {
+    return false;
+  }
+  const uint16_t rpm = (uint16_t)(((p[0] & MKS::BUS_SPEED_HI_NIBBLE_MSK) << 8) | p[1]);
+  const double sign = (p[0] & MKS::BUS_DIR_BIT) ? -1.0 : 1.0;
+  const int32_t value = MKS::get_i24_be(&p[3]);
+  // Relative commands received while a move is active chain onto the commanded target.
+  const double base = _motion == Motion::Position ? _target : _pos;
+  switch (cmd) {
+    case MKS::CMD_POS_MODE1_REL_PULSES: _target = base + sign * value * countsPerPulse(); break;
+    case MKS::CMD_POS_MODE2_ABS_PULSES: _target = value * countsPerPulse(); break;
+    case MKS::CMD_POS_MODE3_REL_AXIS:   _target = base + value; break;
+    case MKS::CMD_POS_MODE4_ABS_AXIS:   _target = value; break;
+    default: {
+      return false;
+    }
+  }
+  _maxVel = rpmToCps(rpm);
+  _accel = accToCps2(p[2]);
+  _motion = Motion::Position;
+  _motionCmd = cmd;
+  return true;
+}
+
+uint8_t SimServoNode::handle(const CanFrame &rx, uint64_t nowUs, CanFrame *out) {
+  if (!online(nowUs) || rx.dlc < 2 || rx.dlc > 8) {
+    return 0;
+  }
+  if (MKS::crc8_sum_plus1(rx.data, rx.dlc - 1) != rx.data[rx.dlc - 1]) {
+    return 0;
+  }
+  _framesHandled++;
+
+  const uint8_t cmd = rx.data[0];
+  const uint8_t *p = &rx.data[1];
+  const uint8_t len = (uint8_t)(rx.dlc - 2);
+  const uint16_t replyId = _canId;
+  uint8_t n = 0;
+  out[0].data[0] = cmd;
+
+  switch (cmd) {
+    case MKS::CMD_READ_ENCODER_CARRY: {
+      const double turns = floor(_pos / COUNTS_PER_TURN);
+      MKS::put_u32_be(&out[0].data[1], (uint32_t)(int32_t)turns);
+      MKS::put_u16_be(&out[0].data[5], (uint16_t)(_pos - turns * COUNTS_PER_TURN));
+      n = reply(out[0], replyId, 8);
+      break;
+    }
+    case MKS::CMD_READ_ENCODER_ADDITION: {
+      MKS::put_i48_be(&out[0].data[1], (int64_t)llround(_pos));
+      n = reply(out[0], replyId, 8);
+      break;
+    }
+    case MKS::CMD_READ_SPEED_RPM: {
+      MKS::put_u16_be(&out[0].data[1], (uint16_t)speedRpm());
+      n = reply(out[0], replyId, 4);
+      break;
+    }
+    case MKS::CMD_READ_INPUT_PULSES: {
+      MKS::put_u32_be(&out[0].data[1], (uint32_t)_inputPulses);
+      n = reply(out[0], replyId, 6);
+      break;
+    }
+    case MKS::CMD_READ_IO_STATUS: {
+      uint8_t io = (uint8_t)(_ioStatus & ~MKS::IO_STATUS_BIT_PEND);
+      if (_motion == Motion::Idle) {
+        io |= MKS::IO_STATUS_BIT_PEND;
+      }
+      n = statusReply(out, cmd, io);
+      break;
+    }
+    case MKS::CMD_READ_POS_ERROR: {
+      // Following error grows with speed: ~2 ms of lag, expressed in 51200-per-turn units.
+      const double lagCounts = _vel * 0.002;
+      MKS::put_u32_be(&out[0].data[1], (uint32_t)(int32_t)lround(lagCounts * POS_ERROR_PER_TURN / COUNTS_PER_TURN));
+      n = reply(out[0], replyId, 6);
+      break;
+    }
+    case MKS::CMD_READ_EN_STATUS: n = statusReply(out, cmd, _enabled ? 1 : 0); break;
+    case MKS::CMD_RELEASE_STALL_PROTECT: {
+      _stall = 0;
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    case MKS::CMD_READ_STALL_STATE: n = statusReply(out, cmd, _stall); break;
+    case MKS::CMD_RESTORE_DEFAULTS: {
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      resetConfig();
+      powerCycle(nowUs);
+      break;
+    }
+    case MKS::CMD_READ_VERSION_INFO: {
+      out[0].data[1] = (uint8_t)MKS::MotorSeries::E;
+      out[0].data[2] = (uint8_t)MKS::EncoderCalSense::CW_Increases;
+      out[0].data[3] = (uint8_t)MKS::HardwareVersion::SERVO42E_MKSPLCAN;
+      out[0].data[4] = 1;
+      out[0].data[5] = 0;
+      out[0].data[6] = 0;
+      n = reply(out[0], replyId, 8);
+      break;
+    }
+    case MKS::CMD_RESTART: {
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      powerCycle(nowUs);
+      break;
+    }
+    case MKS::CMD_USER_ID: {
+      if (len >= 4) {
+        _userId = MKS::get_u32_be(p);
+        n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      } else {
+        MKS::put_u32_be(&out[0].data[1], _userId);
+        n = reply(out[0], replyId, 6);
+      }
+      break;
+    }
+    case MKS::CMD_READ_PARAM: {
+      if (len < 1) {
+        break;
+      }
+      out[0].data[1] = p[0];
+      uint8_t dataLen = 1;
+      switch (p[0]) {
+        case MKS::CMD_SET_MODE:           out[0].data[2] = _mode; break;
+        case MKS::CMD_SET_MICROSTEP:      out[0].data[2] = _microstep; break;
+        case MKS::CMD_SET_DIR:            out[0].data[2] = _dir; break;
+        case MKS::CMD_SET_CAN_BITRATE:    out[0].data[2] = _bitrateCode; break;
+        case MKS::CMD_LOCK_AXIS:          out[0].data[2] = _lock; break;
+        case MKS::CMD_SET_CURRENT_MA:     MKS::put_u16_be(&out[0].data[2], _currentMa); dataLen = 2; break;
+        case MKS::CMD_SET_CAN_ID:         MKS::put_u16_be(&out[0].data[2], _canId); dataLen = 2; break;
+        case MKS::CMD_SET_GROUP_ID:       MKS::put_u16_be(&out[0].data[2], _groupId); dataLen = 2; break;
+        case MKS::CMD_SET_RESPOND_ACTIVE: out[0].data[2] = _respond; out[0].data[3] = _active; dataLen = 2; break;
+        default: {
+          dataLen = 0;
+          break;
+        }
+      }
+      n = reply(out[0], replyId, (uint8_t)(3 + dataLen));
+      break;
+    }
+    case MKS::CMD_WRITE_IO_PORT: n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_CALIBRATE_ENCODER: {
+      _calibrateDoneUs = nowUs + CALIBRATE_US;
+      n = statusReply(out, cmd, (uint8_t)MKS::CalibrateEncoderStatus::Calibrating);
+      break;
+    }
+    case MKS::CMD_SET_MODE: _mode = p[0]; n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_CURRENT_MA: _currentMa = MKS::get_u16_be(p); n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_MICROSTEP: _microstep = p[0]; n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_EN_ACTIVE: _enActive = p[0]; n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_DIR: _dir = p[0]; n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_PULSE_DELAY: n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_STALL_PROTECT_ENABLE: _stallProtect = p[0]; n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_STALL_TOLERANCE: _stallTolerance = MKS::get_u16_be(p); n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_CAN_BITRATE: {
+      // The ack still goes out at the old rate; the new rate applies to the next frame.
+      const bool ok = p[0] <= (uint8_t)MKS::CanBitrate::Mbps1;
+      n = statusReply(out, cmd, ok ? MKS::STATUS_SUCCESS : MKS::STATUS_FAIL);
+      if (ok) {
+        _bitrateCode = p[0];
+      }
+      break;
+    }
+    case MKS::CMD_SET_CAN_ID: {
+      const uint16_t id = MKS::get_u16_be(p);
+      const bool ok = id != 0 && id <= 0x7FF;
+      n = statusReply(out, cmd, ok ? MKS::STATUS_SUCCESS : MKS::STATUS_FAIL);
+      if (ok) {
+        _canId = id;
+      }
+      break;
+    }
+    case MKS::CMD_SET_RESPOND_ACTIVE: {
+      _respond = p[0];
+      _active = p[1];
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    case MKS::CMD_SET_GROUP_ID: _groupId = MKS::get_u16_be(p); n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_LOCK_AXIS: _lock = p[0]; n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_SET_HOME_PARAM: {
+      _homeTrig = p[0];
+      _homeDir = p[1];
+      _homeRpm = MKS::get_u16_be(&p[2]);
+      _homeEndLimit = p[4];
+      _homeMode = p[5];
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    case MKS::CMD_GO_HOME: {
+      if (!_enabled || _stall) {
+        n = statusReply(out, cmd, (uint8_t)MKS::GoHomeStatus::Fail);
+        break;
+      }
+      _motion = Motion::Homing;
+      _motionCmd = cmd;
+      _homeTravelled = 0.0;
+      _maxVel = rpmToCps(_homeRpm);
+      _accel = accToCps2(0);
+      n = statusReply(out, cmd, (uint8_t)MKS::GoHomeStatus::Start);
+      break;
+    }
+    case MKS::CMD_SET_AXIS_ZERO: {
+      _target -= _pos;
+      _pos = 0.0;
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    case MKS::CMD_SET_NOLIMIT_HOME_CURRENT:
+    case MKS::CMD_SET_NOLIMIT_HOME_PARAM:
+    case MKS::CMD_REMAP_LIMIT_PORT:
+    case MKS::CMD_SET_PULSE_DIV_OUTPUT:
+    case MKS::CMD_SAVE_CLEAN_SPEEDMODE: n = statusReply(out, cmd, MKS::STATUS_SUCCESS); break;
+    case MKS::CMD_QUERY_STATUS: n = statusReply(out, cmd, (uint8_t)runState()); break;
+    case MKS::CMD_ENABLE_BUS: {
+      _enabled = p[0] != 0;
+      if (!_enabled) {
+        _motion = Motion::Idle;
+        _vel = 0.0;
+        _targetVel = 0.0;
+      }
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    case MKS::CMD_POS_MODE1_REL_PULSES:
+    case MKS::CMD_POS_MODE2_ABS_PULSES:
+    case MKS::CMD_POS_MODE3_REL_AXIS:
+    case MKS::CMD_POS_MODE4_ABS_AXIS: {
+      const bool ok = len >= 6 && startMove(cmd, p);
+      n = statusReply(out, cmd, ok ? (uint8_t)MKS::PositionStatus::RunStarting : (uint8_t)MKS::PositionStatus::RunFail);
+      break;
+    }
+    case MKS::CMD_SPEED_MODE: {
+      if (len < 3 || !_enabled || _stall) {
+        n = statusReply(out, cmd, MKS::STATUS_FAIL);
+        break;
+      }
+      const uint16_t rpm = (uint16_t)(((p[0] & MKS::BUS_SPEED_HI_NIBBLE_MSK) << 8) | p[1]);
+      const double sign = (p[0] & MKS::BUS_DIR_BIT) ? -1.0 : 1.0;
+      _motion = rpm == 0 ? Motion::Idle : Motion::Speed;
+      _motionCmd = cmd;
+      _targetVel = sign * rpmToCps(rpm);
+      _accel = accToCps2(p[2]);
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    case MKS::CMD_EMERGENCY_STOP: {
+      _motion = Motion::Idle;
+      _vel = 0.0;
+      _targetVel = 0.0;
+      _target = _pos;
+      _rampState = 0;
+      n = statusReply(out, cmd, MKS::STATUS_SUCCESS);
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+
+  if (rx.id != _canId && rx.id != replyId) {
+    return 0; // broadcast and group addressed frames are never answered
+  }
+  if (_respond == 0 && cmd >= MKS::CMD_ENABLE_BUS) {
+    return 0;
+  }
+  return n;
+}
+
+void SimServoNode::step(double dt) {
+  const double before = fabs(_vel);
+  switch (_motion) {
+    case Motion::Speed: {
+      _vel = approach(_vel, _targetVel, _accel * dt);
+      break;
+    }
+    case Motion::Position: {
+      const double remaining = _target - _pos;
+      const double dir = remaining < 0 ? -1.0 : 1.0;
+      const double brakeLimited = sqrt(2.0 * _accel * fabs(remaining));
+      const double desired = dir * (brakeLimited < _maxVel ? brakeLimited : _maxVel);
+      _vel = approach(_vel, desired, _accel * dt);
+      const double next = _pos + _vel * dt;
+      if ((_target - next) * dir <= 0.5) {
+        _pos = _target;
+        _vel = 0.0;
+        _rampState = 0;
+        return;
+      }
+      break;
+    }
+    case Motion::Homing: {
+      const double dir = _homeDir ? 1.0 : -1.0;
+      _vel = approach(_vel, dir * _maxVel, _accel * dt);
+      _homeTravelled += fabs(_vel * dt);
+      break;
+    }
+    case Motion::Idle: {
+      _vel = approach(_vel, 0.0, _accel * dt);
+      break;
+    }
+  }
+  _pos += _vel * dt;
+  const double after = fabs(_vel);
+  _rampState = after > before ? 1 : (after < before ? -1 : 0);
+}
+
+uint8_t SimServoNode::finishMotion(uint8_t status, CanFrame *out) {
+  const uint8_t cmd = _motionCmd;
+  _motion = Motion::Idle;
+  _vel = 0.0;
+  _rampState = 0;
+  if (!_active) {
+    return 0;
+  }
+  return statusReply(out, cmd, status);
+}
+
+uint8_t SimServoNode::advance(uint64_t nowUs, CanFrame *out) {
+  if (_lastUs == 0 || nowUs < _lastUs) {
+    _lastUs = nowUs;
+    return 0;
+  }
+  uint8_t n = 0;
+  double remaining = (double)(nowUs - _lastUs) / 1e6;
+  _lastUs = nowUs;
+  if (!online(nowUs)) {
+    return 0;
+  }
+  while (remaining > 0.0) {
+    const double dt = remaining < MAX_STEP_S ? remaining : MAX_STEP_S;
+    remaining -= dt;
+    step(dt);
+    if (n < MAX_REPLIES && _motion == Motion::Position && _pos == _target && _vel == 0.0) {
+      n += finishMotion((uint8_t)MKS::PositionStatus::RunComplete, &out[n]);
+    }
+    if (n < MAX_REPLIES && _motion == Motion::Homing && _homeTravelled >= (double)_homeDistance) {
+      _pos = 0.0;
+      _target = 0.0;
+      n += finishMotion((uint8_t)MKS::GoHomeStatus::Success, &out[n]);
+    }
+  }
+  if (n < MAX_REPLIES && _calibrateDoneUs != 0 && nowUs >= _calibrateDoneUs) {
+    _calibrateDoneUs = 0;
+    if (_active) {
+      n += statusReply(&out[n], MKS::CMD_CALIBRATE_ENCODER, (uint8_t)MKS::CalibrateEncoderStatus::Success);
+    }
+  }
+  return n;
+}
+
+#endif // !defined(ARDUINO)
@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+#include "../transport/ICanBus.h"
+#include "../protocol/MksProtocol.h"
+
+// Software model of one SERVO42E/57E drive in CAN bus mode.
+// It answers the commands from MksCommands.h with the frame layouts the driver parses,
+// runs speed/position/homing moves with a simple trapezoidal profile, and sends the
+// completion "active reports" (status 2) the real drive emits when active reporting is on.
+// Used through SimCanBus; it never touches the bus itself.
+class SimServoNode {
+public:
+  static const uint8_t MAX_REPLIES = 2;
+
+  explicit SimServoNode(uint16_t canId);
+
+  // Frame IDs this node acts on: its own ID, broadcast 0 and its group ID.
+  // Only frames addressed to the node's own ID are answered.
+  bool accepts(uint16_t frameId) const;
+  bool online(uint64_t nowUs) const;
+
+  // Processes one host frame at nowUs and writes up to MAX_REPLIES replies.
+  uint8_t handle(const CanFrame &rx, uint64_t nowUs, CanFrame *out);
+  // Advances the motion model to nowUs and writes any active reports that became due.
+  uint8_t advance(uint64_t nowUs, CanFrame *out);
+
+  // Fault injection.
+  void injectStall();
+  void setIoStatus(uint8_t status) { _ioStatus = status; }
+  // Distance (encoder counts) a go-home run travels before the home switch triggers.
+  void setHomeDistance(int64_t counts) { _homeDistance = counts; }
+  void powerCycle(uint64_t nowUs);
+  // Test setup shortcut for a node that was configured to another bitrate (MKS::CanBitrate).
+  void setBitrateCode(uint8_t code) { _bitrateCode = code; }
+
+  uint16_t canId() const { return _canId; }
+  uint16_t groupId() const { return _groupId; }
+  uint8_t bitrateCode() const { return _bitrateCode; }
+  bool enabled() const { return _enabled; }
+  bool stalled() const { return _stall != 0; }
+  int64_t encoderAddition() const { return (int64_t)_pos; }
+  int16_t speedRpm() const;
+  MKS::MotorRunState runState() const;
+  uint32_t restartCount() const { return _restarts; }
+  uint32_t framesHandled() const { return _framesHandled; }
+
+private:
+  enum class Motion : uint8_t { Idle, Speed, Position, Homing };
+
+  uint16_t _canId;
+  uint16_t _groupId;
+  uint8_t _bitrateCode;
+  uint8_t _mode;
+  uint16_t _currentMa;
+  uint8_t _microstep;
+  uint8_t _dir;
+  uint8_t _enActive;
+  uint8_t _respond;
+  uint8_t _active;
+  uint8_t _lock;
+  uint8_t _stallProtect;
+  uint16_t _stallTolerance;
+  uint8_t _ioStatus;
+  uint8_t _stall;
+  uint32_t _userId;
+  bool _enabled;
+
+  uint8_t _homeTrig;
+  uint8_t _homeDir;
+  uint16_t _homeRpm;
+  uint8_t _homeEndLimit;
+  uint8_t _homeMode;
+  int64_t _homeDistance;
+  double _homeTravelled;
+
+  Motion _motion;
+  uint8_t _motionCmd;
+  double _pos;
+  double _vel;
+  double _targetVel;
+  double _maxVel;
+  double _accel;
+  double _target;
+  int8_t _rampState;
+  int32_t _inputPulses;
+
+  uint64_t _lastUs;
+  uint64_t _offlineUntilUs;
+  uint64_t _calibrateDoneUs;
+  uint32_t _restarts;
+  uint32_t _framesHandled;
+
+  void resetConfig();
+  void resetRuntime();
+  void step(double dt);
+  uint8_t finishMotion(uint8_t status, CanFrame *out);
+  double countsPerPulse() const;
+  static double rpmToCps(double rpm);
+  static double accToCps2(uint8_t acc);
+  static uint8_t reply(CanFrame &f, uint16_t id, uint8_t len);
+  uint8_t statusReply(CanFrame *out, uint8_t cmd, uint8_t status) const;
+  bool startMove(uint8_t cmd, const uint8_t *p);
+};
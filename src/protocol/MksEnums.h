@@ -306,6 +306,10 @@ namespace MKS {
     EndLimitStopped = 0x03,
   };
 
+  // Range of the signed 24-bit pulse/axis field of the four position modes.
+  static constexpr int32_t AXIS_FIELD_MIN = -8388608;
+  static constexpr int32_t AXIS_FIELD_MAX = 8388607;
+
   // Bit layout for speed/position mode "byte2" in bus-control commands (F6/FD/FE):
   static constexpr uint8_t BUS_DIR_BIT            = 0x80; // 0=forward, 1=reverse (see manual examples)
   static constexpr uint8_t BUS_SPEED_HI_NIBBLE_MSK = 0x0F; // lower 4 bits of byte2 contribute to speed[11:8]
@@ -39,6 +39,14 @@ namespace MKS {
     p[2] = (uint8_t)(u & 0xFF);
   }
 
+  inline int32_t get_i24_be(const uint8_t *p) {
+    uint32_t u = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | (uint32_t)p[2];
+    if (u & 0x00800000) {
+      u |= 0xFF000000;
+    }
+    return (int32_t)u;
+  }
+
   inline void put_u32_le(uint8_t *p, uint32_t v) {
     p[0] = (uint8_t)(v & 0xFF);
     p[1] = (uint8_t)((v >> 8) & 0xFF);
@@ -61,6 +69,16 @@ namespace MKS {
     return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
   }
 
+  inline void put_i48_be(uint8_t *p, int64_t v) {
+    uint64_t u = (uint64_t)v;
+    p[0] = (uint8_t)((u >> 40) & 0xFF);
+    p[1] = (uint8_t)((u >> 32) & 0xFF);
+    p[2] = (uint8_t)((u >> 24) & 0xFF);
+    p[3] = (uint8_t)((u >> 16) & 0xFF);
+    p[4] = (uint8_t)((u >> 8) & 0xFF);
+    p[5] = (uint8_t)(u & 0xFF);
+  }
+
   inline int64_t get_i48_be(const uint8_t *p) {
     uint64_t u = ((uint64_t)p[0] << 40) | ((uint64_t)p[1] << 32) | ((uint64_t)p[2] << 24) | ((uint64_t)p[3] << 16) | ((uint64_t)p[4] << 8) | (uint64_t)p[5];
     if (u & 0x0000800000000000ULL) {
@@ -22,6 +22,24 @@ public:
     _bus.setFilter(id, mask);
   }
 
+  uint8_t abortPendingTx() override {
+    return _bus.abortPendingTx();
+  }
+
+  bool errorStatus(CanErrorStatus &out) override {
+    return _bus.errorStatus(out);
+  }
+
+  bool recover() override {
+    return _bus.recover();
+  }
+
+  void waitForRx(uint32_t maxUs) override {
+    if (_count == 0) {
+      _bus.waitForRx(maxUs);
+    }
+  }
+
   Adapter& underlying() {
     return _bus;
   }
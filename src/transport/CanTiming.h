@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+#include "ICanBus.h"
+
+// Wire-time model for classic CAN 2.0A data frames.
+// frameBits() builds the actual bit stream (SOF..CRC), computes CRC-15 and counts the
+// stuff bits that payload produces, so a frame's cost depends on its real contents rather
+// than a worst-case estimate. Used for bus-load budgeting and by the host simulator.
+namespace CanTiming {
+  // Fixed-form tail after the CRC: CRC delimiter, ACK slot, ACK delimiter, 7 EOF, 3 IFS.
+  static constexpr uint8_t TAIL_BITS = 13;
+
+  // Unstuffed length of SOF..CRC for a standard data frame.
+  inline uint8_t stuffableBits(uint8_t dlc) {
+    return (uint8_t)(34u + 8u * (dlc > 8 ? 8 : dlc));
+  }
+
+  // Upper bound including the worst possible stuffing.
+  inline uint16_t worstCaseBits(uint8_t dlc) {
+    const uint8_t stuffable = stuffableBits(dlc);
+    return (uint16_t)(stuffable + (stuffable - 1u) / 4u + TAIL_BITS);
+  }
+
+  inline uint16_t frameBits(const CanFrame &f) {
+    const uint8_t dlc = f.dlc > 8 ? 8 : f.dlc;
+    const uint8_t headerAndData = (uint8_t)(19u + 8u * dlc);
+    uint16_t crc = 0;
+    uint16_t bits = 0;
+    uint8_t runLength = 0;
+    uint8_t lastBit = 2;
+
+    // Bits up to the CRC field, then the 15 CRC bits themselves, all subject to stuffing.
+    for (uint8_t i = 0; i < headerAndData + 15u; i++) {
+      uint8_t bit;
+      if (i < headerAndData) {
+        if (i == 0) {
+          bit = 0; // SOF
+        } else if (i <= 11) {
+          bit = (uint8_t)((f.id >> (11 - i)) & 1u);
+        } else if (i <= 14) {
+          bit = 0; // RTR, IDE, r0
+        } else if (i <= 18) {
+          bit = (uint8_t)((dlc >> (18 - i)) & 1u);
+        } else {
+          const uint8_t dataBit = (uint8_t)(i - 19);
+          bit = (uint8_t)((f.data[dataBit / 8] >> (7 - dataBit % 8)) & 1u);
+        }
+        const uint16_t feedback = (uint16_t)(((crc >> 14) & 1u) ^ bit);
+        crc = (uint16_t)((crc << 1) & 0x7FFF);
+        if (feedback) {
+          crc ^= 0x4599;
+        }
+      } else {
+        bit = (uint8_t)((crc >> (14 - (i - headerAndData))) & 1u);
+      }
+
+      bits++;
+      if (bit == lastBit) {
+        runLength++;
+      } else {
+        lastBit = bit;
+        runLength = 1;
+      }
+      if (runLength == 5) {
+        // The stuff bit has the opposite level and starts a new run.
+        bits++;
+        lastBit = (uint8_t)(bit ^ 1u);
+        runLength = 1;
+      }
+    }
+    return (uint16_t)(bits + TAIL_BITS);
+  }
+
+  inline uint32_t bitsToUs(uint32_t bits, uint32_t bitrate) {
+    if (bitrate == 0) {
+      return 0;
+    }
+    return (uint32_t)(((uint64_t)bits * 1000000u + bitrate - 1) / bitrate);
+  }
+
+  inline uint32_t frameTimeUs(const CanFrame &f, uint32_t bitrate) {
+    return bitsToUs(frameBits(f), bitrate);
+  }
+}
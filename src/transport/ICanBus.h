@@ -7,6 +7,20 @@ struct CanFrame {
   uint8_t  data[8];
 };
 
+// Fault confinement state of the CAN controller (ISO 11898-1).
+enum class CanErrorState : uint8_t {
+  Active = 0,  // normal operation
+  Warning,     // TEC or REC reached 96
+  Passive,     // TEC or REC reached 128: the node no longer sends active error flags
+  BusOff       // TEC passed 255: the controller has left the bus
+};
+
+struct CanErrorStatus {
+  CanErrorState state;
+  uint8_t tec;  // transmit error counter (saturates at 255 in bus-off)
+  uint8_t rec;  // receive error counter
+};
+
 class ICanBus {
 public:
   virtual bool begin(uint32_t bitrate) = 0;
@@ -14,5 +28,17 @@ public:
   virtual bool available() = 0;
   virtual bool read(CanFrame& out) = 0;
   virtual void setFilter(uint16_t id, uint16_t mask) = 0;
+  // Sleeps until a frame may have arrived or roughly maxUs passed. Adapters that cannot be
+  // woken by RX keep this default and return immediately, so callers fall back to polling.
+  virtual void waitForRx(uint32_t maxUs) { (void)maxUs; }
+  // Drops frames that were accepted by send() but have not started on the wire yet, so an
+  // urgent frame does not queue behind them. Returns how many were dropped; adapters that
+  // cannot abort transmissions keep this default.
+  virtual uint8_t abortPendingTx() { return 0; }
+  // Reads the controller's error state and counters; false if the adapter cannot report them.
+  virtual bool errorStatus(CanErrorStatus &out) { (void)out; return false; }
+  // Brings a bus-off controller back to error-active now instead of waiting for the controller's
+  // own recovery (if any). Returns true once the controller is back on the bus.
+  virtual bool recover() { return false; }
   virtual ~ICanBus() = default;
 };
\ No newline at end of file
@@ -0,0 +1,283 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ICanBus.h"
+#include "../protocol/MksCommands.h"
+
+namespace CanTxPriority {
+  // Lower value = sent first.
+  enum Class : uint8_t {
+    SAFETY = 0,   // emergency stop, enable/disable
+    MOTION,       // speed/position setpoints, go home
+    TELEMETRY,    // reads and status queries
+    CONFIG,       // everything else
+    CLASS_COUNT
+  };
+
+  // What send() does when the queue of a class is full.
+  enum Policy : uint8_t {
+    BACKPRESSURE = 0,  // refuse the frame; the caller sees ERROR_BUS_SEND
+    DROP_OLDEST,       // drop the oldest queued frame of the class
+    COALESCE           // replace a queued frame for the same ID and command in place, else refuse.
+                       // send() reports the merged frame as sent, so only use it when no caller
+                       // waits for a reply per request (the driver's reads do).
+  };
+
+  // Absolute targets: a newer one for the same axis makes a queued one pointless. Relative
+  // moves accumulate and are never merged.
+  inline bool isSetpoint(const CanFrame &f) {
+    return f.dlc > 0 && (f.data[0] == MKS::CMD_SPEED_MODE || f.data[0] == MKS::CMD_POS_MODE4_ABS_AXIS ||
+                         f.data[0] == MKS::CMD_POS_MODE2_ABS_PULSES);
+  }
+
+  inline Class classify(const CanFrame &f) {
+    if (f.dlc == 0) {
+      return CONFIG;
+    }
+    switch (f.data[0]) {
+      case MKS::CMD_EMERGENCY_STOP:
+      case MKS::CMD_ENABLE_BUS:
+        return SAFETY;
+      case MKS::CMD_POS_MODE3_REL_AXIS:
+      case MKS::CMD_POS_MODE4_ABS_AXIS:
+      case MKS::CMD_SPEED_MODE:
+      case MKS::CMD_POS_MODE1_REL_PULSES:
+      case MKS::CMD_POS_MODE2_ABS_PULSES:
+      case MKS::CMD_GO_HOME:
+        return MOTION;
+      case MKS::CMD_READ_PARAM:
+      case MKS::CMD_READ_ENCODER_CARRY:
+      case MKS::CMD_READ_ENCODER_ADDITION:
+      case MKS::CMD_READ_SPEED_RPM:
+      case MKS::CMD_READ_INPUT_PULSES:
+      case MKS::CMD_READ_IO_STATUS:
+      case MKS::CMD_READ_POS_ERROR:
+      case MKS::CMD_READ_EN_STATUS:
+      case MKS::CMD_READ_STALL_STATE:
+      case MKS::CMD_READ_VERSION_INFO:
+      case MKS::CMD_QUERY_STATUS:
+        return TELEMETRY;
+      default:
+        return CONFIG;
+    }
+  }
+}
+
+// Software TX queue in front of an adapter. send() hands a frame straight to the adapter when
+// nothing of the same or a higher class is waiting; otherwise, or when the adapter's mailboxes
+// are full, the frame waits in its class queue. Queues drain highest class first whenever the
+// bus is used (send/available/read) or service() is called, so setpoints never wait behind
+// configuration writes and callers only see ERROR_BUS_SEND once a class queue is full.
+// An emergency stop drops the queued motion frames for its target (all of them for ID 0), and
+// a new absolute setpoint replaces the same axis' queued one of the same kind if nothing for
+// that axis was queued after it, so a streaming jog never lags behind stale targets.
+template <typename Adapter, size_t Depth = 4>
+class PriorityTxCanBus : public ICanBus {
+public:
+  PriorityTxCanBus() : _bus(), _coalesced(0), _coalesceSetpoints(true), _coalescedSetpoints(0) {
+    for (uint8_t c = 0; c < CanTxPriority::CLASS_COUNT; c++) {
+      _head[c] = 0;
+      _count[c] = 0;
+      _dropped[c] = 0;
+    }
+    _policy[CanTxPriority::SAFETY] = CanTxPriority::BACKPRESSURE;
+    _policy[CanTxPriority::MOTION] = CanTxPriority::BACKPRESSURE;
+    _policy[CanTxPriority::TELEMETRY] = CanTxPriority::BACKPRESSURE;
+    _policy[CanTxPriority::CONFIG] = CanTxPriority::BACKPRESSURE;
+  }
+
+  bool begin(uint32_t bitrate) override {
+    clear();
+    return _bus.begin(bitrate);
+  }
+
+  bool send(const CanFrame &f) override {
+    service();
+    const CanTxPriority::Class cls = CanTxPriority::classify(f);
+    if (f.dlc > 0 && f.data[0] == MKS::CMD_EMERGENCY_STOP) {
+      dropMotion(f.id);
+    }
+    if (queuedUpTo(cls) == 0 && _bus.send(f)) {
+      return true;
+    }
+    return enqueue(cls, f);
+  }
+
+  bool available() override {
+    service();
+    return bus().available();
+  }
+
+  bool read(CanFrame &out) override {
+    service();
+    return bus().read(out);
+  }
+
+  void setFilter(uint16_t id, uint16_t mask) override {
+    _bus.setFilter(id, mask);
+  }
+
+  void waitForRx(uint32_t maxUs) override {
+    // Queued frames need the mailboxes polled, so only sleep with nothing left to send.
+    if (service() == 0) {
+      _bus.waitForRx(maxUs);
+    }
+  }
+
+  // Drops every queued frame and whatever the adapter can still abort.
+  uint8_t abortPendingTx() override {
+    uint8_t dropped = (uint8_t)queued();
+    clear();
+    return (uint8_t)(dropped + _bus.abortPendingTx());
+  }
+
+  bool errorStatus(CanErrorStatus &out) override {
+    return _bus.errorStatus(out);
+  }
+
+  bool recover() override {
+    return _bus.recover();
+  }
+
+  // Moves queued frames into the adapter until its mailboxes are full; returns frames still queued.
+  size_t service() {
+    for (uint8_t c = 0; c < CanTxPriority::CLASS_COUNT; c++) {
+      while (_count[c] > 0) {
+        if (!_bus.send(_queue[c][_head[c]])) {
+          return queued();
+        }
+        _head[c] = (_head[c] + 1) % Depth;
+        _count[c]--;
+      }
+    }
+    return 0;
+  }
+
+  void setSetpointCoalescing(bool enable) { _coalesceSetpoints = enable; }
+
+  void setPolicy(CanTxPriority::Class cls, CanTxPriority::Policy policy) {
+    if (cls < CanTxPriority::CLASS_COUNT) {
+      _policy[cls] = policy;
+    }
+  }
+
+  size_t queued() const {
+    size_t n = 0;
+    for (uint8_t c = 0; c < CanTxPriority::CLASS_COUNT; c++) {
+      n += _count[c];
+    }
+    return n;
+  }
+  size_t queued(CanTxPriority::Class cls) const { return cls < CanTxPriority::CLASS_COUNT ? _count[cls] : 0; }
+  // Frames dropped by DROP_OLDEST or by an emergency stop.
+  uint32_t dropped(CanTxPriority::Class cls) const { return cls < CanTxPriority::CLASS_COUNT ? _dropped[cls] : 0; }
+  // Frames merged by the COALESCE policy.
+  uint32_t coalesced() const { return _coalesced; }
+  // Setpoints replaced by a newer one before they reached the adapter.
+  uint32_t coalescedSetpoints() const { return _coalescedSetpoints; }
+
+  Adapter& underlying() {
+    return _bus;
+  }
+
+private:
+  Adapter _bus;
+  CanFrame _queue[CanTxPriority::CLASS_COUNT][Depth];
+  size_t _head[CanTxPriority::CLASS_COUNT];
+  size_t _count[CanTxPriority::CLASS_COUNT];
+  uint32_t _dropped[CanTxPriority::CLASS_COUNT];
+  uint8_t _policy[CanTxPriority::CLASS_COUNT];
+  uint32_t _coalesced;
+  bool _coalesceSetpoints;
+  uint32_t _coalescedSetpoints;
+
+  // Adapters such as BufferedCanBus keep available()/read() private; go through the interface.
+  ICanBus &bus() {
+    return _bus;
+  }
+
+  size_t queuedUpTo(CanTxPriority::Class cls) const {
+    size_t n = 0;
+    for (uint8_t c = 0; c <= cls; c++) {
+      n += _count[c];
+    }
+    return n;
+  }
+
+  void clear() {
+    for (uint8_t c = 0; c < CanTxPriority::CLASS_COUNT; c++) {
+      _head[c] = 0;
+      _count[c] = 0;
+    }
+  }
+
+  // Same node and command; parameter reads (0x00) also need the same parameter code.
+  static bool sameTarget(const CanFrame &a, const CanFrame &b) {
+    if (a.id != b.id || a.dlc == 0 || b.dlc == 0 || a.data[0] != b.data[0]) {
+      return false;
+    }
+    return a.data[0] != MKS::CMD_READ_PARAM || (a.dlc > 1 && b.dlc > 1 && a.data[1] == b.data[1]);
+  }
+
+  // Only the last queued motion frame of the axis may be replaced, so ordering against
+  // relative moves and other setpoint kinds is kept.
+  bool replaceSetpoint(const CanFrame &f) {
+    const uint8_t c = CanTxPriority::MOTION;
+    for (size_t i = _count[c]; i > 0; i--) {
+      CanFrame &q = _queue[c][(_head[c] + i - 1) % Depth];
+      if (q.id != f.id) {
+        continue;
+      }
+      if (q.data[0] != f.data[0]) {
+        return false;
+      }
+      q = f;
+      _coalescedSetpoints++;
+      return true;
+    }
+    return false;
+  }
+
+  bool enqueue(CanTxPriority::Class cls, const CanFrame &f) {
+    if (_coalesceSetpoints && cls == CanTxPriority::MOTION && CanTxPriority::isSetpoint(f) && replaceSetpoint(f)) {
+      return true;
+    }
+    if (_policy[cls] == CanTxPriority::COALESCE) {
+      for (size_t i = 0; i < _count[cls]; i++) {
+        CanFrame &q = _queue[cls][(_head[cls] + i) % Depth];
+        if (sameTarget(q, f)) {
+          q = f;
+          _coalesced++;
+          return true;
+        }
+      }
+    }
+    if (_count[cls] == Depth) {
+      if (_policy[cls] != CanTxPriority::DROP_OLDEST) {
+        return false;
+      }
+      _head[cls] = (_head[cls] + 1) % Depth;
+      _count[cls]--;
+      _dropped[cls]++;
+    }
+    _queue[cls][(_head[cls] + _count[cls]) % Depth] = f;
+    _count[cls]++;
+    return true;
+  }
+
+  // Keeps queue order while removing the motion frames an emergency stop overrides.
+  void dropMotion(uint16_t id) {
+    const uint8_t c = CanTxPriority::MOTION;
+    size_t kept = 0;
+    for (size_t i = 0; i < _count[c]; i++) {
+      const CanFrame f = _queue[c][(_head[c] + i) % Depth];
+      if (id == 0 || f.id == id) {
+        _dropped[c]++;
+        continue;
+      }
+      _queue[c][(_head[c] + kept) % Depth] = f;
+      kept++;
+    }
+    _count[c] = kept;
+  }
+};
@@ -7,7 +7,9 @@
 #if defined(ARDUINO_UNOR4_MINIMA) || defined(ARDUINO_UNOR4_WIFI)
 #include "UnoR4CanBus.h"
 #include "../BufferedCanBus.h"
-using CanBusAdapter = BufferedCanBus<UnoR4CanBus>;
+#include "../PriorityTxCanBus.h"
+// Motion frames overtake queued configuration writes and a full mailbox set queues instead of failing.
+using CanBusAdapter = BufferedCanBus<PriorityTxCanBus<UnoR4CanBus>>;
 #else
 #error "No supported CAN adapter selected. Add a new adapter in src/transport/adapters/ and extend AdapterSelector.h."
 #endif
@@ -21,6 +21,7 @@ bool UnoR4CanBus::begin(uint32_t bitrate) {
   if (!toArduinoBitrate(bitrate, mapped)) {
     return false;
   }
+  _bitrate = bitrate;
   return CAN.begin(mapped);
 }
 
@@ -65,4 +66,45 @@ void UnoR4CanBus::setFilter(uint16_t id, uint16_t mask) {
   (void)mask;
 }
 
+void UnoR4CanBus::waitForRx(uint32_t maxUs) {
+  // Arduino_CAN fills its RX ring from the CAN interrupt, and the millis() tick fires every
+  // 1 ms, so WFI never sleeps past the next frame or past ~1 ms. Shorter budgets just return.
+  if (maxUs < 1000 || CAN.available() > 0) {
+    return;
+  }
+  __WFI();
+}
+
+bool UnoR4CanBus::errorStatus(CanErrorStatus &out) {
+  out.tec = R_CAN0->TECR;
+  out.rec = R_CAN0->RECR;
+  if (R_CAN0->STR_b.BOST) {
+    out.state = CanErrorState::BusOff;
+  } else if (R_CAN0->STR_b.EPST) {
+    out.state = CanErrorState::Passive;
+  } else if (out.tec >= 96 || out.rec >= 96) {
+    out.state = CanErrorState::Warning;
+  } else {
+    out.state = CanErrorState::Active;
+  }
+  return true;
+}
+
+bool UnoR4CanBus::recover() {
+  if (!R_CAN0->STR_b.BOST) {
+    return true;
+  }
+  R_CAN0->CTLR_b.RBOC = 1;
+  // RBOC is only honoured in the ISO recovery mode; the flag clears once the controller is back.
+  for (uint16_t i = 0; i < 1000 && R_CAN0->STR_b.BOST; i++) {}
+  if (!R_CAN0->STR_b.BOST) {
+    return true;
+  }
+  if (_bitrate == 0) {
+    return false;
+  }
+  CAN.end();
+  return begin(_bitrate);
+}
+
 #endif // defined(ARDUINO_UNOR4_MINIMA) || defined(ARDUINO_UNOR4_WIFI)
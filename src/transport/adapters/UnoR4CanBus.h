@@ -6,11 +6,23 @@
 
 class UnoR4CanBus : public ICanBus {
 public:
+  UnoR4CanBus() : _bitrate(0) {}
+
   bool begin(uint32_t bitrate) override;
   bool send(const CanFrame &frame) override;
   bool available() override;
   bool read(CanFrame &out) override;
   void setFilter(uint16_t id, uint16_t mask) override; // no-op on UNO R4
+  void waitForRx(uint32_t maxUs) override;             // WFI; RX and the 1 ms tick wake the core
+  // abortPendingTx() keeps the ICanBus default: Arduino_CAN exposes no mailbox abort.
+  // Error state and counters come straight from the RA4M1 CAN registers (STR, TECR, RECR).
+  bool errorStatus(CanErrorStatus &out) override;
+  // Forces the controller out of bus-off (CTLR.RBOC); if it stays there the controller is
+  // re-initialized at the last bitrate, which also drops frames still waiting to be sent.
+  bool recover() override;
+
+private:
+  uint32_t _bitrate;
 };
 
 #else